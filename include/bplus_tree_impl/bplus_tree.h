@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "btree_impl/btree.h"
+#include "bplus_tree_node.h"
+#include "bplus_tree_cursor.h"
+#include "utils/forward_decl.h"
+
+namespace btree {
+    /**
+     * B+ tree engine:
+     *  - inner nodes keep only separator keys, so they have higher fanout than BTreeNode and the tree is shallower
+     *  - all entries are referenced from the leaves, leaves are linked with their siblings
+     *  - with PACKED_BPLUS_TREE the keys of a node are packed (see BPlusTreeNode): a node is split when the next key
+     *    doesn't fit it and the split point is moved from the middle till both halves fit; a node which can neither
+     *    borrow a key nor be merged without overflowing a node is left with fewer keys than the minimum
+     */
+    template <typename K, typename V>
+    struct BPlusTree final {
+        using ValueType = typename BTree<K, V>::ValueType;
+
+        using EntryT = typename BTree<K, V>::EntryT;
+        using Node = BPlusTreeNode<K, V>;
+        using IOManagerT = IOManager<K, V>;
+
+        BPlusTree(const int16_t order, IOManagerT& io);
+
+        bool exist(IOManagerT& io, const K key) const;
+        std::optional<V> get(IOManagerT& io, const K key) const;
+        void set(IOManagerT& io, const K key, ValueType value);
+        void set(IOManagerT& io, const K key, const V& value, const int32_t size);
+        bool remove(IOManagerT& io, const K key);
+        /** The entry of KEY or an invalid entry, the value isn't copied from the mapping */
+        EntryT find(IOManagerT& io, const K key) const;
+
+        /** Calls ON_FOUND(i, entry_pos) for each found key of SORTED_KEYS, the common part of the paths is read once */
+        template <typename Func>
+        void find_batch(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const;
+
+        /** FIND_BATCH by levels, see BTree::find_batch_by_levels */
+        template <typename Func>
+        void find_batch_by_levels(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const;
+
+        /** Reads ahead the leaves and the entries of SORTED_KEYS level by level, see BTree::prefetch */
+        void prefetch(IOManagerT& io, const K* sorted_keys, const size_t n) const;
+
+        BPlusTreeCursor<K, V> cursor(IOManagerT& io) const;
+
+        /** Lock-free lookup for the concurrent readers, see BTree::find_optimistic */
+        template <typename Func>
+        static bool find_optimistic(const IOManagerT& io, const VersionLatches& latches, const K key, Func&& on_entry);
+    private:
+        /** Inner nodes on the way from the root to a leaf with indexes of the taken children */
+        using Path = std::vector<std::pair<Node, int32_t>>;
+
+        Node find_leaf(IOManagerT& io, const K key, Path* path) const;
+        /** Position of the entry of KEY, an inline value may take any position */
+        std::optional<int64_t> find_entry_pos(IOManagerT& io, const K key) const;
+
+        template <typename Func>
+        void find_batch(IOManagerT& io, const Node& node, const K* batch, const size_t first, const size_t last,
+                        Func& on_found) const;
+        void insert(IOManagerT& io, const EntryT& e);
+
+        /** Splits LEAF with KEY inserted, the right half is returned: the caller writes both */
+        Node split_leaf(IOManagerT& io, Node& leaf, const K key, const int64_t entry_pos);
+        /** Splits NODE with SEPARATOR and its right child inserted, SEPARATOR gets the key passed to the parent */
+        Node split_inner(IOManagerT& io, Node& node, K& separator, const int64_t child_pos);
+        /** Number of the first of COUNT keys left in the left half: the one closest to PREFERRED with both halves fit */
+        int32_t find_split(const Node& node, const std::vector<K>& keys, const int32_t preferred) const;
+        void fix_underflow(IOManagerT& io, Node& parent, const int32_t idx, Node& child);
+        bool borrow_from_left(IOManagerT& io, Node& parent, const int32_t idx, Node& child);
+        bool borrow_from_right(IOManagerT& io, Node& parent, const int32_t idx, Node& child);
+        /** Merges RIGHT into LEFT if the keys fit one node */
+        bool merge_nodes(IOManagerT& io, Node& parent, const int32_t separator_idx, Node& left, Node& right);
+
+        void write_node(IOManagerT& io, const Node& node);
+
+        const int16_t t;
+        const bool packed_keys;
+        Node root;
+    };
+}
+
+#include "bplus_tree_impl/bplus_tree_impl.h"
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vector>
+
+#include "utils/forward_decl.h"
+
+namespace btree {
+    /**
+     * Bottom-up BPlusTree builder for sorted unique keys which entries are already written to the file.
+     * The tree is built level by level:
+     *  - leaves are written one after another to the node slots, every leaf allocates the slot of the next one
+     *    to link it
+     *  - then every inner level is written from the (min key, position) list of the level below
+     * The number of keys is known in advance: nodes are packed as much as possible and the keys are spread evenly,
+     * so every non-root node has at least the minimal number of keys. The nodes of packed keys take as many keys
+     * as fit them, the number depends on the keys: only the last node of a level may have fewer keys.
+     */
+    template <typename K, typename V>
+    class BPlusTreeBuilder final {
+        using Node = BPlusTreeNode<K, V>;
+        using IOManagerT = IOManager<K, V>;
+
+        IOManagerT& io;
+        const int16_t t;
+        const bool packed_keys;
+        const int64_t leaves;
+        const int64_t keys_count;
+
+        Node leaf;
+        int64_t leaf_idx;
+        int64_t prev_leaf_pos;
+        int64_t next_leaf_pos;
+        std::vector<std::pair<K, int64_t>> children;  // min key and position of every node of the last level
+    public:
+        BPlusTreeBuilder(IOManagerT& io, const int16_t t, const int64_t keys_count) :
+            io(io), t(t), packed_keys(io.get_engine() == PACKED_BPLUS_TREE),
+            leaves((keys_count + Node::max_leaf_keys(t) - 1) / Node::max_leaf_keys(t)),
+            keys_count(keys_count),
+            leaf(t, true, packed_keys), leaf_idx(0), prev_leaf_pos(IOManagerT::INVALID_POS),
+            next_leaf_pos(IOManagerT::INVALID_POS) {}
+
+        /** Keys must be passed in strictly ascending order */
+        void add(const K key, const int64_t entry_pos) {
+            // The leaf is written when the next key doesn't go to it, so it's linked to the next leaf
+            if (leaf.used_keys > 0 && (packed_keys ? !leaf.can_insert(key) : leaf.used_keys == target_keys()))
+                write_leaf(false);
+            leaf.insert_entry(leaf.used_keys, key, entry_pos);
+        }
+
+        /** Returns the root position or INVALID_POS for an empty tree */
+        int64_t finish() {
+            if (leaf.used_keys > 0)
+                write_leaf(true);
+            if (children.empty())
+                return IOManagerT::INVALID_POS;
+
+            while (children.size() > 1) {
+                auto counts = packed_keys ? packed_children_counts() : even_children_counts();
+
+                std::vector<std::pair<K, int64_t>> parents;
+                parents.reserve(counts.size());
+                int64_t first = 0;
+                for (auto count: counts) {
+                    Node node(t, false, packed_keys);
+                    node.child_pos[0] = children[first].second;
+                    for (int64_t j = 1; j < count; ++j)
+                        node.insert_child(node.used_keys, children[first + j].first, children[first + j].second);
+
+                    node.m_pos = io.allocate_node();
+                    io.write_node(node, node.m_pos);
+                    parents.emplace_back(children[first].first, node.m_pos);
+                    first += count;
+                }
+                children = std::move(parents);
+            }
+            return children.front().second;
+        }
+
+    private:
+        int64_t target_keys() const {
+            return keys_count / leaves + ((leaf_idx < keys_count % leaves) ? 1 : 0);
+        }
+
+        /** Numbers of the children of the nodes of the next level */
+        std::vector<int64_t> even_children_counts() const {
+            const int64_t max_children = Node::max_inner_keys(t) + 1;
+            const int64_t total = children.size();
+            const int64_t nodes = (total + max_children - 1) / max_children;
+            std::vector<int64_t> counts;
+            for (int64_t i = 0; i < nodes; ++i)
+                counts.push_back(total / nodes + ((i < total % nodes) ? 1 : 0));
+            return counts;
+        }
+
+        std::vector<int64_t> packed_children_counts() const {
+            std::vector<int64_t> counts;
+            Node node(t, false, packed_keys);
+            for (size_t i = 0; i < children.size(); ++i) {
+                if (!counts.empty() && node.can_insert(children[i].first)) {
+                    node.insert_child(node.used_keys, children[i].first, children[i].second);
+                    ++counts.back();
+                    continue;
+                }
+                node.used_keys = 0;
+                counts.push_back(1);
+            }
+            // A node has a separator at least: the last one takes a child of the previous one
+            if (counts.size() > 1 && counts.back() == 1) {
+                --counts[counts.size() - 2];
+                ++counts.back();
+            }
+            return counts;
+        }
+
+        void write_leaf(const bool is_last) {
+            // The slot of this leaf was allocated by the previous one
+            leaf.m_pos = (leaf_idx == 0) ? io.allocate_node() : next_leaf_pos;
+            leaf.prev_leaf_pos = prev_leaf_pos;
+            next_leaf_pos = is_last ? IOManagerT::INVALID_POS : io.allocate_node();
+            leaf.next_leaf_pos = next_leaf_pos;
+            io.write_node(leaf, leaf.m_pos);
+
+            children.emplace_back(leaf.keys[0], leaf.m_pos);
+            prev_leaf_pos = leaf.m_pos;
+            ++leaf_idx;
+            leaf = Node(t, true, packed_keys);
+        }
+    };
+}
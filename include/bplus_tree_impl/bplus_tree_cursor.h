@@ -0,0 +1,39 @@
+#pragma once
+
+#include "utils/forward_decl.h"
+
+namespace btree {
+    /**
+     * In-order cursor over the BPlusTree.
+     * The cursor descends from the root only on seek, the steps follow the sibling links between leaves.
+     * Any modification of the tree invalidates the cursor.
+     */
+    template <typename K, typename V>
+    class BPlusTreeCursor final {
+        using Node = BPlusTreeNode<K, V>;
+        using EntryT = typename BTree<K, V>::EntryT;
+        using IOManagerT = IOManager<K, V>;
+
+        IOManagerT* io;
+        Node root;
+        Node leaf;
+        int32_t idx;
+    public:
+        BPlusTreeCursor(IOManagerT& io, const Node& root);
+
+        bool valid() const;
+        K key() const;
+        EntryT entry() const;
+
+        bool seek(const K key);
+        bool seek_to_first();
+        bool seek_to_last();
+        bool next();
+        bool prev();
+    private:
+        void descend(const bool to_leftmost, const K key);
+        void invalidate();
+    };
+}
+
+#include "bplus_tree_impl/bplus_tree_cursor_impl.h"
@@ -0,0 +1,102 @@
+#pragma once
+
+namespace btree {
+    template <typename K, typename V>
+    BPlusTreeCursor<K, V>::BPlusTreeCursor(IOManagerT& io, const Node& root) :
+        io(&io), root(root), leaf(), idx(0) {}
+
+    template <typename K, typename V>
+    bool BPlusTreeCursor<K, V>::valid() const {
+        return leaf.is_valid();
+    }
+
+    template <typename K, typename V>
+    K BPlusTreeCursor<K, V>::key() const {
+        return leaf.keys[idx];
+    }
+
+    template <typename K, typename V>
+    typename BTree<K, V>::EntryT BPlusTreeCursor<K, V>::entry() const {
+        return io->read_entry(leaf.keys[idx], leaf.entry_pos[idx]);
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeCursor<K, V>::seek(const K key) {
+        if (!root.is_valid())
+            return false;
+
+        descend(false, key);
+        idx = leaf.find_key_pos(key);
+        // All keys in the leaf are less than KEY, the next one is the first key of the next leaf
+        if (idx == leaf.used_keys) {
+            --idx;
+            return next();
+        }
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeCursor<K, V>::seek_to_first() {
+        if (!root.is_valid())
+            return false;
+
+        descend(true, 0);
+        idx = -1;
+        return next();
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeCursor<K, V>::seek_to_last() {
+        if (!root.is_valid())
+            return false;
+
+        // Follow the rightmost children
+        leaf = root;
+        while (!leaf.is_leaf)
+            leaf = io->read_bplus_node(leaf.child_pos[leaf.used_keys]);
+        idx = leaf.used_keys;
+        return prev();
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeCursor<K, V>::next() {
+        // A leaf of packed keys may be left empty by the removals (see BPlusTree), it's skipped
+        while (++idx >= leaf.used_keys) {
+            if (leaf.next_leaf_pos == IOManagerT::INVALID_POS) {
+                invalidate();
+                return false;
+            }
+            leaf = io->read_bplus_node(leaf.next_leaf_pos);
+            idx = -1;
+        }
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeCursor<K, V>::prev() {
+        while (--idx < 0) {
+            if (leaf.prev_leaf_pos == IOManagerT::INVALID_POS) {
+                invalidate();
+                return false;
+            }
+            leaf = io->read_bplus_node(leaf.prev_leaf_pos);
+            idx = leaf.used_keys;
+        }
+        return true;
+    }
+
+    template <typename K, typename V>
+    void BPlusTreeCursor<K, V>::descend(const bool to_leftmost, const K key) {
+        leaf = root;
+        while (!leaf.is_leaf) {
+            auto child_idx = to_leftmost ? 0 : leaf.find_child_idx(key);
+            leaf = io->read_bplus_node(leaf.child_pos[child_idx]);
+        }
+    }
+
+    template <typename K, typename V>
+    void BPlusTreeCursor<K, V>::invalidate() {
+        leaf = Node();
+        idx = 0;
+    }
+}
@@ -0,0 +1,542 @@
+#pragma once
+
+namespace btree {
+    template <typename K, typename V>
+    BPlusTree<K, V>::BPlusTree(const int16_t order, IOManagerT& io) :
+            t(order), packed_keys(io.get_engine() == PACKED_BPLUS_TREE), root() {
+        if (!io.is_ready())
+            return;
+
+        auto root_pos = io.read_header();
+        if (root_pos == IOManagerT::INVALID_POS)
+            return;
+
+        root = io.read_bplus_node(root_pos);
+    }
+
+    template <typename K, typename V>
+    void BPlusTree<K, V>::set(IOManagerT& io, const K key, ValueType value) {
+        insert(io, EntryT{ key, value });
+    }
+
+    template <typename K, typename V>
+    void BPlusTree<K, V>::set(IOManagerT& io, const K key, const V& value, const int32_t size) {
+        if (size != 0)
+            insert(io, EntryT{ key, value, size });
+    }
+
+    template <typename K, typename V>
+    std::optional<V> BPlusTree<K, V>::get(IOManagerT& io, const K key) const {
+        return find(io, key).value();
+    }
+
+    template <typename K, typename V>
+    bool BPlusTree<K, V>::exist(IOManagerT& io, const K key) const {
+        return find_entry_pos(io, key).has_value();
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    void BPlusTree<K, V>::find_batch(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const {
+        if (root.is_valid())
+            find_batch(io, root, sorted_keys, 0, n, on_found);
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    void BPlusTree<K, V>::find_batch(IOManagerT& io, const Node& node, const K* batch, const size_t first,
+                                     const size_t last, Func& on_found) const {
+        auto begin = node.keys.begin();
+        auto end = begin + node.used_keys;
+        if (node.is_leaf) {
+            // The batch is sorted, so the search continues from the previous position
+            auto lower = begin;
+            for (size_t i = first; i < last; ++i) {
+                lower = std::lower_bound(lower, end, batch[i]);
+                if (lower != end && *lower == batch[i])
+                    on_found(i, node.entry_pos[std::distance(begin, lower)]);
+            }
+            return;
+        }
+
+        auto upper = begin;
+        for (size_t i = first; i < last;) {
+            upper = std::upper_bound(upper, end, batch[i]);
+            auto idx = std::distance(begin, upper);
+
+            // All keys less than the next separator go to the same child with one node read
+            size_t j = i + 1;
+            while (j < last && (upper == end || batch[j] < *upper))
+                ++j;
+            find_batch(io, io.read_bplus_node(node.child_pos[idx]), batch, i, j, on_found);
+            i = j;
+        }
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    void BPlusTree<K, V>::find_batch_by_levels(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const {
+        if (!root.is_valid())
+            return;
+
+        std::vector<int64_t> node_pos(n, root.m_pos);
+        for (bool has_next_level = n > 0; has_next_level;) {
+            for (size_t i = 0; i < n; ++i)
+                if (node_pos[i] != IOManagerT::INVALID_POS && (i == 0 || node_pos[i] != node_pos[i - 1]))
+                    io.prefetch_node(node_pos[i]);
+            io.complete_prefetch();
+
+            has_next_level = false;
+            for (size_t i = 0; i < n; ++i) {
+                if (node_pos[i] == IOManagerT::INVALID_POS)
+                    continue;
+                auto node = io.view_bplus_node(node_pos[i]);
+                if (!node.is_leaf()) {
+                    node_pos[i] = node.child_pos(node.upper_bound(sorted_keys[i]));
+                    has_next_level = true;
+                    continue;
+                }
+                auto idx = node.lower_bound(sorted_keys[i]);
+                if (node.has_key(idx, sorted_keys[i]))
+                    on_found(i, node.entry_pos(idx));
+                node_pos[i] = IOManagerT::INVALID_POS;
+            }
+        }
+    }
+
+    template <typename K, typename V>
+    void BPlusTree<K, V>::prefetch(IOManagerT& io, const K* sorted_keys, const size_t n) const {
+        find_batch_by_levels(io, sorted_keys, n, [&io](const size_t, const int64_t entry_pos) {
+            io.prefetch_entry(entry_pos);
+        });
+        io.complete_prefetch();
+    }
+
+    template <typename K, typename V>
+    BPlusTreeCursor<K, V> BPlusTree<K, V>::cursor(IOManagerT& io) const {
+        return BPlusTreeCursor<K, V>(io, root);
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    bool BPlusTree<K, V>::find_optimistic(const IOManagerT& io, const VersionLatches& latches, const K key,
+                                          Func&& on_entry) {
+        auto parent_pos = IOManagerT::HEADER_POS;
+        auto parent_version = latches.read_version(parent_pos);
+        if (VersionLatches::is_latched(parent_version))
+            return false;
+
+        auto [pos, format_version] = io.read_root_pos_and_format();
+        while (pos != IOManagerT::INVALID_POS) {
+            // Coupling: the parent is still valid when the version of the child is taken
+            auto version = latches.read_version(pos);
+            if (VersionLatches::is_latched(version) || !latches.validate(parent_pos, parent_version))
+                return false;
+
+            // The node is read in place: what's taken from it is used only after its version is validated
+            auto node = io.try_view_bplus_node(pos);
+            if (!node)
+                return false;
+            bool is_leaf = node->is_leaf();
+            auto idx = is_leaf ? node->lower_bound(key) : node->upper_bound(key);
+            bool has_key = is_leaf && node->has_key(idx, key);
+            auto next_pos = has_key ? node->entry_pos(idx) : (is_leaf ? IOManagerT::INVALID_POS : node->child_pos(idx));
+            if (!latches.validate(pos, version))
+                return false;
+
+            if (has_key)
+                return BTree<K, V>::read_entry_optimistic(io, latches, format_version, pos, version, key, next_pos,
+                                                          on_entry);
+            if (is_leaf)
+                return true;
+
+            parent_pos = pos;
+            parent_version = version;
+            pos = next_pos;
+        }
+        return latches.validate(parent_pos, parent_version);
+    }
+
+    template <typename K, typename V>
+    typename BPlusTree<K, V>::EntryT BPlusTree<K, V>::find(IOManagerT& io, const K key) const {
+        auto entry_pos = find_entry_pos(io, key);
+        return entry_pos ? io.read_entry(key, *entry_pos) : EntryT();
+    }
+
+    template <typename K, typename V>
+    std::optional<int64_t> BPlusTree<K, V>::find_entry_pos(IOManagerT& io, const K key) const {
+        if (!root.is_valid())
+            return std::nullopt;
+
+        if (root.is_leaf) {
+            auto idx = root.find_key_pos(key);
+            if (idx < root.used_keys && root.keys[idx] == key)
+                return root.entry_pos[idx];
+            return std::nullopt;
+        }
+
+        // The nodes below the root are searched in place: the lookup doesn't copy them
+        auto node = io.view_bplus_node(root.child_pos[root.find_child_idx(key)]);
+        while (!node.is_leaf())
+            node = io.view_bplus_node(node.child_pos(node.upper_bound(key)));
+
+        auto idx = node.lower_bound(key);
+        if (node.has_key(idx, key))
+            return node.entry_pos(idx);
+        return std::nullopt;
+    }
+
+    template <typename K, typename V>
+    BPlusTreeNode<K, V> BPlusTree<K, V>::find_leaf(IOManagerT& io, const K key, Path* path) const {
+        Node curr = root;
+        while (!curr.is_leaf) {
+            auto idx = curr.find_child_idx(key);
+            Node child = io.read_bplus_node(curr.child_pos[idx]);
+            if (path)
+                path->emplace_back(std::move(curr), idx);
+            curr = std::move(child);
+        }
+        return curr;
+    }
+
+    template <typename K, typename V>
+    void BPlusTree<K, V>::write_node(IOManagerT& io, const Node& node) {
+        io.write_node(node, node.m_pos);
+        if (node.m_pos == root.m_pos)
+            root = node;
+    }
+
+    template <typename K, typename V>
+    void BPlusTree<K, V>::insert(IOManagerT& io, const EntryT& e) {
+        if (!root.is_valid()) {
+            // write header
+            io.write_header();
+
+            root = Node(t, true, packed_keys);
+            root.m_pos = io.allocate_node();
+
+            auto entry_pos = io.allocate_entry(e);
+            root.insert_entry(0, e.key, entry_pos);
+
+            // write node root and key|value
+            io.write_node(root, root.m_pos);
+            io.write_entry(e, entry_pos);
+            io.write_new_pos_for_root_node(root.m_pos);
+            return;
+        }
+
+        Path path;
+        Node leaf = find_leaf(io, e.key, &path);
+        auto idx = leaf.find_key_pos(e.key);
+
+        // Replace the entry of the existing key
+        if (idx < leaf.used_keys && leaf.keys[idx] == e.key) {
+            if (io.read_entry(e.key, leaf.entry_pos[idx]) != e) {
+                // The old entry is freed first: the new one may take its place
+                io.free_entry(leaf.entry_pos[idx]);
+                auto curr_pos = io.allocate_entry(e);
+                leaf.entry_pos[idx] = curr_pos;
+
+                io.write_entry(e, curr_pos);
+                write_node(io, leaf);
+            }
+            return;
+        }
+
+        auto entry_pos = io.allocate_entry(e);
+        io.write_entry(e, entry_pos);
+
+        if (leaf.can_insert(e.key)) {
+            leaf.insert_entry(idx, e.key, entry_pos);
+            write_node(io, leaf);
+            return;
+        }
+
+        // Split the leaf with the key inserted into one of its halves
+        Node right = split_leaf(io, leaf, e.key, entry_pos);
+        write_node(io, leaf);
+        write_node(io, right);
+
+        // Pass the separator to the parents while it doesn't fit them
+        K separator = right.keys[0];
+        int64_t new_child_pos = right.m_pos;
+        while (!path.empty()) {
+            Node& parent = path.back().first;
+            if (parent.can_insert(separator)) {
+                parent.insert_child(parent.find_child_idx(separator), separator, new_child_pos);
+                write_node(io, parent);
+                return;
+            }
+
+            Node parent_right = split_inner(io, parent, separator, new_child_pos);
+            write_node(io, parent);
+            write_node(io, parent_right);
+
+            new_child_pos = parent_right.m_pos;
+            path.pop_back();
+        }
+
+        // The root was split
+        Node new_root(t, false, packed_keys);
+        new_root.child_pos[0] = root.m_pos;
+        new_root.insert_child(0, separator, new_child_pos);
+        new_root.m_pos = io.allocate_node();
+        io.write_node(new_root, new_root.m_pos);
+
+        io.write_new_pos_for_root_node(new_root.m_pos);
+        root = std::move(new_root);
+    }
+
+    template <typename K, typename V>
+    BPlusTreeNode<K, V> BPlusTree<K, V>::split_leaf(IOManagerT& io, Node& leaf, const K key, const int64_t entry_pos) {
+        auto idx = leaf.find_key_pos(key);
+        std::vector<K> keys(leaf.keys.begin(), leaf.keys.begin() + leaf.used_keys);
+        std::vector<int64_t> positions(leaf.entry_pos.begin(), leaf.entry_pos.begin() + leaf.used_keys);
+        keys.insert(keys.begin() + idx, key);
+        positions.insert(positions.begin() + idx, entry_pos);
+
+        // The lower half gets the new key if it's in the lower half of the old keys
+        auto mid = leaf.used_keys / 2;
+        auto split = find_split(leaf, keys, mid + (idx <= mid ? 1 : 0));
+
+        // Move the upper half of the keys to the new right sibling
+        Node right(t, true, packed_keys);
+        auto count = static_cast<int32_t>(keys.size());
+        for (auto i = 0; i < count; ++i) {
+            auto& node = (i < split) ? leaf : right;
+            auto node_idx = (i < split) ? i : i - split;
+            node.keys[node_idx] = keys[i];
+            node.entry_pos[node_idx] = positions[i];
+        }
+        right.used_keys = count - split;
+        leaf.used_keys = split;
+
+        // Link the new leaf between LEAF and its next sibling
+        right.m_pos = io.allocate_node();
+        right.prev_leaf_pos = leaf.m_pos;
+        right.next_leaf_pos = leaf.next_leaf_pos;
+        leaf.next_leaf_pos = right.m_pos;
+
+        if (right.next_leaf_pos != IOManagerT::INVALID_POS) {
+            Node next = io.read_bplus_node(right.next_leaf_pos);
+            next.prev_leaf_pos = right.m_pos;
+            io.write_node(next, next.m_pos);
+        }
+        return right;
+    }
+
+    template <typename K, typename V>
+    BPlusTreeNode<K, V> BPlusTree<K, V>::split_inner(IOManagerT& io, Node& node, K& separator, const int64_t child_pos) {
+        auto idx = node.find_child_idx(separator);
+        std::vector<K> keys(node.keys.begin(), node.keys.begin() + node.used_keys);
+        std::vector<int64_t> children(node.child_pos.begin(), node.child_pos.begin() + node.used_keys + 1);
+        keys.insert(keys.begin() + idx, separator);
+        children.insert(children.begin() + idx + 1, child_pos);
+
+        // The split key goes up to the parent, the keys after it go to the new right node
+        auto mid = node.used_keys / 2;
+        auto split = find_split(node, keys, mid + (idx <= mid ? 1 : 0));
+        separator = keys[split];
+
+        Node right(t, false, packed_keys);
+        auto count = static_cast<int32_t>(keys.size());
+        std::copy(keys.begin(), keys.begin() + split, node.keys.begin());
+        std::copy(children.begin(), children.begin() + split + 1, node.child_pos.begin());
+        std::copy(keys.begin() + split + 1, keys.end(), right.keys.begin());
+        std::copy(children.begin() + split + 1, children.end(), right.child_pos.begin());
+        right.used_keys = count - split - 1;
+        node.used_keys = split;
+
+        right.m_pos = io.allocate_node();
+        return right;
+    }
+
+    template <typename K, typename V>
+    int32_t BPlusTree<K, V>::find_split(const Node& node, const std::vector<K>& keys, const int32_t preferred) const {
+        // The separator of an inner node goes up, so it's in none of the halves
+        auto count = static_cast<int32_t>(keys.size());
+        auto gap = node.is_leaf ? 0 : 1;
+        auto min_split = node.is_leaf ? 1 : 0;
+        auto fits = [&](const int32_t split) {
+            return split >= min_split && split < count &&
+                   node.fits(keys.data(), split) && node.fits(keys.data() + split + gap, count - split - gap);
+        };
+        for (auto shift = 0; shift < count; ++shift) {
+            if (fits(preferred - shift))
+                return preferred - shift;
+            if (fits(preferred + shift))
+                return preferred + shift;
+        }
+        // The node fitted before the insertion, so one of the splits fits: the old keys can't be wider than a node
+        return preferred;
+    }
+
+    template <typename K, typename V>
+    bool BPlusTree<K, V>::remove(IOManagerT& io, const K key) {
+        if (!root.is_valid())
+            return false;
+
+        Path path;
+        Node node = find_leaf(io, key, &path);
+        auto idx = node.find_key_pos(key);
+        if (idx == node.used_keys || node.keys[idx] != key)
+            return false;
+
+        // Separators equal to the removed key may stay in the inner nodes, they still route the search correctly
+        io.free_entry(node.entry_pos[idx]);
+        node.erase_entry(idx);
+        write_node(io, node);
+
+        while (!path.empty() && node.used_keys < node.min_keys()) {
+            auto& [parent, child_idx] = path.back();
+            fix_underflow(io, parent, child_idx, node);
+            node = std::move(parent);
+            path.pop_back();
+        }
+
+        if (root.used_keys == 0) {
+            if (root.is_leaf) {
+                root = Node();
+                io.write_invalidated_root();
+            } else {
+                auto pos = root.child_pos[0];
+                io.write_new_pos_for_root_node(pos);
+                io.free_node(root.m_pos);
+                root = io.read_bplus_node(pos);
+            }
+        }
+        return true;
+    }
+
+    template <typename K, typename V>
+    void BPlusTree<K, V>::fix_underflow(IOManagerT& io, Node& parent, const int32_t idx, Node& child) {
+        // An inner node left without keys by a failed merge has no siblings to take keys from
+        if (parent.used_keys == 0)
+            return;
+
+        // 1. Borrow a key from a sibling if it has more than the minimum
+        if (borrow_from_left(io, parent, idx, child) || borrow_from_right(io, parent, idx, child))
+            return;
+
+        // 2. Both siblings have the minimum number of keys, merge CHILD with one of them
+        if (idx > 0) {
+            Node left = io.read_bplus_node(parent.child_pos[idx - 1]);
+            if (merge_nodes(io, parent, idx - 1, left, child))
+                return;
+        }
+        if (idx < parent.used_keys) {
+            Node right = io.read_bplus_node(parent.child_pos[idx + 1]);
+            merge_nodes(io, parent, idx, child, right);
+        }
+    }
+
+    template <typename K, typename V>
+    bool BPlusTree<K, V>::borrow_from_left(IOManagerT& io, Node& parent, const int32_t idx, Node& child) {
+        if (idx == 0)
+            return false;
+        Node left = io.read_bplus_node(parent.child_pos[idx - 1]);
+        if (left.used_keys <= left.min_keys())
+            return false;
+
+        // The new keys of CHILD and PARENT may widen their packed keys: they're changed only if they still fit
+        Node new_child = child;
+        Node new_parent = parent;
+        auto last = left.used_keys - 1;
+        if (child.is_leaf) {
+            new_child.insert_entry(0, left.keys[last], left.entry_pos[last]);
+            new_parent.keys[idx - 1] = new_child.keys[0];
+        } else {
+            shift_right_by_one(new_child.keys, new_child.used_keys, 0);
+            shift_right_by_one(new_child.child_pos, new_child.used_keys + 1, 0);
+            new_child.keys[0] = parent.keys[idx - 1];
+            new_child.child_pos[0] = left.child_pos[left.used_keys];
+            new_child.used_keys++;
+            new_parent.keys[idx - 1] = left.keys[last];
+        }
+        if (!new_child.fits() || !new_parent.fits())
+            return false;
+        left.used_keys--;
+        child = std::move(new_child);
+        parent = std::move(new_parent);
+
+        write_node(io, left);
+        write_node(io, child);
+        write_node(io, parent);
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool BPlusTree<K, V>::borrow_from_right(IOManagerT& io, Node& parent, const int32_t idx, Node& child) {
+        if (idx == parent.used_keys)
+            return false;
+        Node right = io.read_bplus_node(parent.child_pos[idx + 1]);
+        if (right.used_keys <= right.min_keys())
+            return false;
+
+        Node new_child = child;
+        Node new_parent = parent;
+        if (child.is_leaf) {
+            new_child.insert_entry(new_child.used_keys, right.keys[0], right.entry_pos[0]);
+            new_parent.keys[idx] = right.keys[1];
+        } else {
+            new_child.keys[new_child.used_keys] = parent.keys[idx];
+            new_child.child_pos[new_child.used_keys + 1] = right.child_pos[0];
+            new_child.used_keys++;
+            new_parent.keys[idx] = right.keys[0];
+        }
+        if (!new_child.fits() || !new_parent.fits())
+            return false;
+        if (child.is_leaf) {
+            right.erase_entry(0);
+        } else {
+            shift_left_by_one(right.keys, 1, right.used_keys);
+            shift_left_by_one(right.child_pos, 1, right.used_keys + 1);
+            right.used_keys--;
+        }
+        child = std::move(new_child);
+        parent = std::move(new_parent);
+
+        write_node(io, right);
+        write_node(io, child);
+        write_node(io, parent);
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool BPlusTree<K, V>::merge_nodes(IOManagerT& io, Node& parent, const int32_t separator_idx, Node& left, Node& right) {
+        // The separator goes down between the keys of inner nodes
+        std::vector<K> keys(left.keys.begin(), left.keys.begin() + left.used_keys);
+        if (!left.is_leaf)
+            keys.push_back(parent.keys[separator_idx]);
+        keys.insert(keys.end(), right.keys.begin(), right.keys.begin() + right.used_keys);
+        if (!left.fits(keys.data(), static_cast<int32_t>(keys.size())))
+            return false;
+
+        if (left.is_leaf) {
+            for (auto i = 0; i < right.used_keys; ++i)
+                left.insert_entry(left.used_keys, right.keys[i], right.entry_pos[i]);
+
+            // Unlink the RIGHT leaf
+            left.next_leaf_pos = right.next_leaf_pos;
+            if (right.next_leaf_pos != IOManagerT::INVALID_POS) {
+                Node next = io.read_bplus_node(right.next_leaf_pos);
+                next.prev_leaf_pos = left.m_pos;
+                io.write_node(next, next.m_pos);
+            }
+        } else {
+            // The separator goes down between the keys of LEFT and RIGHT
+            left.keys[left.used_keys] = parent.keys[separator_idx];
+            for (auto i = 0; i < right.used_keys; ++i)
+                left.keys[left.used_keys + 1 + i] = right.keys[i];
+            for (auto i = 0; i <= right.used_keys; ++i)
+                left.child_pos[left.used_keys + 1 + i] = right.child_pos[i];
+            left.used_keys += right.used_keys + 1;
+        }
+
+        parent.erase_child(separator_idx);
+        io.free_node(right.m_pos);
+        write_node(io, left);
+        write_node(io, parent);
+        return true;
+    }
+}
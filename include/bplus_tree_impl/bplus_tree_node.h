@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "utils/forward_decl.h"
+
+namespace btree {
+    /**
+     * B+ tree node, it takes the same number of bytes as the BTreeNode of the same order (t),
+     * so both engines fit a node into the same OS page.
+     *  - inner node: only separator keys and children, no entry positions -> higher fanout
+     *  - leaf node:  keys, entry positions and links to the neighbour leaves
+     * With PACKED_KEYS the keys are written as the first key and the deltas of the others to it in the fewest bits
+     * that hold the largest delta (see IOManager): the number of keys that fit the node depends on their span,
+     * FITS() and CAN_INSERT() check it. The minimum number of keys is the one of the plain node, so two nodes
+     * at the minimum always fit one node whatever their span.
+     */
+    template <typename K, typename V>
+    struct BPlusTreeNode final {
+        int16_t used_keys;
+        int16_t t;
+        uint8_t is_leaf;
+        bool packed_keys;
+        int64_t m_pos;
+        int64_t prev_leaf_pos;
+        int64_t next_leaf_pos;
+        std::vector<K> keys;
+        std::vector<int64_t> entry_pos;
+        std::vector<int64_t> child_pos;
+
+        explicit BPlusTreeNode();
+        BPlusTreeNode(const int16_t& t, bool is_leaf, bool packed_keys = false);
+
+        static constexpr int32_t get_node_size_in_bytes(const int16_t t);
+        static constexpr int32_t max_leaf_keys(const int16_t t, const bool packed_keys = false);
+        static constexpr int32_t max_inner_keys(const int16_t t, const bool packed_keys = false);
+        /** Bytes of the packed node left for the deltas and the positions of its keys */
+        static constexpr int32_t packed_keys_size_in_bytes(const int16_t t, const bool is_leaf);
+        /** Bits of the delta from LO to HI as they're written */
+        static int32_t delta_bits(const K lo, const K hi);
+
+        int32_t max_keys() const;
+        int32_t min_keys() const;
+        bool is_full() const;
+        bool is_valid() const;
+        /** The keys fit the node slot */
+        bool fits() const;
+        bool can_insert(const K key) const;
+        /** COUNT keys of SORTED_KEYS fit a node of this kind */
+        bool fits(const K* sorted_keys, const int32_t count) const;
+
+        /** Index of the first key >= KEY (the position of KEY in a leaf) */
+        int32_t find_key_pos(const K key) const;
+        /** Index of the child which subtree can contain KEY */
+        int32_t find_child_idx(const K key) const;
+
+        void insert_entry(const int32_t idx, const K key, const int64_t pos);
+        void insert_child(const int32_t idx, const K key, const int64_t pos);
+        void erase_entry(const int32_t idx);
+        void erase_child(const int32_t idx);
+    private:
+        // FLAG + USED_KEYS
+        static constexpr int32_t node_header_size_in_bytes = sizeof(uint8_t) + sizeof(int16_t);
+        // PREV_LEAF + NEXT_LEAF
+        static constexpr int32_t links_size_in_bytes = 2 * sizeof(int64_t);
+        // BASE_KEY + DELTA_BITS
+        static constexpr int32_t packed_header_size_in_bytes = sizeof(K) + sizeof(uint8_t);
+        // A wider delta may span 9 bytes at its bit offset, it's written in 64 bits
+        static constexpr int32_t max_unaligned_delta_bits = 57;
+
+        /** Bytes of COUNT deltas of DELTA_BITS and their positions */
+        static int32_t packed_size_in_bytes(const int32_t count, const int32_t delta_bits);
+    };
+}
+
+#include "bplus_tree_impl/bplus_tree_node_impl.h"
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "btree_impl/btree_node.h"
+#include "utils/utils.h"
+
+namespace btree {
+    using namespace utils;
+
+    template <typename K, typename V>
+    BPlusTreeNode<K, V>::BPlusTreeNode() :
+            used_keys(0),
+            t(0),
+            is_leaf(false),
+            packed_keys(false),
+            m_pos(-1),
+            prev_leaf_pos(-1),
+            next_leaf_pos(-1),
+            keys(0, -1),
+            entry_pos(0, -1),
+            child_pos(0, -1) {}
+
+    template <typename K, typename V>
+    BPlusTreeNode<K, V>::BPlusTreeNode(const int16_t& t, bool is_leaf, bool packed_keys) :
+            used_keys(0),
+            t(t),
+            is_leaf(is_leaf),
+            packed_keys(packed_keys),
+            m_pos(-1),
+            prev_leaf_pos(-1),
+            next_leaf_pos(-1),
+            keys(is_leaf ? max_leaf_keys(t, packed_keys) : max_inner_keys(t, packed_keys), -1),
+            entry_pos(is_leaf ? max_leaf_keys(t, packed_keys) : 0, -1),
+            child_pos(is_leaf ? 0 : max_inner_keys(t, packed_keys) + 1, -1) {}
+
+    template <typename K, typename V>
+    constexpr int32_t BPlusTreeNode<K, V>::get_node_size_in_bytes(const int16_t t) {
+        return BTreeNode<K, V>::get_node_size_in_bytes(t);
+    }
+
+    template <typename K, typename V>
+    constexpr int32_t BPlusTreeNode<K, V>::max_leaf_keys(const int16_t t, const bool packed_keys) {
+        // The packed keys take a bit at least
+        if (packed_keys)
+            return packed_keys_size_in_bytes(t, true) * 8 / (1 + 8 * sizeof(int64_t));
+        // PREV_LEAF + NEXT_LEAF, then (KEY + ENTRY_POS) for each key
+        return (get_node_size_in_bytes(t) - node_header_size_in_bytes - links_size_in_bytes) / (sizeof(K) + sizeof(int64_t));
+    }
+
+    template <typename K, typename V>
+    constexpr int32_t BPlusTreeNode<K, V>::max_inner_keys(const int16_t t, const bool packed_keys) {
+        if (packed_keys)
+            return packed_keys_size_in_bytes(t, false) * 8 / (1 + 8 * sizeof(int64_t));
+        // the extra CHILD_POS, then (KEY + CHILD_POS) for each key
+        return (get_node_size_in_bytes(t) - node_header_size_in_bytes - sizeof(int64_t)) / (sizeof(K) + sizeof(int64_t));
+    }
+
+    template <typename K, typename V>
+    constexpr int32_t BPlusTreeNode<K, V>::packed_keys_size_in_bytes(const int16_t t, const bool is_leaf) {
+        // The links of a leaf or the extra CHILD_POS of an inner node
+        auto fixed_size = node_header_size_in_bytes + packed_header_size_in_bytes +
+                          (is_leaf ? links_size_in_bytes : static_cast<int32_t>(sizeof(int64_t)));
+        return get_node_size_in_bytes(t) - fixed_size;
+    }
+
+    template <typename K, typename V>
+    int32_t BPlusTreeNode<K, V>::delta_bits(const K lo, const K hi) {
+        using UnsignedK = std::make_unsigned_t<K>;
+        auto delta = static_cast<uint64_t>(static_cast<UnsignedK>(static_cast<UnsignedK>(hi) - static_cast<UnsignedK>(lo)));
+        int32_t bits = 1;
+        while (bits < 64 && (delta >> bits) != 0)
+            ++bits;
+        return bits > max_unaligned_delta_bits ? 64 : bits;
+    }
+
+    template <typename K, typename V>
+    int32_t BPlusTreeNode<K, V>::packed_size_in_bytes(const int32_t count, const int32_t delta_bits) {
+        return (count * delta_bits + 7) / 8 + count * static_cast<int32_t>(sizeof(int64_t));
+    }
+
+    template <typename K, typename V>
+    int32_t BPlusTreeNode<K, V>::max_keys() const {
+        return is_leaf ? max_leaf_keys(t, packed_keys) : max_inner_keys(t, packed_keys);
+    }
+
+    template <typename K, typename V>
+    int32_t BPlusTreeNode<K, V>::min_keys() const {
+        // a split of the full node leaves at least this number of keys in both halves
+        return is_leaf ? max_leaf_keys(t) / 2 : (max_inner_keys(t) - 1) / 2;
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeNode<K, V>::is_full() const {
+        return used_keys == max_keys();
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeNode<K, V>::is_valid() const {
+        return t != 0;
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeNode<K, V>::fits() const {
+        return fits(keys.data(), used_keys);
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeNode<K, V>::can_insert(const K key) const {
+        if (is_full())
+            return false;
+        if (!packed_keys || used_keys == 0)
+            return true;
+        auto lo = std::min(keys[0], key);
+        auto hi = std::max(keys[used_keys - 1], key);
+        return packed_size_in_bytes(used_keys + 1, delta_bits(lo, hi)) <= packed_keys_size_in_bytes(t, is_leaf);
+    }
+
+    template <typename K, typename V>
+    bool BPlusTreeNode<K, V>::fits(const K* sorted_keys, const int32_t count) const {
+        if (count > max_keys())
+            return false;
+        if (!packed_keys || count == 0)
+            return true;
+        auto bits = delta_bits(sorted_keys[0], sorted_keys[count - 1]);
+        return packed_size_in_bytes(count, bits) <= packed_keys_size_in_bytes(t, is_leaf);
+    }
+
+    template <typename K, typename V>
+    int32_t BPlusTreeNode<K, V>::find_key_pos(const K key) const {
+        auto begin = keys.begin();
+        return static_cast<int32_t>(std::distance(begin, std::lower_bound(begin, begin + used_keys, key)));
+    }
+
+    template <typename K, typename V>
+    int32_t BPlusTreeNode<K, V>::find_child_idx(const K key) const {
+        // the separator keys[i] is the min key of the child (i + 1)
+        auto begin = keys.begin();
+        return static_cast<int32_t>(std::distance(begin, std::upper_bound(begin, begin + used_keys, key)));
+    }
+
+    template <typename K, typename V>
+    void BPlusTreeNode<K, V>::insert_entry(const int32_t idx, const K key, const int64_t pos) {
+        shift_right_by_one(keys, used_keys, idx);
+        shift_right_by_one(entry_pos, used_keys, idx);
+        keys[idx] = key;
+        entry_pos[idx] = pos;
+        ++used_keys;
+    }
+
+    template <typename K, typename V>
+    void BPlusTreeNode<K, V>::insert_child(const int32_t idx, const K key, const int64_t pos) {
+        // the KEY separates the child (idx) and the new child (idx + 1)
+        shift_right_by_one(keys, used_keys, idx);
+        shift_right_by_one(child_pos, used_keys + 1, idx + 1);
+        keys[idx] = key;
+        child_pos[idx + 1] = pos;
+        ++used_keys;
+    }
+
+    template <typename K, typename V>
+    void BPlusTreeNode<K, V>::erase_entry(const int32_t idx) {
+        shift_left_by_one(keys, idx + 1, used_keys);
+        shift_left_by_one(entry_pos, idx + 1, used_keys);
+        --used_keys;
+    }
+
+    template <typename K, typename V>
+    void BPlusTreeNode<K, V>::erase_child(const int32_t idx) {
+        // erase the separator (idx) and the child (idx + 1) on the right of it
+        shift_left_by_one(keys, idx + 1, used_keys);
+        shift_left_by_one(child_pos, idx + 2, used_keys + 1);
+        --used_keys;
+    }
+}
@@ -3,9 +3,11 @@
 #include <type_traits>
 #include <cstdint>
 #include <optional>
+#include <vector>
 
 #include "entry.h"
 #include "btree_node.h"
+#include "btree_cursor.h"
 #include "utils/forward_decl.h"
 
 namespace btree {
@@ -28,6 +30,41 @@ namespace btree {
         void set(IOManagerT& io, const K key, ValueType value);
         void set(IOManagerT& io, const K key, const V& value, const int32_t size);
         bool remove(IOManagerT& io, const K key);
+        /** The entry of KEY or an invalid entry, the value isn't copied from the mapping */
+        EntryT find(IOManagerT& io, const K key) const;
+
+        template <typename Func>
+        void find_batch(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const;
+
+        /**
+         * FIND_BATCH by levels: all the nodes of a level are prefetched (advised or read by io_uring into the buffer
+         * pool, see IOManager::complete_prefetch) before any of them is read, so they're read from the disk together
+         */
+        template <typename Func>
+        void find_batch_by_levels(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const;
+
+        /** Reads ahead the nodes and the entries of SORTED_KEYS level by level, see FIND_BATCH_BY_LEVELS */
+        void prefetch(IOManagerT& io, const K* sorted_keys, const size_t n) const;
+
+        BTreeCursor<K, V> cursor(IOManagerT& io) const;
+
+        /**
+         * Lock-free lookup for the concurrent readers: the nodes are read in place with optimistic lock coupling
+         * (see VersionLatches), the in-memory root isn't used. ON_ENTRY gets the entry of KEY if it's found.
+         * Returns false if a writer has modified the path meanwhile: the result is discarded and the lookup is retried.
+         */
+        template <typename Func>
+        static bool find_optimistic(const IOManagerT& io, const VersionLatches& latches, const K key, Func&& on_entry);
+
+        /**
+         * Reads the entry of KEY at ENTRY_POS referenced from the node at NODE_POS of the validated NODE_VERSION
+         * in a tree of FORMAT_VERSION
+         */
+        template <typename Func>
+        static bool read_entry_optimistic(const IOManagerT& io, const VersionLatches& latches,
+                                          const uint8_t format_version, const int64_t node_pos,
+                                          const uint64_t node_version, const K key, const int64_t entry_pos,
+                                          Func& on_entry);
     private:
         void insert(IOManagerT& io, const EntryT& e);
 
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+#include "utils/forward_decl.h"
+
+namespace btree {
+    /**
+     * Bottom-up BTree builder for sorted unique keys which entries are already written to the file.
+     * The number of keys is known in advance, so the size of every node is planned before the build:
+     *  - nodes are packed up to (2 * t - 1) keys, the keys are spread evenly among the nodes of a level
+     *  - every non-root node gets at least (t - 1) keys, so the tree is a valid BTree without any rebalancing
+     * Only one open node per level is kept in memory, every node is written once when it's complete.
+     */
+    template <typename K, typename V>
+    class BTreeBuilder final {
+        using Node = BTreeNode<K, V>;
+        using IOManagerT = IOManager<K, V>;
+
+        struct Level {
+            int64_t total_keys;  // keys of the level without separators that go to the parent level
+            int64_t nodes;
+            int64_t node_idx;
+            Node node;
+
+            int32_t target_keys() const {
+                auto extra = (node_idx < total_keys % nodes) ? 1 : 0;
+                return static_cast<int32_t>(total_keys / nodes + extra);
+            }
+        };
+
+        IOManagerT& io;
+        const int16_t t;
+        std::vector<Level> levels;
+    public:
+        BTreeBuilder(IOManagerT& io, const int16_t t, const int64_t keys_count) : io(io), t(t) {
+            // N items of a level form M nodes and (M - 1) separators, a node with the separator takes up to 2 * t items
+            int64_t items = keys_count;
+            while (items > 0) {
+                int64_t nodes = (items + 2 * t) / (2 * t);
+                levels.push_back(Level{ items - (nodes - 1), nodes, 0, Node(t, levels.empty()) });
+                items = nodes - 1;
+            }
+        }
+
+        /** Keys must be passed in strictly ascending order */
+        void add(const K key, const int64_t entry_pos) {
+            push(0, key, entry_pos, IOManagerT::INVALID_POS);
+        }
+
+        /** Returns the root position or INVALID_POS for an empty tree */
+        int64_t finish() {
+            if (levels.empty())
+                return IOManagerT::INVALID_POS;
+
+            for (size_t i = 0; i + 1 < levels.size(); ++i) {
+                auto pos = write_node(levels[i].node);
+                Node& parent = levels[i + 1].node;
+                parent.child_pos[parent.used_keys] = pos;
+            }
+            return write_node(levels.back().node);
+        }
+
+    private:
+        void push(const size_t level_idx, const K key, const int64_t entry_pos, const int64_t left_child_pos) {
+            Level& level = levels[level_idx];
+            Node& node = level.node;
+            if (!node.is_leaf)
+                node.child_pos[node.used_keys] = left_child_pos;
+
+            // The node is complete: the key is a separator between it and the next node
+            if (node.used_keys == level.target_keys()) {
+                auto pos = write_node(node);
+                node = Node(t, node.is_leaf);
+                ++level.node_idx;
+                push(level_idx + 1, key, entry_pos, pos);
+                return;
+            }
+
+            node.keys[node.used_keys] = key;
+            node.key_pos[node.used_keys] = entry_pos;
+            ++node.used_keys;
+        }
+
+        int64_t write_node(Node& node) {
+            node.m_pos = io.allocate_node();
+            io.write_node(node, node.m_pos);
+            return node.m_pos;
+        }
+    };
+}
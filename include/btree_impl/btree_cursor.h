@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+#include "utils/forward_decl.h"
+
+namespace btree {
+    /**
+     * In-order cursor over the BTree.
+     * It keeps the path from the root to the current key, so each step reads O(1) nodes on average.
+     * Any modification of the tree invalidates the cursor.
+     */
+    template <typename K, typename V>
+    class BTreeCursor final {
+        using Node = BTreeNode<K, V>;
+        using EntryT = typename BTree<K, V>::EntryT;
+        using IOManagerT = IOManager<K, V>;
+
+        IOManagerT* io;
+        Node root;
+        // The last element is the node with the current key and its index,
+        // the others are the ancestors with the index of the child the path goes through
+        std::vector<std::pair<Node, int32_t>> path;
+    public:
+        BTreeCursor(IOManagerT& io, const Node& root);
+
+        bool valid() const;
+        K key() const;
+        EntryT entry() const;
+
+        bool seek(const K key);
+        bool seek_to_first();
+        bool seek_to_last();
+        bool next();
+        bool prev();
+    private:
+        void descend_to_leftmost(Node node);
+        void descend_to_rightmost(Node node);
+        void ascend_forward();
+        void ascend_backward();
+    };
+}
+
+#include "btree_impl/btree_cursor_impl.h"
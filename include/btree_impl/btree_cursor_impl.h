@@ -0,0 +1,132 @@
+#pragma once
+
+namespace btree {
+    template <typename K, typename V>
+    BTreeCursor<K, V>::BTreeCursor(IOManagerT& io, const Node& root) : io(&io), root(root) {}
+
+    template <typename K, typename V>
+    bool BTreeCursor<K, V>::valid() const {
+        return !path.empty();
+    }
+
+    template <typename K, typename V>
+    K BTreeCursor<K, V>::key() const {
+        const auto& [node, idx] = path.back();
+        return node.keys[idx];
+    }
+
+    template <typename K, typename V>
+    typename BTree<K, V>::EntryT BTreeCursor<K, V>::entry() const {
+        const auto& [node, idx] = path.back();
+        return io->read_entry(node.keys[idx], node.key_pos[idx]);
+    }
+
+    template <typename K, typename V>
+    bool BTreeCursor<K, V>::seek(const K key) {
+        path.clear();
+        if (!root.is_valid())
+            return false;
+
+        Node curr = root;
+        while (true) {
+            auto begin = curr.keys.begin();
+            auto idx = static_cast<int32_t>(std::distance(begin, std::lower_bound(begin, begin + curr.used_keys, key)));
+            bool found = idx < curr.used_keys && curr.keys[idx] == key;
+            if (found || curr.is_leaf) {
+                path.emplace_back(std::move(curr), idx);
+                // All keys in the leaf are less than KEY, the next one is in the ancestors
+                if (!found && idx == path.back().first.used_keys)
+                    ascend_forward();
+                return valid();
+            }
+            Node child = io->read_node(curr.child_pos[idx]);
+            path.emplace_back(std::move(curr), idx);
+            curr = std::move(child);
+        }
+    }
+
+    template <typename K, typename V>
+    bool BTreeCursor<K, V>::seek_to_first() {
+        path.clear();
+        if (root.is_valid())
+            descend_to_leftmost(root);
+        return valid();
+    }
+
+    template <typename K, typename V>
+    bool BTreeCursor<K, V>::seek_to_last() {
+        path.clear();
+        if (root.is_valid())
+            descend_to_rightmost(root);
+        return valid();
+    }
+
+    template <typename K, typename V>
+    bool BTreeCursor<K, V>::next() {
+        auto& [node, idx] = path.back();
+        if (!node.is_leaf) {
+            // The next key is the leftmost one in the right subtree
+            ++idx;
+            descend_to_leftmost(io->read_node(node.child_pos[idx]));
+        } else if (idx + 1 < node.used_keys) {
+            ++idx;
+        } else {
+            ascend_forward();
+        }
+        return valid();
+    }
+
+    template <typename K, typename V>
+    bool BTreeCursor<K, V>::prev() {
+        auto& [node, idx] = path.back();
+        if (!node.is_leaf) {
+            // The previous key is the rightmost one in the left subtree
+            descend_to_rightmost(io->read_node(node.child_pos[idx]));
+        } else if (idx > 0) {
+            --idx;
+        } else {
+            ascend_backward();
+        }
+        return valid();
+    }
+
+    template <typename K, typename V>
+    void BTreeCursor<K, V>::descend_to_leftmost(Node node) {
+        while (!node.is_leaf) {
+            Node child = io->read_node(node.child_pos[0]);
+            path.emplace_back(std::move(node), 0);
+            node = std::move(child);
+        }
+        path.emplace_back(std::move(node), 0);
+    }
+
+    template <typename K, typename V>
+    void BTreeCursor<K, V>::descend_to_rightmost(Node node) {
+        while (!node.is_leaf) {
+            Node child = io->read_node(node.child_pos[node.used_keys]);
+            int32_t idx = node.used_keys;
+            path.emplace_back(std::move(node), idx);
+            node = std::move(child);
+        }
+        int32_t idx = node.used_keys - 1;
+        path.emplace_back(std::move(node), idx);
+    }
+
+    template <typename K, typename V>
+    void BTreeCursor<K, V>::ascend_forward() {
+        // Leave the finished subtree: the ancestor's key after the child is the next one
+        path.pop_back();
+        while (!path.empty() && path.back().second == path.back().first.used_keys)
+            path.pop_back();
+    }
+
+    template <typename K, typename V>
+    void BTreeCursor<K, V>::ascend_backward() {
+        // Leave the finished subtree: the ancestor's key before the child is the previous one
+        path.pop_back();
+        while (!path.empty() && path.back().second == 0)
+            path.pop_back();
+        if (!path.empty())
+            --path.back().second;
+    }
+}
@@ -31,8 +31,12 @@ namespace btree {
 
     template <typename K, typename V>
     std::optional<V> BTree<K, V>::get(IOManagerT& io, const K key) const {
-        EntryT res = root.is_valid() ? root.find(io, key) : EntryT{};
-        return res.value();
+        return find(io, key).value();
+    }
+
+    template <typename K, typename V>
+    typename BTree<K, V>::EntryT BTree<K, V>::find(IOManagerT& io, const K key) const {
+        return root.is_valid() ? root.find(io, key) : EntryT{};
     }
 
     template <typename K, typename V>
@@ -41,9 +45,127 @@ namespace btree {
         return success;
     }
 
+    template <typename K, typename V>
+    template <typename Func>
+    void BTree<K, V>::find_batch(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const {
+        if (root.is_valid())
+            root.find_batch(io, sorted_keys, 0, n, on_found);
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    void BTree<K, V>::find_batch_by_levels(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const {
+        if (!root.is_valid())
+            return;
+
+        // The next node of every key, the keys are sorted, so the keys of one node are adjacent
+        std::vector<int64_t> node_pos(n, root.m_pos);
+        for (bool has_next_level = n > 0; has_next_level;) {
+            for (size_t i = 0; i < n; ++i)
+                if (node_pos[i] != IOManagerT::INVALID_POS && (i == 0 || node_pos[i] != node_pos[i - 1]))
+                    io.prefetch_node(node_pos[i]);
+            io.complete_prefetch();
+
+            has_next_level = false;
+            for (size_t i = 0; i < n; ++i) {
+                if (node_pos[i] == IOManagerT::INVALID_POS)
+                    continue;
+                auto node = io.view_node(node_pos[i]);
+                auto idx = node.lower_bound(sorted_keys[i]);
+                bool is_found = node.has_key(idx, sorted_keys[i]);
+                if (is_found)
+                    on_found(i, node.entry_pos(idx));
+                if (is_found || node.is_leaf()) {
+                    node_pos[i] = IOManagerT::INVALID_POS;
+                    continue;
+                }
+                node_pos[i] = node.child_pos(idx);
+                has_next_level = true;
+            }
+        }
+    }
+
+    template <typename K, typename V>
+    void BTree<K, V>::prefetch(IOManagerT& io, const K* sorted_keys, const size_t n) const {
+        find_batch_by_levels(io, sorted_keys, n, [&io](const size_t, const int64_t entry_pos) {
+            io.prefetch_entry(entry_pos);
+        });
+        io.complete_prefetch();
+    }
+
+    template <typename K, typename V>
+    BTreeCursor<K, V> BTree<K, V>::cursor(IOManagerT& io) const {
+        return BTreeCursor<K, V>(io, root);
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    bool BTree<K, V>::find_optimistic(const IOManagerT& io, const VersionLatches& latches, const K key, Func&& on_entry) {
+        auto parent_pos = IOManagerT::HEADER_POS;
+        auto parent_version = latches.read_version(parent_pos);
+        if (VersionLatches::is_latched(parent_version))
+            return false;
+
+        auto [pos, format_version] = io.read_root_pos_and_format();
+        while (pos != IOManagerT::INVALID_POS) {
+            // Coupling: the parent is still valid when the version of the child is taken
+            auto version = latches.read_version(pos);
+            if (VersionLatches::is_latched(version) || !latches.validate(parent_pos, parent_version))
+                return false;
+
+            // The node is read in place: what's taken from it is used only after its version is validated
+            auto node = io.try_view_node(pos, format_version);
+            if (!node)
+                return false;
+            auto idx = node->lower_bound(key);
+            bool has_key = node->has_key(idx, key);
+            bool is_leaf = node->is_leaf();
+            auto next_pos = has_key ? node->entry_pos(idx) : (is_leaf ? IOManagerT::INVALID_POS : node->child_pos(idx));
+            if (!latches.validate(pos, version))
+                return false;
+
+            if (has_key)
+                return read_entry_optimistic(io, latches, format_version, pos, version, key, next_pos, on_entry);
+            if (is_leaf)
+                return true;
+
+            parent_pos = pos;
+            parent_version = version;
+            pos = next_pos;
+        }
+        return latches.validate(parent_pos, parent_version);
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    bool BTree<K, V>::read_entry_optimistic(const IOManagerT& io, const VersionLatches& latches,
+                                            const uint8_t format_version, const int64_t node_pos,
+                                            const uint64_t node_version, const K key, const int64_t entry_pos,
+                                            Func& on_entry) {
+        // An inline value is a part of the validated node
+        if (IOManagerT::has_inline_values(format_version)) {
+            on_entry(*io.try_read_entry(key, entry_pos, format_version));
+            return true;
+        }
+
+        auto version = latches.read_version(entry_pos);
+        if (VersionLatches::is_latched(version) || !latches.validate(node_pos, node_version))
+            return false;
+
+        auto entry = io.try_read_entry(key, entry_pos, format_version);
+        if (!entry)
+            return false;
+        // The entry may be torn, it's used only if both versions are still valid
+        on_entry(*entry);
+        return latches.validate(entry_pos, version) && latches.validate(node_pos, node_version);
+    }
+
     template <typename K, typename V>
     bool BTree<K, V>::remove(IOManagerT& io, const K key) {
-        bool success = root.is_valid() && root.remove(io, key);
+        int64_t entry_pos = IOManagerT::INVALID_POS;
+        bool success = root.is_valid() && root.remove(io, key, &entry_pos);
+        if (success)
+            io.free_entry(entry_pos);
 
         if (success && root.used_keys == 0) {
             if (root.is_leaf) {
@@ -52,6 +174,7 @@ namespace btree {
             } else {
                 auto pos = root.child_pos[0];
                 io.write_new_pos_for_root_node(pos);
+                io.free_node(root.m_pos);
                 root = io.read_node(pos);
             }
         }
@@ -63,32 +186,34 @@ namespace btree {
     void BTree<K, V>::insert(IOManagerT& io, const EntryT& e) {
         if (!root.is_valid()) {
             // write header
-            auto root_pos = io.write_header();
+            io.write_header();
 
             root = Node(t, true);
-            root.m_pos = root_pos;
+            root.m_pos = io.allocate_node();
             root.used_keys++;
 
-            auto entry_pos = root.m_pos + Node::get_node_size_in_bytes(t);
+            auto entry_pos = io.allocate_entry(e);
+            root.keys[0] = e.key;
             root.key_pos[0] = entry_pos;
 
             // write node root and key|value
             io.write_node(root, root.m_pos);
             io.write_entry(e, entry_pos);
+            io.write_new_pos_for_root_node(root.m_pos);
         } else {
             if (root.is_full()) {
                 Node newRoot(t, false);
                 newRoot.child_pos[0] = root.m_pos;
 
                 // Write node
-                newRoot.m_pos = io.get_file_pos_end();
+                newRoot.m_pos = io.allocate_node();
                 io.write_node(newRoot, newRoot.m_pos);
 
                 newRoot.split_child(io, 0, root);
 
                 // Find the child have new key
                 int32_t i = 0;
-                K root_key = newRoot.get_key(io, 0);
+                K root_key = newRoot.get_key(0);
                 if (root_key < e.key)
                     i++;
 
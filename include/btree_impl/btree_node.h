@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 
 #include "utils/forward_decl.h"
 
@@ -11,6 +12,7 @@ namespace btree {
         int16_t t;
         uint8_t is_leaf;
         int64_t m_pos;
+        std::vector<K> keys;
         std::vector<int64_t> key_pos;
         std::vector<int64_t> child_pos;
 
@@ -22,10 +24,15 @@ namespace btree {
         BTreeNode(const int16_t& t, bool isLeaf);
 
         bool set(IOManagerT& io_manager, const EntryT& e);
-        bool remove(IOManagerT& io_manager, const K key);
+        /** REMOVED_ENTRY_POS gets the position of the entry of KEY */
+        bool remove(IOManagerT& io_manager, const K key, int64_t* removed_entry_pos = nullptr);
 
         EntryT find(IOManagerT& io_manager, const K key) const;
-        K get_key(IOManagerT& io_manager, const int32_t idx) const;
+
+        /** Calls ON_FOUND(i, entry_pos) for each key of the sorted BATCH[first, last) found in the subtree */
+        template <typename Func>
+        void find_batch(IOManagerT& io_manager, const K* batch, const size_t first, const size_t last, Func& on_found) const;
+        K get_key(const int32_t idx) const;
 
         static constexpr int32_t get_node_size_in_bytes(const int16_t t);
         bool is_full() const;
@@ -37,7 +44,7 @@ namespace btree {
         static constexpr int32_t max_key_num(const int16_t t);
         static constexpr int32_t max_child_num(const int16_t t);
 
-        int32_t find_key_bin_search(IOManagerT& io_manager, const K key) const;
+        int32_t find_key_bin_search(const K key) const;
         std::tuple<BTreeNode, EntryT, int32_t> find_leaf_node_with_key(IOManagerT& io_manager, const K key) const;
 
         EntryT get_entry(IOManagerT& io_manager, const int32_t idx) const;
@@ -46,8 +53,8 @@ namespace btree {
         bool remove_from_leaf(IOManagerT& io_manager, const int32_t idx);
         bool remove_from_non_leaf(IOManagerT& io_manager, const int32_t idx);
 
-        int64_t get_prev_entry_pos(IOManagerT& io_manager, const int32_t idx) const;
-        int64_t get_next_entry_pos(IOManagerT& io_manager, const int32_t idx) const;
+        std::pair<K, int64_t> get_prev_entry(IOManagerT& io_manager, const int32_t idx) const;
+        std::pair<K, int64_t> get_next_entry(IOManagerT& io_manager, const int32_t idx) const;
 
         void merge_node(IOManagerT& io_manager, const int32_t idx);
         void fill_node(IOManagerT& io_manager, const int32_t idx);
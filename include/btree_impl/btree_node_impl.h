@@ -11,6 +11,7 @@ namespace btree {
             t(0),
             is_leaf(false),
             m_pos(-1),
+            keys(0, -1),
             key_pos(0, -1),
             child_pos(0, -1) {}
 
@@ -20,6 +21,7 @@ namespace btree {
             t(t),
             is_leaf(is_leaf),
             m_pos(-1),
+            keys(max_key_num(t), -1),
             key_pos(max_key_num(t), -1),
             child_pos(max_child_num(t), -1) {}
 
@@ -40,6 +42,7 @@ namespace btree {
         return static_cast<int32_t>(
                 sizeof(used_keys) +
                 sizeof(is_leaf) +
+                max_key_num(t) * sizeof(K) +
                 max_key_num(t) * sizeof(m_pos) +
                 max_child_num(t) * sizeof(m_pos));
     }
@@ -52,6 +55,7 @@ namespace btree {
 
         // Copy the last (t-1) keys of divided node to new_node
         for (auto i = 0; i < t - 1; ++i) {
+            new_node.keys[i] = curr_node.keys[i + t];
             new_node.key_pos[i] = curr_node.key_pos[i + t];
             curr_node.key_pos[i + t] = -1;
         }
@@ -64,7 +68,7 @@ namespace btree {
         }
 
         // write new node
-        new_node.m_pos = manager.get_file_pos_end();
+        new_node.m_pos = manager.allocate_node();
         manager.write_node(new_node, new_node.m_pos);
 
         // write current node
@@ -73,9 +77,11 @@ namespace btree {
 
         // Shift children, keys and values to right
         shift_right_by_one(child_pos, used_keys + 1, idx + 1);
+        shift_right_by_one(keys, used_keys, idx);
         shift_right_by_one(key_pos, used_keys, idx);
 
         // set the key-divider
+        keys[idx] = curr_node.keys[t - 1];
         key_pos[idx] = curr_node.key_pos[t - 1];
         child_pos[idx + 1] = new_node.m_pos;
         ++used_keys;
@@ -85,11 +91,11 @@ namespace btree {
     }
 
     template <typename K, typename V>
-    K BTreeNode<K, V>::get_key(IOManagerT& io, const int32_t idx) const {
+    K BTreeNode<K, V>::get_key(const int32_t idx) const {
         if (idx < 0 || idx > used_keys - 1)
             return IOManagerT::INVALID_POS;
 
-        return io.read_key(key_pos[idx]);
+        return keys[idx];
     }
 
     template <typename K, typename V>
@@ -97,7 +103,7 @@ namespace btree {
         if (idx < 0 || idx > used_keys - 1)
             return EntryT();
 
-        return io.read_entry(key_pos[idx]);
+        return io.read_entry(keys[idx], key_pos[idx]);
     }
 
     template <typename K, typename V>
@@ -112,15 +118,17 @@ namespace btree {
     void BTreeNode<K, V>::insert_non_full(IOManagerT& io, const EntryT& e) {
         if (is_leaf) {
             auto idx = used_keys - 1;
-            K curr_key = get_key(io, idx);
+            K curr_key = get_key(idx);
 
             while (idx >= 0 && curr_key > e.key) {
+                keys[idx + 1] = keys[idx];
                 key_pos[idx + 1] = key_pos[idx];
                 idx--;
-                curr_key = get_key(io, idx);
+                curr_key = get_key(idx);
             }
 
-            auto pos = io.get_file_pos_end(); // go to the end after reading entries
+            auto pos = io.allocate_entry(e);
+            keys[idx + 1] = e.key;
             key_pos[idx + 1] = pos;
             ++used_keys;
 
@@ -128,12 +136,12 @@ namespace btree {
             io.write_node(*this, m_pos);
             io.write_entry(e, pos);
         } else {
-            auto idx = find_key_bin_search(io, e.key);
+            auto idx = find_key_bin_search(e.key);
             Node node = get_child(io, idx);
 
             if (node.is_full()) {
                 split_child(io, idx, node);
-                K curr_key = get_key(io, idx);
+                K curr_key = get_key(idx);
                 if (curr_key < e.key)
                     idx++;
             }
@@ -144,42 +152,58 @@ namespace btree {
     }
 
     template <typename K, typename V>
-    int32_t BTreeNode<K, V>::find_key_bin_search(IOManagerT& io, const K key) const {
-        int32_t left = 0;
-        int32_t right = used_keys - 1;
-        int32_t mid = 0;
-        K tmp_key;
-
-        while (left <= right) {
-            mid = left + (right - left) / 2;
-            tmp_key = get_key(io, mid);
-
-            if (tmp_key < key)
-                left = mid + 1;
-            else if (tmp_key > key)
-                right = mid - 1;
-            else
-                return mid;
-        }
+    int32_t BTreeNode<K, V>::find_key_bin_search(const K key) const {
+        // Keys are stored inline in the node, so the search doesn't touch any entry
+        auto begin = keys.begin();
+        auto pos = std::lower_bound(begin, begin + used_keys, key);
+        return static_cast<int32_t>(std::distance(begin, pos));
+    }
 
-        return right + 1;
+    template <typename K, typename V>
+    typename BTree<K,V>::EntryT BTreeNode<K, V>::find(IOManagerT& io, const K key) const {
+        auto idx = find_key_bin_search(key);
+        if (idx < used_keys && keys[idx] == key)
+            return get_entry(io, idx);
+        if (is_leaf)
+            return EntryT();
 
-        // todo: to replace bin search with lower_bound ?
-        //    auto begin = key_pos.begin();
-        //    auto pos = std::lower_bound(begin, begin + used_keys, key,
-        //                                [&io](const int64_t& pos, const K & key){
-        //                                    return io.read_entry(pos).key < key;
-        //                                });
-        //    return std::distance(begin, pos);
+        // The nodes below are searched in place: the lookup doesn't copy them
+        auto node = io.view_node(child_pos[idx]);
+        for (idx = node.lower_bound(key); !node.has_key(idx, key); idx = node.lower_bound(key)) {
+            if (node.is_leaf())
+                return EntryT();
+            node = io.view_node(node.child_pos(idx));
+        }
+        return io.read_entry(key, node.entry_pos(idx));
     }
 
     template <typename K, typename V>
-    typename BTree<K,V>::EntryT BTreeNode<K, V>::find(IOManagerT& io, const K key) const {
-        const auto&[curr, entry, idx] = find_leaf_node_with_key(io, key);
-        if (entry.key == key)
-            return entry;
+    template <typename Func>
+    void BTreeNode<K, V>::find_batch(IOManagerT& io, const K* batch, const size_t first, const size_t last, Func& on_found) const {
+        auto begin = keys.begin();
+        auto end = begin + used_keys;
+        auto lower = begin;
+        for (size_t i = first; i < last;) {
+            // The batch is sorted, so the search continues from the previous position
+            lower = std::lower_bound(lower, end, batch[i]);
+            auto idx = static_cast<int32_t>(std::distance(begin, lower));
+            if (lower != end && *lower == batch[i]) {
+                on_found(i, key_pos[idx]);
+                ++i;
+                continue;
+            }
+            if (is_leaf) {
+                ++i;
+                continue;
+            }
 
-        return EntryT();
+            // All keys less than the separator go to the same child with one node read
+            size_t j = i + 1;
+            while (j < last && (lower == end || batch[j] < *lower))
+                ++j;
+            get_child(io, idx).find_batch(io, batch, i, j, on_found);
+            i = j;
+        }
     }
 
     template <typename K, typename V>
@@ -187,8 +211,10 @@ namespace btree {
         auto [curr, entry, idx] = find_leaf_node_with_key(io, e.key);
         if (entry.key == e.key) {
             if (entry != e) {
-                auto curr_pos = io.get_file_pos_end();
-                curr.key_pos[idx] = curr_pos;
+                // The old entry is freed first: the new one may take its place
+                io.free_entry(curr.key_pos[idx]);
+                auto curr_pos = io.allocate_entry(e);
+                curr.key_pos[idx] = curr_pos;  // the key stays the same, only the entry is moved
 
                 io.write_entry(e, curr_pos);
                 io.write_node(curr, curr.m_pos);
@@ -201,15 +227,18 @@ namespace btree {
     }
 
     template <typename K, typename V>
-    bool BTreeNode<K, V>::remove(IOManagerT& io, const K key) {
+    bool BTreeNode<K, V>::remove(IOManagerT& io, const K key, int64_t* removed_entry_pos) {
         auto writeOnExit = [&io](const Node& node, const auto pos, bool success) -> bool {
             io.write_node(node, pos);
             return success;
         };
 
-        auto idx = find_key_bin_search(io, key);
-        K curr_key = get_key(io, idx);
+        auto idx = find_key_bin_search(key);
+        K curr_key = get_key(idx);
         if (idx < used_keys && curr_key == key) {
+            // The entries of the keys moved from the subtrees stay alive, only the entry of KEY is removed
+            if (removed_entry_pos)
+                *removed_entry_pos = key_pos[idx];
             bool success = is_leaf ? remove_from_leaf(io, idx) : remove_from_non_leaf(io, idx);
             return writeOnExit(*this, m_pos, success);
         }
@@ -227,7 +256,7 @@ namespace btree {
         child = get_child(io, child_idx);
 
         if (child.is_valid()) {
-            bool success = child.remove(io, key);
+            bool success = child.remove(io, key, removed_entry_pos);
             return writeOnExit(child, child.m_pos, success);
         }
 
@@ -237,6 +266,7 @@ namespace btree {
     template <typename K, typename V>
     bool BTreeNode<K, V>::remove_from_leaf(IOManagerT& io, const int32_t idx) {
         // shift to the left by 1 all the keys after the pos
+        shift_left_by_one(keys, idx + 1, used_keys);
         shift_left_by_one(key_pos, idx + 1, used_keys);
         --used_keys;
         return true;
@@ -254,9 +284,9 @@ namespace btree {
         // 2. Replace keys[pos], values[pos] by the PREVIOUS[key|value].
         // 3. Recursively delete PREVIOUS in child[pos].
         if (Node child = get_child(io, idx); child.used_keys >= t) {
-            auto curr_pos = get_prev_entry_pos(io, idx);
+            auto [key, curr_pos] = get_prev_entry(io, idx);
+            keys[idx] = key;
             key_pos[idx] = curr_pos;
-            K key = io.read_key(curr_pos);
             return onExit(child, key);
         }
 
@@ -265,9 +295,9 @@ namespace btree {
         // 2. Replace keys[pos], values[pos] by the NEXT[key|value].
         // 3. Recursively delete NEXT in child[pos + 1].
         if (Node child = get_child(io, idx + 1); child.used_keys >= t) {
-            auto curr_pos = get_next_entry_pos(io, idx);
+            auto [key, curr_pos] = get_next_entry(io, idx);
+            keys[idx] = key;
             key_pos[idx] = curr_pos;
-            K key = io.read_key(curr_pos);
             return onExit(child, key);
         }
 
@@ -275,30 +305,30 @@ namespace btree {
         // 2. Merge key and child[pos + 1] into child[pos].
         // 3. Now child[pos] has (2 * t - 1) keys
         // 4. Recursively delete KEY from child[pos]
-        K key = get_key(io, idx);
+        K key = get_key(idx);
         merge_node(io, idx);
         Node curr = get_child(io, idx);
         return onExit(curr, key);
     }
 
     template <typename K, typename V>
-    int64_t BTreeNode<K, V>::get_prev_entry_pos(IOManagerT& io, const int32_t idx) const {
+    std::pair<K, int64_t> BTreeNode<K, V>::get_prev_entry(IOManagerT& io, const int32_t idx) const {
         Node curr = io.read_node(child_pos[idx]);
         // Keep moving to the right most node until CURR becomes a leaf
         while (!curr.is_leaf)
             curr = io.read_node(curr.child_pos[curr.used_keys]);
 
-        return curr.key_pos[curr.used_keys - 1];
+        return { curr.keys[curr.used_keys - 1], curr.key_pos[curr.used_keys - 1] };
     }
 
     template <typename K, typename V>
-    int64_t BTreeNode<K, V>::get_next_entry_pos(IOManagerT& io, const int32_t idx) const {
+    std::pair<K, int64_t> BTreeNode<K, V>::get_next_entry(IOManagerT& io, const int32_t idx) const {
         Node curr = io.read_node(child_pos[idx + 1]);
         // Keep moving the left most node until CURR becomes a leaf
         while (!curr.is_leaf)
             curr = io.read_node(curr.child_pos[0]);
 
-        return curr.key_pos[0];
+        return { curr.keys[0], curr.key_pos[0] };
     }
 
     template <typename K, typename V>
@@ -307,11 +337,14 @@ namespace btree {
         Node next_child = get_child(io, idx + 1);
 
         // Set the key from CURR node to (t-1)th pos of child
+        child.keys[t - 1] = keys[idx];
         child.key_pos[t - 1] = key_pos[idx];
 
         // Copy all keys from NEXT to CHILD
-        for (auto i = 0; i < next_child.used_keys; ++i)
+        for (auto i = 0; i < next_child.used_keys; ++i) {
+            child.keys[i + t] = next_child.keys[i];
             child.key_pos[i + t] = next_child.key_pos[i];
+        }
 
         // Copy all children from NEXT to CHILD
         if (!child.is_leaf) {
@@ -325,10 +358,11 @@ namespace btree {
         // write node
         io.write_node(child, child_pos[idx]);
 
-        // write node
-        io.write_node(next_child, child_pos[idx + 1]);
+        // NEXT is empty now
+        io.free_node(child_pos[idx + 1]);
 
         // Update KEYs and CHILDREN for CURR
+        shift_left_by_one(keys, idx + 1, used_keys);
         shift_left_by_one(key_pos, idx + 1, used_keys);
         shift_left_by_one(child_pos, idx + 2, used_keys + 1);
         used_keys--;
@@ -368,11 +402,13 @@ namespace btree {
         Node child = get_child(io, idx);
 
         // Move keys and children
+        shift_right_by_one(child.keys, child.used_keys, 0);
         shift_right_by_one(child.key_pos, child.used_keys, 0);
         if (!child.is_leaf)
             shift_right_by_one(child.child_pos, child.used_keys + 1, 0);
 
         // Set CURR's key_pos to the first CHILD's key_pos
+        child.keys[0] = keys[idx - 1];
         child.key_pos[0] = key_pos[idx - 1];
 
         // Set PREV's last child_pos to the first CHILD's child_pos
@@ -380,6 +416,7 @@ namespace btree {
             child.child_pos[0] = prev.child_pos[prev.used_keys];
 
         // Set PREV's key_pos to CURR's key_pos
+        keys[idx - 1] = prev.keys[prev.used_keys - 1];
         key_pos[idx - 1] = prev.key_pos[prev.used_keys - 1];
 
         child.used_keys++;
@@ -396,6 +433,7 @@ namespace btree {
         Node next = get_child(io, idx + 1);
 
         // Set CURR's key_pos to the last CHILD's key_pos
+        child.keys[child.used_keys] = keys[idx];
         child.key_pos[child.used_keys] = key_pos[idx];
 
         //  Set NEXT's first child to the last CHILD's child_pos
@@ -403,9 +441,11 @@ namespace btree {
             child.child_pos[child.used_keys + 1] = next.child_pos[0];
 
         // Set the first NEXT's key to CURR's key_pos
+        keys[idx] = next.keys[0];
         key_pos[idx] = next.key_pos[0];
 
         // Move keys and children
+        shift_left_by_one(next.keys, 1, next.used_keys);
         shift_left_by_one(next.key_pos, 1, next.used_keys);
         if (!next.is_leaf)
             shift_left_by_one(next.child_pos, 1, next.used_keys + 1);
@@ -431,18 +471,23 @@ namespace btree {
     template <typename K, typename V>
     std::tuple<BTreeNode<K,V>, typename BTree<K,V>::EntryT, int32_t>
     BTreeNode<K,V>::find_leaf_node_with_key(IOManagerT& io, const K key) const {
-        Node curr = *this;
-
-        while (!curr.is_leaf) {
-            int32_t idx = curr.find_key_bin_search(io, key);
-            EntryT tmp = curr.get_entry(io, idx);
-            if (tmp.key == key)
-                return std::make_tuple(curr, tmp, idx);
-            curr = curr.get_child(io, idx);
+        auto idx = find_key_bin_search(key);
+        bool found = idx < used_keys && keys[idx] == key;
+        if (found || is_leaf)
+            return std::make_tuple(*this, found ? get_entry(io, idx) : EntryT(), idx);
+
+        // The path is searched in place, only the node with the key (or the leaf) is read
+        auto pos = child_pos[idx];
+        auto node = io.view_node(pos);
+        for (idx = node.lower_bound(key); !node.has_key(idx, key) && !node.is_leaf(); idx = node.lower_bound(key)) {
+            pos = node.child_pos(idx);
+            node = io.view_node(pos);
         }
 
-        int idx = curr.find_key_bin_search(io, key);
-        EntryT dummy = curr.get_entry(io, idx);
-        return std::make_tuple(curr, dummy, idx);
+        // Read the entry only when the key is actually found
+        Node curr = io.read_node(pos);
+        found = idx < curr.used_keys && curr.keys[idx] == key;
+        EntryT entry = found ? curr.get_entry(io, idx) : EntryT();
+        return std::make_tuple(std::move(curr), entry, idx);
     }
 }
\ No newline at end of file
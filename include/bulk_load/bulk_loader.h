@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <thread>
+#include <filesystem>
+
+#include "io/io_manager.h"
+#include "btree_impl/btree.h"
+#include "btree_impl/btree_builder.h"
+#include "bplus_tree_impl/bplus_tree.h"
+#include "bplus_tree_impl/bplus_tree_builder.h"
+#include "hash_impl/extendible_hash_builder.h"
+#include "bulk_load/sorted_run.h"
+#include "utils/error.h"
+
+namespace btree::bulk {
+    /**
+     * Builds a new volume from a (possibly unsorted) stream of key/value pairs much faster than a loop of set():
+     *  - the input is buffered and split into sorted runs, each run is sorted and spilled to a temporary file
+     *    by a background thread, so sorting of one run overlaps reading of the next one
+     *  - all buffers together take no more than MEMORY_BUDGET bytes
+     *  - on finish() the runs are merged, duplicate keys are resolved (the latest value wins) and the entries
+     *    are written to the volume in one sequential pass
+     *  - then the nodes are built bottom-up and fully packed by the engine specific builder (the hash buckets are filled
+     *    by the inserts with the node writes deferred)
+     * The result is a regular volume file: open it with Storage::open_volume with the same order, engine and compression.
+     */
+    template <typename K, typename V>
+    class BulkLoader final {
+        using IOManagerT = IOManager<K, V>;
+        using RecordT = Record<K>;
+    public:
+        using ValueType = typename BTree<K, V>::ValueType;
+        using EntryT = typename BTree<K, V>::EntryT;
+
+        static constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+        BulkLoader(const std::string& path, const int16_t order, const EngineType engine = BTREE,
+                   const size_t memory_budget = DEFAULT_MEMORY_BUDGET,
+                   const int32_t threads = std::max(1u, std::thread::hardware_concurrency()),
+                   const Compression compression = NO_COMPRESSION);
+        ~BulkLoader();
+
+        void add(const K key, ValueType value);
+        void add(const K key, const V& value, const int32_t size);
+        void add(const EntryT& e);
+
+        /** Writes the volume, returns the number of unique keys in it */
+        int64_t finish();
+    private:
+        void add(RecordT&& r);
+        void spill();
+        void wait_spilled_runs();
+        int64_t write_entries(IOManagerT& io, const std::string& index_path);
+        int64_t build_tree(IOManagerT& io, const std::string& index_path, const int64_t keys_count);
+
+        template <typename Builder>
+        int64_t build_tree(Builder&& builder, const std::string& index_path, const int64_t keys_count);
+
+        EntryT make_entry(const RecordT& r) const;
+        std::string temp_path(const std::string& suffix) const;
+
+        const std::string path;
+        const int16_t order;
+        const EngineType engine;
+        const Compression compression;
+        const size_t run_budget;
+        const size_t max_pending_runs;
+
+        std::vector<RecordT> buffer;
+        size_t buffer_bytes = 0;
+        uint64_t seq = 0;
+        bool finished = false;
+
+        std::vector<std::string> run_paths;
+        std::deque<std::future<void>> pending_runs;
+    };
+}
+
+#include "bulk_load/bulk_loader_impl.h"
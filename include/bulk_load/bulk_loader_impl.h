@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstring>
+
+namespace btree::bulk {
+    template <typename K, typename V>
+    BulkLoader<K, V>::BulkLoader(const std::string& path, const int16_t order, const EngineType engine,
+                                 const size_t memory_budget, const int32_t threads, const Compression compression) :
+        path(path), order(order), engine(engine), compression(compression),
+        // Every pending run and the buffer being filled take up to RUN_BUDGET bytes
+        run_budget(std::max<size_t>(memory_budget / (std::max(threads, 1) + 1), 1)),
+        max_pending_runs(std::max(threads, 1))
+    {
+        validate(!std::filesystem::exists(path), error_msg::volume_exists_msg, path);
+    }
+
+    template <typename K, typename V>
+    BulkLoader<K, V>::~BulkLoader() {
+        for (auto& run: pending_runs) {
+            try {
+                run.get();
+            } catch (...) {}
+        }
+
+        std::error_code error_code;
+        for (const auto& run_path: run_paths)
+            std::filesystem::remove(run_path, error_code);
+        std::filesystem::remove(temp_path(".index"), error_code);
+    }
+
+    template <typename K, typename V>
+    void BulkLoader<K, V>::add(const K key, ValueType value) {
+        add(EntryT{ key, value });
+    }
+
+    template <typename K, typename V>
+    void BulkLoader<K, V>::add(const K key, const V& value, const int32_t size) {
+        if (size != 0)
+            add(EntryT{ key, value, size });
+    }
+
+    template <typename K, typename V>
+    void BulkLoader<K, V>::add(const EntryT& e) {
+        const char* data;
+        if constexpr (std::is_arithmetic_v<V>)
+            data = reinterpret_cast<const char*>(&e.data);
+        else
+            data = reinterpret_cast<const char*>(e.data);
+        add(RecordT{ e.key, seq++, std::string(data, e.size_in_bytes) });
+    }
+
+    template <typename K, typename V>
+    void BulkLoader<K, V>::add(RecordT&& r) {
+        validate(!finished, error_msg::bulk_loader_finished_msg, path);
+
+        buffer_bytes += r.size_in_bytes();
+        buffer.push_back(std::move(r));
+        if (buffer_bytes >= run_budget)
+            spill();
+    }
+
+    template <typename K, typename V>
+    void BulkLoader<K, V>::spill() {
+        if (pending_runs.size() >= max_pending_runs) {
+            pending_runs.front().get();
+            pending_runs.pop_front();
+        }
+
+        auto run_path = temp_path(".run" + std::to_string(run_paths.size()));
+        run_paths.push_back(run_path);
+        pending_runs.push_back(std::async(std::launch::async, [run = std::move(buffer), run_path]() mutable {
+            sort_and_write_run(run_path, run);
+        }));
+        buffer = {};
+        buffer_bytes = 0;
+    }
+
+    template <typename K, typename V>
+    void BulkLoader<K, V>::wait_spilled_runs() {
+        while (!pending_runs.empty()) {
+            pending_runs.front().get();
+            pending_runs.pop_front();
+        }
+    }
+
+    template <typename K, typename V>
+    int64_t BulkLoader<K, V>::finish() {
+        validate(!finished, error_msg::bulk_loader_finished_msg, path);
+        finished = true;
+
+        // The last run stays in memory
+        std::sort(buffer.begin(), buffer.end());
+        wait_spilled_runs();
+
+        IOManagerT io(path, order, engine, MappingOptions(), compression);
+        auto index_path = temp_path(".index");
+        auto keys_count = write_entries(io, index_path);
+        if (keys_count > 0)
+            io.write_new_pos_for_root_node(build_tree(io, index_path, keys_count));
+
+        std::error_code error_code;
+        for (const auto& run_path: run_paths)
+            std::filesystem::remove(run_path, error_code);
+        std::filesystem::remove(index_path, error_code);
+        buffer = {};
+        return keys_count;
+    }
+
+    template <typename K, typename V>
+    int64_t BulkLoader<K, V>::write_entries(IOManagerT& io, const std::string& index_path) {
+        std::vector<RunReader<K>> readers;
+        readers.reserve(run_paths.size() + 1);
+        for (const auto& run_path: run_paths)
+            readers.emplace_back(run_path);
+        readers.emplace_back(buffer);
+
+        // K-way merge: min-heap of the current record of every run
+        using HeapItem = std::pair<RecordT, size_t>;
+        auto greater = [](const HeapItem& l, const HeapItem& r) { return r.first < l.first; };
+        std::vector<HeapItem> heap;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            RecordT r;
+            if (readers[i].next(r))
+                heap.emplace_back(std::move(r), i);
+        }
+        if (heap.empty())
+            return 0;
+        std::make_heap(heap.begin(), heap.end(), greater);
+
+        io.write_header();
+        std::ofstream index(index_path, std::ios::binary | std::ios::trunc);
+        int64_t keys_count = 0;
+        auto write_entry = [&](const RecordT& r) {
+            auto e = make_entry(r);
+            // An inline value takes no place in the file, its position is the value itself
+            auto pos = io.has_inline_values() ? io.allocate_entry(e) : io.get_file_pos_end();
+            io.write_entry(e, pos);
+            index.write(reinterpret_cast<const char*>(&r.key), sizeof(r.key));
+            index.write(reinterpret_cast<const char*>(&pos), sizeof(pos));
+            ++keys_count;
+        };
+
+        // Records of the same key come in the input order, only the last one is written
+        RecordT last = std::move(heap.front().first);
+        std::pop_heap(heap.begin(), heap.end(), greater);
+        if (readers[heap.back().second].next(heap.back().first))
+            std::push_heap(heap.begin(), heap.end(), greater);
+        else
+            heap.pop_back();
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), greater);
+            auto& [r, reader_idx] = heap.back();
+            if (r.key != last.key)
+                write_entry(last);
+            last = std::move(r);
+
+            if (readers[reader_idx].next(r))
+                std::push_heap(heap.begin(), heap.end(), greater);
+            else
+                heap.pop_back();
+        }
+        write_entry(last);
+
+        if (!index)
+            throw std::runtime_error("Can't write the bulk load index: " + index_path);
+        return keys_count;
+    }
+
+    template <typename K, typename V>
+    int64_t BulkLoader<K, V>::build_tree(IOManagerT& io, const std::string& index_path, const int64_t keys_count) {
+        if (engine == HASH)
+            return build_tree(ExtendibleHashBuilder<K, V>(io, order, keys_count), index_path, keys_count);
+        if (is_bplus_tree(engine))
+            return build_tree(BPlusTreeBuilder<K, V>(io, order, keys_count), index_path, keys_count);
+        return build_tree(BTreeBuilder<K, V>(io, order, keys_count), index_path, keys_count);
+    }
+
+    template <typename K, typename V>
+    template <typename Builder>
+    int64_t BulkLoader<K, V>::build_tree(Builder&& builder, const std::string& index_path, const int64_t keys_count) {
+        std::ifstream index(index_path, std::ios::binary);
+        for (int64_t i = 0; i < keys_count; ++i) {
+            K key;
+            int64_t pos;
+            index.read(reinterpret_cast<char*>(&key), sizeof(key));
+            index.read(reinterpret_cast<char*>(&pos), sizeof(pos));
+            builder.add(key, pos);
+        }
+        if (!index)
+            throw std::runtime_error("The bulk load index is truncated: " + index_path);
+        return builder.finish();
+    }
+
+    template <typename K, typename V>
+    typename BulkLoader<K, V>::EntryT BulkLoader<K, V>::make_entry(const RecordT& r) const {
+        if constexpr (std::is_arithmetic_v<V>) {
+            V value;
+            std::memcpy(&value, r.value.data(), sizeof(V));
+            return EntryT{ r.key, value };
+        } else {
+            auto* data = reinterpret_cast<const uint8_t*>(r.value.data());
+            return EntryT{ r.key, data, static_cast<int32_t>(r.value.size()) };
+        }
+    }
+
+    template <typename K, typename V>
+    std::string BulkLoader<K, V>::temp_path(const std::string& suffix) const {
+        return path + suffix;
+    }
+}
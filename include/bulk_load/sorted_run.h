@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace btree::bulk {
+    /** Input record, SEQ is the order of the record in the input stream: the latest record of the key wins */
+    template <typename K>
+    struct Record final {
+        K key;
+        uint64_t seq;
+        std::string value;
+
+        bool operator<(const Record& r) const {
+            return (key < r.key) || (key == r.key && seq < r.seq);
+        }
+
+        size_t size_in_bytes() const {
+            return sizeof(Record) + value.size();
+        }
+    };
+
+    /**
+     * Sorted run file: a sequence of records
+     *     - KEY                      |=> takes KEY_SIZE bytes
+     *     - SEQ                      |=> takes 8 bytes
+     *     - VALUE_SIZE               |=> takes 4 bytes
+     *     - VALUE                    |=> takes VALUE_SIZE bytes
+     */
+    template <typename K>
+    void sort_and_write_run(const std::string& path, std::vector<Record<K>>& run) {
+        std::sort(run.begin(), run.end());
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        for (const auto& r: run) {
+            auto size = static_cast<int32_t>(r.value.size());
+            out.write(reinterpret_cast<const char*>(&r.key), sizeof(r.key));
+            out.write(reinterpret_cast<const char*>(&r.seq), sizeof(r.seq));
+            out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            out.write(r.value.data(), size);
+        }
+        if (!out)
+            throw std::runtime_error("Can't write the sorted run: " + path);
+    }
+
+    /** Sequential reader of a sorted run, either spilled to a file or kept in memory */
+    template <typename K>
+    class RunReader final {
+        std::ifstream file;
+        std::vector<Record<K>>* memory = nullptr;
+        size_t memory_idx = 0;
+    public:
+        explicit RunReader(const std::string& path) : file(path, std::ios::binary) {}
+        explicit RunReader(std::vector<Record<K>>& run) : memory(&run) {}
+
+        bool next(Record<K>& r) {
+            if (memory) {
+                if (memory_idx == memory->size())
+                    return false;
+                r = std::move((*memory)[memory_idx++]);
+                return true;
+            }
+
+            int32_t size = 0;
+            if (!file.read(reinterpret_cast<char*>(&r.key), sizeof(r.key)))
+                return false;
+            file.read(reinterpret_cast<char*>(&r.seq), sizeof(r.seq));
+            file.read(reinterpret_cast<char*>(&size), sizeof(size));
+            r.value.resize(size);
+            file.read(r.value.data(), size);
+            if (!file)
+                throw std::runtime_error("The sorted run is truncated");
+            return true;
+        }
+    };
+}
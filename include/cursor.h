@@ -0,0 +1,77 @@
+#pragma once
+
+#include <mutex>
+#include <optional>
+#include <variant>
+
+#include "utils/utils.h"
+#include "btree_impl/btree_cursor.h"
+#include "bplus_tree_impl/bplus_tree_cursor.h"
+#include "hash_impl/hash_cursor.h"
+
+namespace btree::cursor {
+    /**
+     * Ordered forward/backward cursor over the keys of a volume, it doesn't depend on the volume engine.
+     *  - the cursor is invalidated by any modification of the volume
+     *  - the cursor of VolumeMT holds the volume lock while it's alive
+     */
+    template <typename K, typename V>
+    class Cursor final {
+        using CursorType = std::variant<BTreeCursor<K, V>, BPlusTreeCursor<K, V>, HashCursor<K, V>>;
+
+        CursorType cursor;
+        std::unique_lock<std::mutex> lock;
+    public:
+        template <typename EngineCursor, utils::enable_if_t<!std::is_same_v<std::decay_t<EngineCursor>, Cursor>> = true>
+        explicit Cursor(EngineCursor&& cursor) : cursor(std::forward<EngineCursor>(cursor)) {}
+
+        Cursor(Cursor&& other, std::unique_lock<std::mutex>&& lock) :
+            cursor(std::move(other.cursor)), lock(std::move(lock)) {}
+
+        bool valid() const {
+            return std::visit([](const auto& c) { return c.valid(); }, cursor);
+        }
+
+        K key() const {
+            return std::visit([](const auto& c) { return c.key(); }, cursor);
+        }
+
+        typename BTree<K, V>::EntryT entry() const {
+            return std::visit([](const auto& c) { return c.entry(); }, cursor);
+        }
+
+        std::optional<V> value() const {
+            return std::visit([](const auto& c) { return c.entry().value(); }, cursor);
+        }
+
+        /** Moves to the first key >= KEY */
+        bool seek(const K key) {
+            return std::visit([&](auto& c) { return c.seek(key); }, cursor);
+        }
+
+        bool seek_to_first() {
+            return std::visit([](auto& c) { return c.seek_to_first(); }, cursor);
+        }
+
+        bool seek_to_last() {
+            return std::visit([](auto& c) { return c.seek_to_last(); }, cursor);
+        }
+
+        bool next() {
+            return std::visit([](auto& c) { return c.next(); }, cursor);
+        }
+
+        bool prev() {
+            return std::visit([](auto& c) { return c.prev(); }, cursor);
+        }
+
+        /** Calls FN(key, value) for each key in [LO, HI) in ascending order, returns the number of visited keys */
+        template <typename Func>
+        int64_t scan(const K lo, const K hi, Func&& fn) {
+            int64_t count = 0;
+            for (bool success = seek(lo); success && key() < hi; success = next(), ++count)
+                fn(key(), value().value_or(V()));
+            return count;
+        }
+    };
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "btree_impl/btree.h"
+#include "bplus_tree_impl/bplus_tree_node.h"
+#include "hash_impl/hash_cursor.h"
+#include "utils/forward_decl.h"
+
+namespace btree {
+    /**
+     * Extendible hashing engine for the volumes of point lookups:
+     *  - the low GLOBAL_DEPTH bits of the hash of a key index the directory, a slot refers to the bucket of the key,
+     *    so a lookup reads one bucket: a leaf node of the plain B+ tree layout searched in place
+     *  - a bucket of LOCAL_DEPTH bits is referred by 2^(GLOBAL_DEPTH - LOCAL_DEPTH) slots; a full bucket is split by
+     *    the next bit of the hash and only its slots are rewritten, the directory is doubled only when a bucket of
+     *    GLOBAL_DEPTH bits is split: the new half is a copy of the old one, so only the pages of the new slots are
+     *    written (incremental doubling)
+     *  - a bucket left empty is merged with its buddy of the same depth, the directory is halved when no bucket
+     *    needs all its bits
+     * The directory is kept in memory and in the file (see IOManager), it's read on open. The keys aren't ordered:
+     * the cursor sorts them on the first seek.
+     */
+    template <typename K, typename V>
+    struct ExtendibleHash final {
+        using ValueType = typename BTree<K, V>::ValueType;
+
+        using EntryT = typename BTree<K, V>::EntryT;
+        using Node = BPlusTreeNode<K, V>;
+        using IOManagerT = IOManager<K, V>;
+
+        ExtendibleHash(const int16_t order, IOManagerT& io);
+
+        bool exist(IOManagerT& io, const K key) const;
+        std::optional<V> get(IOManagerT& io, const K key) const;
+        void set(IOManagerT& io, const K key, ValueType value);
+        void set(IOManagerT& io, const K key, const V& value, const int32_t size);
+        bool remove(IOManagerT& io, const K key);
+        /** The entry of KEY or an invalid entry, the value isn't copied from the mapping */
+        EntryT find(IOManagerT& io, const K key) const;
+
+        /** Calls ON_FOUND(i, entry_pos) for each found key of SORTED_KEYS */
+        template <typename Func>
+        void find_batch(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const;
+
+        /** FIND_BATCH with the buckets of the batch read ahead at once, see BTree::find_batch_by_levels */
+        template <typename Func>
+        void find_batch_by_levels(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const;
+
+        /** Reads ahead the buckets and the entries of SORTED_KEYS */
+        void prefetch(IOManagerT& io, const K* sorted_keys, const size_t n) const;
+
+        HashCursor<K, V> cursor(IOManagerT& io) const;
+
+        /** Adds a new KEY which entry is already written at ENTRY_POS (see ExtendibleHashBuilder) */
+        void insert_entry_pos(IOManagerT& io, const K key, const int64_t entry_pos);
+        /** The first directory page or INVALID_POS for an empty volume */
+        int64_t directory_pos() const;
+
+        /** The slot of KEY in a directory of 2^DEPTH slots */
+        static size_t slot_of(const K key, const int32_t depth);
+    private:
+        std::optional<int64_t> find_entry_pos(IOManagerT& io, const K key) const;
+        void insert(IOManagerT& io, const EntryT& e);
+        /** Adds KEY to BUCKET of SLOT, the full buckets on the way are split */
+        void add(IOManagerT& io, Node bucket, size_t slot, const K key, const int64_t entry_pos);
+        /** Splits BUCKET of SLOT by the next bit of the hash: BUCKET keeps the keys with the bit unset, the new one is returned */
+        Node split(IOManagerT& io, Node& bucket, const size_t slot);
+        /** Merges the empty bucket of SLOT or the bucket it's merged into with its buddies while one of them is empty */
+        void merge(IOManagerT& io, Node bucket, const size_t slot);
+        /** Refers the slots of the bucket of PATTERN and DEPTH bits to POS */
+        void refer_slots(const size_t pattern, const int32_t depth, const int64_t pos);
+
+        void create(IOManagerT& io);
+        void double_directory(IOManagerT& io);
+        void halve_directory(IOManagerT& io);
+        void clear(IOManagerT& io);
+        void write_dirty_pages(IOManagerT& io);
+
+        const int16_t t;
+        // Slots of a directory page: the positions of the buckets and their local depths in place of the keys
+        const int32_t page_slots;
+        int32_t global_depth;
+        std::vector<int64_t> directory;
+        std::vector<uint8_t> local_depths;
+        std::vector<int64_t> pages;
+        std::vector<size_t> dirty_pages;
+        // Buckets of GLOBAL_DEPTH bits: each one takes one slot, the directory is halved when there are none
+        int64_t deepest_buckets;
+    };
+}
+
+#include "hash_impl/extendible_hash_impl.h"
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "utils/forward_decl.h"
+#include "hash_impl/extendible_hash.h"
+
+namespace btree {
+    /**
+     * ExtendibleHash builder for the keys which entries are already written to the file.
+     * The keys are inserted one by one with the node writes deferred: a bucket or a directory page rewritten
+     * by many keys is written to the file once, on finish.
+     */
+    template <typename K, typename V>
+    class ExtendibleHashBuilder final {
+        using IOManagerT = IOManager<K, V>;
+
+        IOManagerT& io;
+        ExtendibleHash<K, V> hash;
+    public:
+        ExtendibleHashBuilder(IOManagerT& io, const int16_t t, const int64_t) : io(io), hash(t, io) {
+            io.defer_node_writes();
+        }
+
+        /** Keys must be unique */
+        void add(const K key, const int64_t entry_pos) {
+            hash.insert_entry_pos(io, key, entry_pos);
+        }
+
+        /** Returns the first directory page or INVALID_POS for an empty volume */
+        int64_t finish() {
+            io.write_deferred_nodes();
+            return hash.directory_pos();
+        }
+    };
+}
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+
+#include "utils/utils.h"
+#include "utils/error.h"
+
+namespace btree {
+    template <typename K, typename V>
+    ExtendibleHash<K, V>::ExtendibleHash(const int16_t order, IOManagerT& io) :
+            t(order), page_slots(Node::max_leaf_keys(order)), global_depth(0), deepest_buckets(0) {
+        if (!io.is_ready())
+            return;
+
+        // The directory pages are linked as the leaves, the slots of the next page follow the slots of the previous one
+        for (auto pos = io.read_header(); pos != IOManagerT::INVALID_POS;) {
+            auto page = io.read_bplus_node(pos);
+            pages.push_back(pos);
+            for (auto i = 0; i < page.used_keys; ++i) {
+                directory.push_back(page.entry_pos[i]);
+                local_depths.push_back(static_cast<uint8_t>(page.keys[i]));
+            }
+            pos = page.next_leaf_pos;
+        }
+        if (pages.empty())
+            return;
+
+        auto size = directory.size();
+        utils::validate(size > 0 && (size & (size - 1)) == 0, error_msg::wrong_directory_msg, io.get_path());
+        while ((size_t(1) << global_depth) < size)
+            ++global_depth;
+        deepest_buckets = std::count(local_depths.begin(), local_depths.end(), static_cast<uint8_t>(global_depth));
+    }
+
+    template <typename K, typename V>
+    size_t ExtendibleHash<K, V>::slot_of(const K key, const int32_t depth) {
+        return static_cast<size_t>(utils::mix_bits(static_cast<uint64_t>(key)) & ((uint64_t(1) << depth) - 1));
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::set(IOManagerT& io, const K key, ValueType value) {
+        insert(io, EntryT{ key, value });
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::set(IOManagerT& io, const K key, const V& value, const int32_t size) {
+        if (size != 0)
+            insert(io, EntryT{ key, value, size });
+    }
+
+    template <typename K, typename V>
+    std::optional<V> ExtendibleHash<K, V>::get(IOManagerT& io, const K key) const {
+        return find(io, key).value();
+    }
+
+    template <typename K, typename V>
+    bool ExtendibleHash<K, V>::exist(IOManagerT& io, const K key) const {
+        return find_entry_pos(io, key).has_value();
+    }
+
+    template <typename K, typename V>
+    typename ExtendibleHash<K, V>::EntryT ExtendibleHash<K, V>::find(IOManagerT& io, const K key) const {
+        auto entry_pos = find_entry_pos(io, key);
+        return entry_pos ? io.read_entry(key, *entry_pos) : EntryT();
+    }
+
+    template <typename K, typename V>
+    std::optional<int64_t> ExtendibleHash<K, V>::find_entry_pos(IOManagerT& io, const K key) const {
+        if (directory.empty())
+            return std::nullopt;
+
+        // The bucket is searched in place: the lookup doesn't copy it
+        auto bucket = io.view_bplus_node(directory[slot_of(key, global_depth)]);
+        auto idx = bucket.lower_bound(key);
+        if (bucket.has_key(idx, key))
+            return bucket.entry_pos(idx);
+        return std::nullopt;
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    void ExtendibleHash<K, V>::find_batch(IOManagerT& io, const K* sorted_keys, const size_t n, Func&& on_found) const {
+        for (size_t i = 0; i < n; ++i)
+            if (auto entry_pos = find_entry_pos(io, sorted_keys[i]))
+                on_found(i, *entry_pos);
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    void ExtendibleHash<K, V>::find_batch_by_levels(IOManagerT& io, const K* sorted_keys, const size_t n,
+                                                    Func&& on_found) const {
+        if (directory.empty())
+            return;
+
+        for (size_t i = 0; i < n; ++i)
+            io.prefetch_node(directory[slot_of(sorted_keys[i], global_depth)]);
+        io.complete_prefetch();
+        find_batch(io, sorted_keys, n, on_found);
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::prefetch(IOManagerT& io, const K* sorted_keys, const size_t n) const {
+        find_batch_by_levels(io, sorted_keys, n, [&io](const size_t, const int64_t entry_pos) {
+            io.prefetch_entry(entry_pos);
+        });
+        io.complete_prefetch();
+    }
+
+    template <typename K, typename V>
+    HashCursor<K, V> ExtendibleHash<K, V>::cursor(IOManagerT& io) const {
+        // The first slot of a bucket is its pattern: the low bits of the hashes of its keys
+        std::vector<int64_t> buckets;
+        for (size_t i = 0; i < directory.size(); ++i)
+            if (i < (size_t(1) << local_depths[i]))
+                buckets.push_back(directory[i]);
+        return HashCursor<K, V>(io, std::move(buckets));
+    }
+
+    template <typename K, typename V>
+    int64_t ExtendibleHash<K, V>::directory_pos() const {
+        return pages.empty() ? IOManagerT::INVALID_POS : pages[0];
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::insert(IOManagerT& io, const EntryT& e) {
+        if (directory.empty())
+            create(io);
+
+        auto slot = slot_of(e.key, global_depth);
+        Node bucket = io.read_bplus_node(directory[slot]);
+        auto idx = bucket.find_key_pos(e.key);
+
+        // Replace the entry of the existing key
+        if (idx < bucket.used_keys && bucket.keys[idx] == e.key) {
+            if (io.read_entry(e.key, bucket.entry_pos[idx]) != e) {
+                // The old entry is freed first: the new one may take its place
+                io.free_entry(bucket.entry_pos[idx]);
+                auto curr_pos = io.allocate_entry(e);
+                bucket.entry_pos[idx] = curr_pos;
+
+                io.write_entry(e, curr_pos);
+                io.write_node(bucket, bucket.m_pos);
+            }
+            return;
+        }
+
+        auto entry_pos = io.allocate_entry(e);
+        io.write_entry(e, entry_pos);
+        add(io, std::move(bucket), slot, e.key, entry_pos);
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::insert_entry_pos(IOManagerT& io, const K key, const int64_t entry_pos) {
+        if (directory.empty())
+            create(io);
+
+        auto slot = slot_of(key, global_depth);
+        add(io, io.read_bplus_node(directory[slot]), slot, key, entry_pos);
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::add(IOManagerT& io, Node bucket, size_t slot, const K key, const int64_t entry_pos) {
+        // The keys of a split bucket may all go to one half, then it's split again
+        while (bucket.is_full()) {
+            Node other = split(io, bucket, slot);
+            slot = slot_of(key, global_depth);
+            if (directory[slot] == other.m_pos)
+                bucket = std::move(other);
+        }
+        bucket.insert_entry(bucket.find_key_pos(key), key, entry_pos);
+        io.write_node(bucket, bucket.m_pos);
+        write_dirty_pages(io);
+    }
+
+    template <typename K, typename V>
+    BPlusTreeNode<K, V> ExtendibleHash<K, V>::split(IOManagerT& io, Node& bucket, const size_t slot) {
+        int32_t depth = local_depths[slot];
+        if (depth == global_depth)
+            double_directory(io);
+
+        // The keys with the bit DEPTH of the hash set go to the new bucket, both halves stay sorted
+        Node other(t, true);
+        other.m_pos = io.allocate_node();
+        int32_t kept = 0;
+        for (auto i = 0; i < bucket.used_keys; ++i) {
+            auto key = bucket.keys[i];
+            auto pos = bucket.entry_pos[i];
+            if ((utils::mix_bits(static_cast<uint64_t>(key)) >> depth) & 1) {
+                other.insert_entry(other.used_keys, key, pos);
+            } else {
+                bucket.keys[kept] = key;
+                bucket.entry_pos[kept] = pos;
+                ++kept;
+            }
+        }
+        bucket.used_keys = kept;
+
+        auto pattern = slot & ((size_t(1) << depth) - 1);
+        refer_slots(pattern, depth + 1, bucket.m_pos);
+        refer_slots(pattern | (size_t(1) << depth), depth + 1, other.m_pos);
+        if (depth + 1 == global_depth)
+            deepest_buckets += 2;
+
+        io.write_node(bucket, bucket.m_pos);
+        io.write_node(other, other.m_pos);
+        return other;
+    }
+
+    template <typename K, typename V>
+    bool ExtendibleHash<K, V>::remove(IOManagerT& io, const K key) {
+        if (directory.empty())
+            return false;
+
+        auto slot = slot_of(key, global_depth);
+        Node bucket = io.read_bplus_node(directory[slot]);
+        auto idx = bucket.find_key_pos(key);
+        if (idx == bucket.used_keys || bucket.keys[idx] != key)
+            return false;
+
+        io.free_entry(bucket.entry_pos[idx]);
+        bucket.erase_entry(idx);
+        if (bucket.used_keys > 0) {
+            io.write_node(bucket, bucket.m_pos);
+            return true;
+        }
+        merge(io, std::move(bucket), slot);
+        return true;
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::merge(IOManagerT& io, Node bucket, const size_t slot) {
+        int32_t depth = local_depths[slot];
+        while (depth > 0) {
+            auto buddy_slot = slot ^ (size_t(1) << (depth - 1));
+            if (local_depths[buddy_slot] != depth)
+                break;
+            Node buddy = io.read_bplus_node(directory[buddy_slot]);
+            if (bucket.used_keys > 0 && buddy.used_keys > 0)
+                break;
+
+            // BUCKET is the one that has the keys, if any: it takes the slots of the buddy
+            if (bucket.used_keys == 0)
+                std::swap(bucket, buddy);
+            io.free_node(buddy.m_pos);
+            if (depth == global_depth)
+                deepest_buckets -= 2;
+            --depth;
+            refer_slots(slot & ((size_t(1) << depth) - 1), depth, bucket.m_pos);
+        }
+
+        while (global_depth > 0 && deepest_buckets == 0)
+            halve_directory(io);
+        if (bucket.used_keys == 0 && directory.size() == 1) {
+            clear(io);
+            return;
+        }
+        io.write_node(bucket, bucket.m_pos);
+        write_dirty_pages(io);
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::refer_slots(const size_t pattern, const int32_t depth, const int64_t pos) {
+        for (auto i = pattern; i < directory.size(); i += size_t(1) << depth) {
+            directory[i] = pos;
+            local_depths[i] = static_cast<uint8_t>(depth);
+            auto page = i / page_slots;
+            if (dirty_pages.empty() || dirty_pages.back() != page)
+                dirty_pages.push_back(page);
+        }
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::create(IOManagerT& io) {
+        io.write_header();
+
+        pages = { io.allocate_node() };
+        Node bucket(t, true);
+        bucket.m_pos = io.allocate_node();
+        directory = { bucket.m_pos };
+        local_depths = { 0 };
+        global_depth = 0;
+        deepest_buckets = 1;
+
+        io.write_node(bucket, bucket.m_pos);
+        dirty_pages = { 0 };
+        write_dirty_pages(io);
+        io.write_new_pos_for_root_node(pages[0]);
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::double_directory(IOManagerT& io) {
+        // The slots of the new half refer to the buckets of the old one: the old pages but the last one are kept as is
+        auto size = directory.size();
+        directory.resize(2 * size);
+        local_depths.resize(2 * size);
+        std::copy_n(directory.begin(), size, directory.begin() + size);
+        std::copy_n(local_depths.begin(), size, local_depths.begin() + size);
+        ++global_depth;
+        deepest_buckets = 0;
+
+        auto pages_count = (2 * size + page_slots - 1) / page_slots;
+        for (auto page = pages.size() - 1; page < pages_count; ++page)
+            dirty_pages.push_back(page);
+        while (pages.size() < pages_count)
+            pages.push_back(io.allocate_node());
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::halve_directory(IOManagerT& io) {
+        auto size = directory.size() / 2;
+        directory.resize(size);
+        local_depths.resize(size);
+        --global_depth;
+        deepest_buckets = std::count(local_depths.begin(), local_depths.end(), static_cast<uint8_t>(global_depth));
+
+        auto pages_count = (size + page_slots - 1) / page_slots;
+        while (pages.size() > pages_count) {
+            io.free_node(pages.back());
+            pages.pop_back();
+        }
+        dirty_pages.push_back(pages_count - 1);
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::clear(IOManagerT& io) {
+        directory.clear();
+        local_depths.clear();
+        pages.clear();
+        dirty_pages.clear();
+        global_depth = 0;
+        deepest_buckets = 0;
+        io.write_invalidated_root();
+    }
+
+    template <typename K, typename V>
+    void ExtendibleHash<K, V>::write_dirty_pages(IOManagerT& io) {
+        std::sort(dirty_pages.begin(), dirty_pages.end());
+        dirty_pages.erase(std::unique(dirty_pages.begin(), dirty_pages.end()), dirty_pages.end());
+        for (auto idx: dirty_pages) {
+            // The pages dropped by the halving aren't written
+            if (idx >= pages.size())
+                continue;
+            Node page(t, true);
+            auto first = idx * page_slots;
+            page.used_keys = static_cast<int16_t>(std::min(directory.size() - first, static_cast<size_t>(page_slots)));
+            for (auto i = 0; i < page.used_keys; ++i) {
+                page.keys[i] = static_cast<K>(local_depths[first + i]);
+                page.entry_pos[i] = directory[first + i];
+            }
+            page.m_pos = pages[idx];
+            page.prev_leaf_pos = idx > 0 ? pages[idx - 1] : IOManagerT::INVALID_POS;
+            page.next_leaf_pos = idx + 1 < pages.size() ? pages[idx + 1] : IOManagerT::INVALID_POS;
+            io.write_node(page, page.m_pos);
+        }
+        dirty_pages.clear();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "utils/forward_decl.h"
+
+namespace btree {
+    /**
+     * In-order cursor over the ExtendibleHash.
+     * The buckets aren't ordered, so the keys of all of them are read and sorted on the first seek.
+     * Any modification of the hash invalidates the cursor.
+     */
+    template <typename K, typename V>
+    class HashCursor final {
+        using EntryT = typename BTree<K, V>::EntryT;
+        using IOManagerT = IOManager<K, V>;
+
+        IOManagerT* io;
+        std::vector<int64_t> buckets;
+        // The keys and the positions of their entries, they're read on the first seek
+        std::vector<std::pair<K, int64_t>> keys;
+        bool is_loaded;
+        int64_t idx;
+    public:
+        HashCursor(IOManagerT& io, std::vector<int64_t>&& buckets);
+
+        bool valid() const;
+        K key() const;
+        EntryT entry() const;
+
+        bool seek(const K key);
+        bool seek_to_first();
+        bool seek_to_last();
+        bool next();
+        bool prev();
+    private:
+        void load();
+        bool at(const int64_t i);
+    };
+}
+
+#include "hash_impl/hash_cursor_impl.h"
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+
+namespace btree {
+    template <typename K, typename V>
+    HashCursor<K, V>::HashCursor(IOManagerT& io, std::vector<int64_t>&& buckets) :
+        io(&io), buckets(std::move(buckets)), is_loaded(false), idx(-1) {}
+
+    template <typename K, typename V>
+    bool HashCursor<K, V>::valid() const {
+        return idx >= 0;
+    }
+
+    template <typename K, typename V>
+    K HashCursor<K, V>::key() const {
+        return keys[idx].first;
+    }
+
+    template <typename K, typename V>
+    typename BTree<K, V>::EntryT HashCursor<K, V>::entry() const {
+        return io->read_entry(keys[idx].first, keys[idx].second);
+    }
+
+    template <typename K, typename V>
+    bool HashCursor<K, V>::seek(const K key) {
+        load();
+        auto it = std::lower_bound(keys.begin(), keys.end(), key, [](const auto& p, const K k) { return p.first < k; });
+        return at(std::distance(keys.begin(), it));
+    }
+
+    template <typename K, typename V>
+    bool HashCursor<K, V>::seek_to_first() {
+        load();
+        return at(0);
+    }
+
+    template <typename K, typename V>
+    bool HashCursor<K, V>::seek_to_last() {
+        load();
+        return at(static_cast<int64_t>(keys.size()) - 1);
+    }
+
+    template <typename K, typename V>
+    bool HashCursor<K, V>::next() {
+        return valid() && at(idx + 1);
+    }
+
+    template <typename K, typename V>
+    bool HashCursor<K, V>::prev() {
+        return valid() && at(idx - 1);
+    }
+
+    template <typename K, typename V>
+    void HashCursor<K, V>::load() {
+        if (is_loaded)
+            return;
+
+        for (auto pos: buckets) {
+            auto bucket = io->read_bplus_node(pos);
+            for (auto i = 0; i < bucket.used_keys; ++i)
+                keys.emplace_back(bucket.keys[i], bucket.entry_pos[i]);
+        }
+        std::sort(keys.begin(), keys.end());
+        is_loaded = true;
+    }
+
+    template <typename K, typename V>
+    bool HashCursor<K, V>::at(const int64_t i) {
+        idx = i >= 0 && i < static_cast<int64_t>(keys.size()) ? i : -1;
+        return valid();
+    }
+}
@@ -0,0 +1,447 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/stat.h>
+#endif
+
+#include "read_ring.h"
+#include "utils/access_pattern.h"
+
+namespace btree {
+    /**
+     * Buffer pool over a file read and written by pread/pwrite instead of the mapping, for the hosts where the page
+     * cache is shared with other tenants:
+     *  - the file is split into frames of FRAME_SIZE bytes, a frame is read when it's first accessed and written back
+     *    when it's evicted or flushed; a range which straddles the frames is read as one frame, the cached frames
+     *    it overlaps are written back and dropped, so every byte is cached once
+     *  - the addresses of a dropped frame taken before by the operation stay valid: the bytes written through them
+     *    are copied to the frames caching them by RELEASE() or FLUSH() (over the ones written through the new frame),
+     *    the reads through them don't see the writes through the new frame
+     *  - the frames are evicted by CLOCK when more than MAX_BYTES are cached: the frames accessed since the last
+     *    RELEASE() are pinned (the addresses taken before are valid till then), nothing is evicted while
+     *    VALUE_PINS are held (see ReadGuard)
+     *  - with DIRECT_IO the file is opened with O_DIRECT if it's supported: the page cache is bypassed
+     *  - with IO_URING_DEPTH > 0 the prefetched frames are read by io_uring in parallel and cached when the reads
+     *    complete (see COMPLETE_PREFETCH()), the lookups read them from the pool; without io_uring the kernel is
+     *    advised to read them ahead
+     */
+    class BufferPool final {
+#ifndef _WIN32
+        struct Frame {
+            int64_t begin;
+            int64_t size;
+            std::unique_ptr<uint8_t, decltype(&std::free)> data;
+            bool dirty = false;
+            bool referenced = true;
+            int32_t pins = 0;
+            uint64_t operation = 0;
+
+            Frame(const int64_t begin, const int64_t size, uint8_t* data) :
+                begin(begin), size(size), data(data, &std::free) {}
+
+            int64_t end() const {
+                return begin + size;
+            }
+        };
+
+        int fd = -1;
+        bool direct_io = false;
+        int64_t file_size = 0;
+        const int64_t frame_size;
+        const int64_t max_bytes;
+        int64_t cached_bytes = 0;
+        const std::atomic<int32_t>& value_pins;
+        // The frames in the CLOCK order, the hand points to the next candidate for eviction
+        std::vector<std::unique_ptr<Frame>> frames;
+        size_t hand = 0;
+        std::unordered_map<int64_t, Frame*> frame_by_index;
+        // Pinned by the current operation
+        std::vector<Frame*> operation_frames;
+        uint64_t operation = 1;
+        // All the frames are pinned: nothing is evicted till the next RELEASE() or the prefetched frames are cached
+        bool is_evict_blocked = false;
+        struct RetiredFrame {
+            std::unique_ptr<Frame> frame;
+            // The bytes when it was dropped if the current operation may still write it, empty otherwise
+            std::vector<uint8_t> image;
+        };
+        // Dropped for the overlapping frames, they're kept while their addresses may be used
+        std::vector<RetiredFrame> retired_frames;
+        struct PrefetchedFrame {
+            std::unique_ptr<Frame> frame;
+            // The bytes before the end of the file
+            int64_t size;
+            // The frame was loaded while it was read by the ring, the read bytes may be outdated
+            bool is_stale = false;
+        };
+        // Read by the ring till COMPLETE_PREFETCH(), it's declared after them so it waits for the reads when destroyed
+        std::vector<PrefetchedFrame> prefetched_frames;
+        int64_t prefetched_bytes = 0;
+        std::unique_ptr<ReadRing> ring;
+#endif
+    public:
+#ifndef _WIN32
+        static constexpr bool is_supported = true;
+
+        BufferPool(const std::string& path, const int64_t frame_size, const int64_t max_bytes, const bool direct_io,
+                   const int32_t io_uring_depth, const std::atomic<int32_t>& value_pins) :
+            frame_size(align(std::max<int64_t>(frame_size, 1))), max_bytes(max_bytes), value_pins(value_pins)
+        {
+#ifdef O_DIRECT
+            if (direct_io) {
+                // Not every file system supports the direct I/O, then the page cache is used
+                fd = ::open(path.c_str(), O_RDWR | O_DIRECT);
+                this->direct_io = (fd >= 0);
+            }
+#endif
+            if (fd < 0)
+                fd = ::open(path.c_str(), O_RDWR);
+            if (fd < 0)
+                throw std::runtime_error("Can't open the buffered file, path = " + path);
+#if defined(__APPLE__)
+            if (direct_io)
+                this->direct_io = (::fcntl(fd, F_NOCACHE, 1) == 0);
+#endif
+            struct stat st {};
+            ::fstat(fd, &st);
+            file_size = st.st_size;
+            if (io_uring_depth > 0) {
+                ring = std::make_unique<ReadRing>(fd, io_uring_depth);
+                if (!ring->is_open())
+                    ring.reset();
+            }
+        }
+
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        ~BufferPool() {
+            // The reads of the ring are waited for before the descriptor is closed
+            ring.reset();
+            try {
+                merge_retired();
+                for (auto& frame: frames)
+                    write_back(*frame);
+            } catch (...) {}
+            ::close(fd);
+        }
+
+        /** Address of the range [OFFSET, OFFSET + SIZE) cached contiguously, the frame is written back if FOR_WRITE */
+        uint8_t* address(const int64_t offset, const int64_t size, const bool for_write) {
+            auto first = offset / frame_size;
+            auto last = (offset + std::max<int64_t>(size, 1) - 1) / frame_size;
+            auto it = frame_by_index.find(first);
+            bool is_cached = it != frame_by_index.end() && it->second->end() > last * frame_size;
+            auto* frame = is_cached ? it->second : load(first, last);
+
+            frame->referenced = true;
+            frame->dirty |= for_write;
+            if (frame->operation != operation) {
+                frame->operation = operation;
+                ++frame->pins;
+                operation_frames.push_back(frame);
+            }
+            // A hit doesn't grow the pool
+            if (!is_cached)
+                evict();
+            return frame->data.get() + (offset - frame->begin);
+        }
+
+        /** The addresses of the current operation aren't used anymore: its frames are unpinned, evicted over the budget */
+        void release() {
+            merge_retired();
+            for (auto* frame: operation_frames)
+                --frame->pins;
+            operation_frames.clear();
+            ++operation;
+            if (value_pins.load(std::memory_order_acquire) == 0)
+                retired_frames.clear();
+            is_evict_blocked = false;
+            evict();
+        }
+
+        /** Writes back the dirty frames and syncs the file */
+        void flush() {
+            merge_retired();
+            for (auto& frame: frames)
+                write_back(*frame);
+            ::fdatasync(fd);
+        }
+
+        void resize(const int64_t size) {
+            if (::ftruncate(fd, size) != 0)
+                throw std::runtime_error("Can't resize the buffered file");
+            // The dropped tail reads as zeros if the file grows again
+            for (auto& frame: frames) {
+                if (frame->end() > size) {
+                    auto from = std::max<int64_t>(size, frame->begin);
+                    std::memset(frame->data.get() + (from - frame->begin), 0, frame->end() - from);
+                }
+            }
+            file_size = size;
+            for (auto& prefetched: prefetched_frames)
+                prefetched.is_stale = true;
+        }
+
+        void advise(const AccessPattern pattern) {
+            ::posix_fadvise(fd, 0, 0, fadvice(pattern));
+        }
+
+        /**
+         * The frames of the range are read by the ring if none of them is cached or read already, they're cached by
+         * COMPLETE_PREFETCH(). Without the ring the kernel reads the range ahead if it isn't cached by the pool
+         */
+        void prefetch(const int64_t offset, const int64_t size) {
+            auto first = offset / frame_size;
+            auto last = (offset + std::max<int64_t>(size, 1) - 1) / frame_size;
+            if (!ring) {
+                if (frame_by_index.find(first) == frame_by_index.end())
+                    ::posix_fadvise(fd, offset, size, POSIX_FADV_WILLNEED);
+                return;
+            }
+            auto begin = first * frame_size;
+            auto end = (last + 1) * frame_size;
+            // The frames read over the budget would evict each other before they're used, they're read on demand
+            if (begin >= file_size || prefetched_bytes + (end - begin) > max_bytes ||
+                is_cached(first, last) || is_prefetched(begin, end))
+                return;
+
+            auto frame = allocate(first, last);
+            // The direct I/O reads the whole aligned frame, the read stops at the end of the file
+            ring->read(frame->begin, frame->data.get(), frame->size);
+            prefetched_bytes += frame->size;
+            prefetched_frames.push_back(PrefetchedFrame{ std::move(frame), std::min(end, file_size) - begin });
+        }
+
+        /** Waits till the frames are read by the ring and caches them, the failed and outdated reads are dropped */
+        void complete_prefetch() {
+            if (!ring)
+                return;
+            auto results = ring->wait();
+            for (size_t i = 0; i < prefetched_frames.size(); ++i) {
+                auto& [frame, size, is_stale] = prefetched_frames[i];
+                auto first = frame->begin / frame_size;
+                auto last = frame->end() / frame_size - 1;
+                if (results[i] < size || is_stale || is_cached(first, last))
+                    continue;
+                std::memset(frame->data.get() + size, 0, frame->size - size);
+                for (auto idx = first; idx <= last; ++idx)
+                    frame_by_index[idx] = frame.get();
+                cached_bytes += frame->size;
+                frames.push_back(std::move(frame));
+            }
+            prefetched_frames.clear();
+            prefetched_bytes = 0;
+            // The ring is closed after a failed read, the next ranges are advised
+            if (!ring->is_open())
+                ring.reset();
+            is_evict_blocked = false;
+            evict();
+        }
+
+        bool has_read_ring() const {
+            return ring != nullptr;
+        }
+
+        int64_t get_cached_bytes() const {
+            return cached_bytes;
+        }
+
+        bool is_direct() const {
+            return direct_io;
+        }
+
+    private:
+        static int64_t align(const int64_t size) {
+            static const int64_t page_size = ::sysconf(_SC_PAGESIZE);
+            return (size + page_size - 1) / page_size * page_size;
+        }
+
+        static int fadvice(const AccessPattern pattern) {
+            if (pattern == RANDOM)
+                return POSIX_FADV_RANDOM;
+            if (pattern == SEQUENTIAL)
+                return POSIX_FADV_SEQUENTIAL;
+            if (pattern == WILLNEED)
+                return POSIX_FADV_WILLNEED;
+            return POSIX_FADV_NORMAL;
+        }
+
+        /** Reads the frames [FIRST, LAST] as one, the cached frames overlapping them are written back and dropped */
+        Frame* load(const int64_t first, const int64_t last) {
+            std::vector<Frame*> overlapped;
+            for (auto idx = first; idx <= last; ++idx) {
+                auto it = frame_by_index.find(idx);
+                if (it != frame_by_index.end() && (overlapped.empty() || overlapped.back() != it->second))
+                    overlapped.push_back(it->second);
+            }
+            for (auto* old_frame: overlapped) {
+                write_back(*old_frame);
+                retire(old_frame);
+            }
+
+            // The frames read by the ring before aren't cached, this read is newer
+            for (auto& prefetched: prefetched_frames)
+                prefetched.is_stale |= prefetched.frame->begin < (last + 1) * frame_size &&
+                                       prefetched.frame->end() > first * frame_size;
+            auto frame = allocate(first, last);
+            read(*frame);
+
+            auto* result = frame.get();
+            for (auto idx = first; idx <= last; ++idx)
+                frame_by_index[idx] = result;
+            cached_bytes += result->size;
+            frames.push_back(std::move(frame));
+            return result;
+        }
+
+        std::unique_ptr<Frame> allocate(const int64_t first, const int64_t last) const {
+            auto size = (last - first + 1) * frame_size;
+            void* data = nullptr;
+            if (::posix_memalign(&data, static_cast<size_t>(align(1)), static_cast<size_t>(size)) != 0)
+                throw std::bad_alloc();
+            return std::make_unique<Frame>(first * frame_size, size, static_cast<uint8_t*>(data));
+        }
+
+        bool is_cached(const int64_t first, const int64_t last) const {
+            for (auto idx = first; idx <= last; ++idx)
+                if (frame_by_index.find(idx) != frame_by_index.end())
+                    return true;
+            return false;
+        }
+
+        bool is_prefetched(const int64_t begin, const int64_t end) const {
+            return std::any_of(prefetched_frames.begin(), prefetched_frames.end(), [&](const auto& prefetched) {
+                return prefetched.frame->begin < end && prefetched.frame->end() > begin;
+            });
+        }
+
+        void retire(Frame* frame) {
+            for (auto idx = frame->begin / frame_size; idx < frame->end() / frame_size; ++idx)
+                frame_by_index.erase(idx);
+            auto it = std::find_if(frames.begin(), frames.end(), [frame](const auto& f) { return f.get() == frame; });
+            cached_bytes -= frame->size;
+            RetiredFrame retired{ std::move(*it), {} };
+            if (frame->operation == operation)
+                retired.image.assign(frame->data.get(), frame->data.get() + frame->size);
+            retired_frames.push_back(std::move(retired));
+            frames.erase(it);
+            hand = 0;
+        }
+
+        /** The bytes written through the retired frames since they were dropped are copied to the cached frames */
+        void merge_retired() {
+            for (auto& retired: retired_frames) {
+                if (retired.image.empty())
+                    continue;
+                auto* data = retired.frame->data.get();
+                auto* image = retired.image.data();
+                auto size = retired.frame->size;
+                for (int64_t i = 0; i < size;) {
+                    i = std::mismatch(data + i, data + size, image + i).first - data;
+                    auto end = std::mismatch(data + i, data + size, image + i, std::not_equal_to<>()).first - data;
+                    if (end > i)
+                        write(retired.frame->begin + i, data + i, end - i);
+                    i = end;
+                }
+                retired.image = std::vector<uint8_t>();
+            }
+        }
+
+        /** Copies SIZE bytes of DATA to the frames caching [POS, POS + SIZE), they're read if they aren't cached */
+        void write(int64_t pos, const uint8_t* data, int64_t size) {
+            while (size > 0) {
+                auto it = frame_by_index.find(pos / frame_size);
+                auto* frame = it != frame_by_index.end() ? it->second : load(pos / frame_size, pos / frame_size);
+                auto bytes = std::min(size, frame->end() - pos);
+                std::memcpy(frame->data.get() + (pos - frame->begin), data, static_cast<size_t>(bytes));
+                frame->dirty = true;
+                pos += bytes;
+                data += bytes;
+                size -= bytes;
+            }
+        }
+
+        void evict() {
+            if (cached_bytes <= max_bytes || is_evict_blocked || value_pins.load(std::memory_order_acquire) > 0)
+                return;
+            // Every frame is visited at most twice: once to clear its reference bit and once to evict it
+            for (size_t steps = 0; cached_bytes > max_bytes && !frames.empty() && steps < 2 * frames.size();) {
+                if (hand >= frames.size())
+                    hand = 0;
+                auto& frame = *frames[hand];
+                if (frame.pins > 0 || frame.referenced) {
+                    frame.referenced = false;
+                    ++hand;
+                    ++steps;
+                    continue;
+                }
+
+                write_back(frame);
+                for (auto idx = frame.begin / frame_size; idx < frame.end() / frame_size; ++idx)
+                    frame_by_index.erase(idx);
+                cached_bytes -= frame.size;
+                // The last frame takes the place of the evicted one in the CLOCK order
+                frames[hand] = std::move(frames.back());
+                frames.pop_back();
+                steps = 0;
+            }
+            is_evict_blocked = cached_bytes > max_bytes;
+        }
+
+        void read(Frame& frame) {
+            int64_t done = 0;
+            while (done < frame.size && frame.begin + done < file_size) {
+                auto n = ::pread(fd, frame.data.get() + done, frame.size - done, frame.begin + done);
+                if (n <= 0)
+                    break;
+                done += n;
+            }
+            std::memset(frame.data.get() + done, 0, frame.size - done);
+        }
+
+        void write_back(Frame& frame) {
+            if (!frame.dirty || frame.begin >= file_size)
+                return;
+            // The direct I/O writes the whole aligned frames, the tail past the end of file is truncated on close
+            auto size = direct_io ? frame.size : std::min(frame.size, file_size - frame.begin);
+            for (int64_t done = 0; done < size;) {
+                auto n = ::pwrite(fd, frame.data.get() + done, size - done, frame.begin + done);
+                if (n <= 0)
+                    throw std::runtime_error("Can't write the buffered file");
+                done += n;
+            }
+            frame.dirty = false;
+        }
+#else
+        static constexpr bool is_supported = false;
+
+        BufferPool(const std::string&, const int64_t, const int64_t, const bool, const int32_t,
+                   const std::atomic<int32_t>&) {}
+        uint8_t* address(const int64_t, const int64_t, const bool) { return nullptr; }
+        void release() {}
+        void flush() {}
+        void resize(const int64_t) {}
+        void advise(const AccessPattern) {}
+        void prefetch(const int64_t, const int64_t) {}
+        void complete_prefetch() {}
+        bool has_read_ring() const { return false; }
+        int64_t get_cached_bytes() const { return 0; }
+        bool is_direct() const { return false; }
+#endif
+    };
+}
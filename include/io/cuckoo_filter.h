@@ -0,0 +1,308 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <boost/crc.hpp>
+
+#include "utils/utils.h"
+#include "reader_epochs.h"
+
+/**
+ * Filter file "<path>.filter" (written on close, dropped on open):
+ *     - TAG                      |=> takes 8 bytes                -> of the volume file as it was closed
+ *     - KEYS                     |=> takes 8 bytes                -> the number of keys in the filter
+ *     - BUCKETS_COUNT            |=> takes 8 bytes                -> a power of two
+ *     - BUCKETS                  |=> takes BUCKETS_COUNT * 8 bytes
+ *     - CRC32                    |=> takes 4 bytes                -> of the bytes above
+ * A missing or broken file or a file of another TAG isn't an error: the filter is built from the volume again.
+ */
+namespace btree {
+    /** Counters of the lookups checked by the filter of a volume */
+    struct FilterStats {
+        int64_t keys = 0;
+        int64_t size_in_bytes = 0;
+        /** The lookups of the absent keys: rejected by the filter or passed to the tree by a false positive */
+        uint64_t rejected = 0;
+        uint64_t false_positives = 0;
+
+        double false_positive_rate() const {
+            auto negatives = rejected + false_positives;
+            return negatives ? static_cast<double>(false_positives) / static_cast<double>(negatives) : 0.0;
+        }
+    };
+
+    /**
+     * Cuckoo filter of the keys of a volume: a key has a 16-bit fingerprint in one of its two buckets of 4 slots,
+     * so a removed key is removed from the filter and the false positive rate is about 0.01%. MAY_CONTAIN is false
+     * only for the keys which aren't in the filter.
+     *
+     * The readers don't take locks: the writer makes the version odd while it modifies the buckets, the reader which
+     * sees another version after the read takes the key as present (as VersionLatches). The tables replaced by
+     * REBUILD() and LOAD() are retired to the reader epochs and freed by the next writes once the readers which could
+     * see them have left. The writers must be serialized.
+     */
+    template <typename K>
+    class CuckooFilter final {
+        static constexpr int32_t SLOTS = 4;
+        static constexpr int32_t MAX_KICKS = 500;
+        static constexpr uint64_t LOWEST_BITS = 0x0001000100010001ull;
+        static constexpr uint64_t HIGHEST_BITS = 0x8000800080008000ull;
+        // TAG, KEYS, BUCKETS_COUNT
+        static constexpr size_t HEADER_WORDS = 3;
+
+        struct Table {
+            size_t mask;
+            std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+
+            explicit Table(const size_t count) : mask(count - 1), buckets(new std::atomic<uint64_t>[count]) {
+                for (size_t i = 0; i < count; ++i)
+                    buckets[i].store(0, std::memory_order_relaxed);
+            }
+
+            size_t size() const { return mask + 1; }
+        };
+
+        // The readers enter the epochs before they load TABLE
+        ReaderEpochs epochs;
+        std::atomic<Table*> table;
+        std::shared_ptr<Table> current;
+        std::atomic<uint64_t> version;
+        int64_t keys;
+        uint64_t kick_state;
+        mutable std::atomic<uint64_t> rejected;
+        mutable std::atomic<uint64_t> false_positives;
+    public:
+        /** The table holds EXPECTED_KEYS at 50% load at least */
+        explicit CuckooFilter(const int64_t expected_keys) :
+            version(0), keys(0), kick_state(0x9E3779B97F4A7C15ull), rejected(0), false_positives(0)
+        {
+            size_t count = 1024 / SLOTS;
+            while (count * SLOTS < 2 * static_cast<size_t>(std::max<int64_t>(expected_keys, 0)))
+                count *= 2;
+            current = std::make_shared<Table>(count);
+            table.store(current.get(), std::memory_order_release);
+        }
+
+        CuckooFilter(const CuckooFilter&) = delete;
+        CuckooFilter& operator=(const CuckooFilter&) = delete;
+
+        /** Thread-safe */
+        bool may_contain(const K key) const {
+            auto guard = epochs.enter();
+            auto before = version.load(std::memory_order_acquire);
+            if (before & 1)
+                return true;
+
+            auto* t = table.load(std::memory_order_acquire);
+            auto [first, fingerprint] = locate(key, t->mask);
+            bool found = has_fingerprint(t->buckets[first].load(std::memory_order_relaxed), fingerprint) ||
+                         has_fingerprint(t->buckets[alternate(first, fingerprint, t->mask)].load(std::memory_order_relaxed),
+                                         fingerprint);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return found || version.load(std::memory_order_relaxed) != before;
+        }
+
+        /** Thread-safe counters of the lookups: rejected by MAY_CONTAIN() or passed by it, but not found */
+        void record_rejected() const {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void record_false_positives(const uint64_t count) const {
+            false_positives.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        /**
+         * Adds KEY which isn't in the filter yet. Returns false and keeps the filter as it was if there's no place
+         * for KEY: the filter must be rebuilt larger
+         */
+        bool insert(const K key) {
+            begin_write();
+            bool inserted = put_key(*table.load(std::memory_order_relaxed), key);
+            keys += inserted;
+            end_write();
+            epochs.reclaim();
+            return inserted;
+        }
+
+        /** Removes KEY which is in the filter */
+        void remove(const K key) {
+            auto* t = table.load(std::memory_order_relaxed);
+            auto [first, fingerprint] = locate(key, t->mask);
+            begin_write();
+            if (take(*t, first, fingerprint) || take(*t, alternate(first, fingerprint, t->mask), fingerprint))
+                --keys;
+            end_write();
+            epochs.reclaim();
+        }
+
+        /**
+         * Replaces the keys of the filter by KEYS, the counters are kept. The new table is filled aside, so the readers
+         * see either the old keys or the new ones
+         */
+        void rebuild(const std::vector<K>& new_keys) {
+            auto count = table.load(std::memory_order_relaxed)->size();
+            while (count * SLOTS < 2 * new_keys.size())
+                count *= 2;
+            auto rebuilt = std::make_shared<Table>(count);
+            while (!std::all_of(new_keys.begin(), new_keys.end(), [&](const K key) { return put_key(*rebuilt, key); }))
+                rebuilt = std::make_shared<Table>(count *= 2);
+            replace(std::move(rebuilt), static_cast<int64_t>(new_keys.size()));
+        }
+
+        FilterStats stats() const {
+            FilterStats stats;
+            stats.keys = keys;
+            stats.size_in_bytes = static_cast<int64_t>(table.load(std::memory_order_relaxed)->size() * sizeof(uint64_t));
+            stats.rejected = rejected.load(std::memory_order_relaxed);
+            stats.false_positives = false_positives.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+        /** Returns false if the file can't be written */
+        bool save(const std::string& path, const uint64_t tag) const {
+            auto* t = table.load(std::memory_order_relaxed);
+            std::vector<uint64_t> image;
+            image.reserve(t->size() + HEADER_WORDS);
+            image.push_back(tag);
+            image.push_back(static_cast<uint64_t>(keys));
+            image.push_back(t->size());
+            for (size_t i = 0; i < t->size(); ++i)
+                image.push_back(t->buckets[i].load(std::memory_order_relaxed));
+
+            boost::crc_32_type crc;
+            crc.process_bytes(image.data(), image.size() * sizeof(uint64_t));
+            uint32_t checksum = crc.checksum();
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(image.data()), static_cast<std::streamsize>(image.size() * sizeof(uint64_t)));
+            out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+            return static_cast<bool>(out);
+        }
+
+        /** Replaces the keys of the filter by the ones saved in the file with TAG, returns false if there are none */
+        bool load(const std::string& path, const uint64_t tag) {
+            std::ifstream in(path, std::ios::binary);
+            uint64_t header[HEADER_WORDS];
+            if (!in.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != tag)
+                return false;
+            auto count = header[2];
+            if (count < 1 || (count & (count - 1)) != 0 || count > (uint64_t(1) << 32))
+                return false;
+
+            std::vector<uint64_t> image(count + HEADER_WORDS);
+            std::copy(header, header + HEADER_WORDS, image.begin());
+            uint32_t checksum;
+            in.read(reinterpret_cast<char*>(image.data() + HEADER_WORDS),
+                    static_cast<std::streamsize>(count * sizeof(uint64_t)));
+            in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
+            boost::crc_32_type crc;
+            crc.process_bytes(image.data(), image.size() * sizeof(uint64_t));
+            if (!in || crc.checksum() != checksum)
+                return false;
+
+            auto loaded = std::make_shared<Table>(count);
+            for (size_t i = 0; i < count; ++i)
+                loaded->buckets[i].store(image[i + HEADER_WORDS], std::memory_order_relaxed);
+            replace(std::move(loaded), static_cast<int64_t>(header[1]));
+            return true;
+        }
+
+        /** The replaced tables which aren't freed yet */
+        size_t retired_tables() const {
+            return epochs.retired_count();
+        }
+
+    private:
+        void begin_write() {
+            version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void end_write() {
+            version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /** Publishes the filled REPLACEMENT, the replaced table is freed once the readers which loaded it leave */
+        void replace(std::shared_ptr<Table> replacement, const int64_t new_keys) {
+            begin_write();
+            table.store(replacement.get(), std::memory_order_release);
+            keys = new_keys;
+            end_write();
+            current.swap(replacement);
+            epochs.retire(std::move(replacement));
+            epochs.reclaim();
+        }
+
+        /** The first bucket and the fingerprint of KEY, 0 marks an empty slot */
+        static std::pair<size_t, uint16_t> locate(const K key, const size_t mask) {
+            auto h = utils::mix_bits(static_cast<uint64_t>(key));
+            auto fingerprint = static_cast<uint16_t>(h >> 48);
+            return { static_cast<size_t>(h) & mask, fingerprint ? fingerprint : uint16_t(1) };
+        }
+
+        /** The other bucket of a fingerprint in INDEX: the buckets of a fingerprint are alternates of each other */
+        static size_t alternate(const size_t index, const uint16_t fingerprint, const size_t mask) {
+            return (index ^ static_cast<size_t>(utils::mix_bits(fingerprint))) & mask;
+        }
+
+        static bool has_fingerprint(const uint64_t bucket, const uint16_t fingerprint) {
+            // A zero lane of BUCKET ^ FINGERPRINT in every lane
+            auto x = bucket ^ (LOWEST_BITS * fingerprint);
+            return ((x - LOWEST_BITS) & ~x & HIGHEST_BITS) != 0;
+        }
+
+        /** The kicks are undone if KEY doesn't fit */
+        bool put_key(Table& t, const K key) {
+            auto [index, fingerprint] = locate(key, t.mask);
+            // The buckets changed by the kicks and their previous values
+            std::vector<std::pair<size_t, uint64_t>> kicked;
+            for (int32_t kicks = 0; kicks <= MAX_KICKS; ++kicks) {
+                if (put(t, index, fingerprint) || put(t, index = alternate(index, fingerprint, t.mask), fingerprint))
+                    return true;
+                // The fingerprint takes a random slot of the full bucket, the evicted one goes to its other bucket
+                kick_state ^= kick_state << 13;
+                kick_state ^= kick_state >> 7;
+                kick_state ^= kick_state << 17;
+                auto shift = 16 * (kick_state % SLOTS);
+                auto bucket = t.buckets[index].load(std::memory_order_relaxed);
+                kicked.emplace_back(index, bucket);
+                auto evicted = static_cast<uint16_t>(bucket >> shift);
+                bucket = (bucket & ~(uint64_t(0xFFFF) << shift)) | (uint64_t(fingerprint) << shift);
+                t.buckets[index].store(bucket, std::memory_order_relaxed);
+                fingerprint = evicted;
+            }
+            for (auto it = kicked.rbegin(); it != kicked.rend(); ++it)
+                t.buckets[it->first].store(it->second, std::memory_order_relaxed);
+            return false;
+        }
+
+        static bool put(Table& t, const size_t index, const uint16_t fingerprint) {
+            auto bucket = t.buckets[index].load(std::memory_order_relaxed);
+            for (int32_t slot = 0; slot < SLOTS; ++slot) {
+                auto shift = 16 * slot;
+                if (((bucket >> shift) & 0xFFFF) == 0) {
+                    t.buckets[index].store(bucket | (uint64_t(fingerprint) << shift), std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static bool take(Table& t, const size_t index, const uint16_t fingerprint) {
+            auto bucket = t.buckets[index].load(std::memory_order_relaxed);
+            for (int32_t slot = 0; slot < SLOTS; ++slot) {
+                auto shift = 16 * slot;
+                if (((bucket >> shift) & 0xFFFF) == fingerprint) {
+                    t.buckets[index].store(bucket & ~(uint64_t(0xFFFF) << shift), std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+}
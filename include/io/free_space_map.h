@@ -0,0 +1,67 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <optional>
+
+namespace btree {
+    /**
+     * Free space of the volume file:
+     *  - node slots take the same number of bytes, so they are recycled exactly (LIFO)
+     *  - entries vary in size, a free extent is taken with the best fit and the rest of it stays free
+     *    if it can hold the smallest entry
+     */
+    class FreeSpaceMap final {
+        std::vector<int64_t> node_slots;
+        std::multimap<int32_t, int64_t> extents;  // size -> pos
+        int32_t min_extent_size;
+    public:
+        explicit FreeSpaceMap(const int32_t min_extent_size) : min_extent_size(min_extent_size) {}
+
+        std::optional<int64_t> take_node() {
+            if (node_slots.empty())
+                return std::nullopt;
+
+            auto pos = node_slots.back();
+            node_slots.pop_back();
+            return pos;
+        }
+
+        void put_node(const int64_t pos) {
+            node_slots.push_back(pos);
+        }
+
+        std::optional<int64_t> take_extent(const int32_t size) {
+            auto it = extents.lower_bound(size);
+            if (it == extents.end())
+                return std::nullopt;
+
+            auto [extent_size, pos] = *it;
+            extents.erase(it);
+            put_extent(pos + size, extent_size - size);
+            return pos;
+        }
+
+        void put_extent(const int64_t pos, const int32_t size) {
+            if (size >= min_extent_size)
+                extents.emplace(size, pos);
+        }
+
+        const std::vector<int64_t>& nodes() const {
+            return node_slots;
+        }
+
+        const std::multimap<int32_t, int64_t>& entries() const {
+            return extents;
+        }
+
+        bool empty() const {
+            return node_slots.empty() && extents.empty();
+        }
+
+        void clear() {
+            node_slots.clear();
+            extents.clear();
+        }
+    };
+}
@@ -1,12 +1,23 @@
 #pragma once
 
+#include <optional>
+#include <unordered_map>
+
 #include "mapped_file.h"
+#include "write_ahead_log.h"
+#include "free_space_map.h"
+#include "version_latches.h"
+#include "version_store.h"
+#include "node_view.h"
+#include "value_codec.h"
 #include "utils/forward_decl.h"
+#include "utils/engine_type.h"
+#include "utils/compression.h"
 
 /**
  * Storage structures:
  *
- * - Header (6 bytes):
+ * - Header (24 bytes):
  *     - T                        |=> takes 2 bytes -> tree degree
  *     - KEY_SIZE                 |=> takes 1 byte
  *     - VALUE_TYPE               |=> takes 1 byte ->  VALUE_TYPE = 0 for integer primitives: int32_t, int64_t
@@ -18,12 +29,64 @@
  *     - ELEMENT_SIZE             |=> takes 1 byte  -> ELEMENT_SIZE = sizeof(VALUE_TYPE) for primitives
  *                                                     ELEMENT_SIZE = sizeof(VALUE_SUBTYPE) for containers or blob
  *     - ROOT POS                 |=> takes 8 bytes -> pos in file
+ *     - FORMAT_VERSION           |=> takes 1 byte  -> FORMAT_VERSION = 2 for nodes with inline keys
+ *                                                     FORMAT_VERSION = 3 for the header with ENGINE
+ *                                                     FORMAT_VERSION = 4 for the header with FREE_MAP_POS
+ *                                                     FORMAT_VERSION = 5 for the header with COMPRESSION
+ *                                                     FORMAT_VERSION = 6 for the arithmetic values inline in nodes
+ *                                                     Legacy files (v1) don't have this byte at all: their header
+ *                                                     takes 13 bytes and is followed by the first node FLAG (0 or 1)
+ *     - ENGINE                   |=> takes 1 byte  -> ENGINE = 0 for B-tree, ENGINE = 1 for B+ tree (since v3),
+ *                                                     ENGINE = 2 for B+ tree with packed keys,
+ *                                                     ENGINE = 3 for extendible hashing
+ *     - FREE_MAP_POS             |=> takes 8 bytes -> pos of the free space map in file or -1 (since v4)
+ *     - COMPRESSION              |=> takes 1 byte  -> the codec of the (w)string values (see Compression, since v5)
  *
  * - Node (N bytes):
  *     - FLAG                     |=> takes 1 byte                 -> for "is_deleted" or "is_leaf"
  *     - USED_KEYS                |=> takes 2 bytes                -> for the number of "active" keys in the node
- *     - KEY_POS                  |=> takes (2 * t - 1) * KEY_SIZE -> for key positions in file
- *     - CHILD_POS                |=> takes (2 * t) * KEY_SIZE     -> for key positions in file
+ *     - KEYS                     |=> takes (2 * t - 1) * KEY_SIZE -> for keys (since v2, absent in v1)
+ *     - KEY_POS                  |=> takes (2 * t - 1) * 8        -> for entry positions in file or inline values
+ *     - CHILD_POS                |=> takes (2 * t) * 8            -> for child positions in file
+ *
+ *   Nodes are placed in slots of NODE_SLOT_SIZE bytes aligned to their size (or to the page for the nodes larger than
+ *   a page): the slot is the smallest power of two that holds the node or a multiple of the page size, so a node never
+ *   straddles the pages. The slots are carved at the end of file by node extents of up to 64 KB, the entries are
+ *   appended between them and fill the padding before the extents. Files written before keep their unaligned nodes.
+ *
+ * - B+ tree node (the same N bytes as the B-tree node):
+ *     - FLAG                     |=> takes 1 byte                 -> for "is_leaf"
+ *     - USED_KEYS                |=> takes 2 bytes                -> for the number of "active" keys in the node
+ *     - inner node:
+ *        - KEYS                  |=> takes M * KEY_SIZE           -> for separator keys, M = (N - 11) / (KEY_SIZE + 8)
+ *        - CHILD_POS             |=> takes (M + 1) * 8            -> for child positions in file
+ *     - leaf node:
+ *        - PREV_LEAF_POS         |=> takes 8 bytes                -> for the left sibling position in file
+ *        - NEXT_LEAF_POS         |=> takes 8 bytes                -> for the right sibling position in file
+ *        - KEYS                  |=> takes L * KEY_SIZE           -> for keys, L = (N - 19) / (KEY_SIZE + 8)
+ *        - ENTRY_POS             |=> takes L * 8                  -> for entry positions in file or inline values
+ *
+ * - Packed B+ tree node (ENGINE = 2, the same N bytes):
+ *     - FLAG, USED_KEYS          |=> as above, then PREV_LEAF_POS and NEXT_LEAF_POS in leaves
+ *     - BASE_KEY                 |=> takes KEY_SIZE bytes         -> for the first key (0 in an empty node)
+ *     - DELTA_BITS               |=> takes 1 byte                 -> W, the bits of the largest KEY - BASE_KEY,
+ *                                                                     64 for more than 57 bits
+ *     - DELTAS                   |=> takes (USED_KEYS * W + 7) / 8 -> for KEY - BASE_KEY of every key, the delta I
+ *                                                                     takes W bits from bit I * W, little-endian
+ *     - ENTRY_POS / CHILD_POS    |=> takes USED_KEYS * 8 / (USED_KEYS + 1) * 8 -> for the positions in use
+ *   The rest of the node is zeroed. The positions follow the deltas, so a delta is read by one 8-byte load from
+ *   the byte of its first bit, a shift and a mask.
+ *
+ * - Extendible hash (ENGINE = 3): the buckets and the directory pages are B+ tree leaves of the plain layout
+ *     - bucket                   |=> a leaf of the sorted keys which hashes share the low LOCAL_DEPTH bits, the links
+ *                                    are INVALID_POS
+ *     - directory page           |=> a leaf of the next slots of the directory: KEYS are the local depths of the buckets,
+ *                                    ENTRY_POS their positions; the pages are linked, ROOT POS refers to the first one
+ *   The directory has 2^GLOBAL_DEPTH slots, the slot of a key is the low GLOBAL_DEPTH bits of its hash.
+ *
+ * - Inline values (since v6): a volume of arithmetic values keeps the value of a key in the node in place of its entry
+ *   position, the value bytes are in the low bytes of the 8 bytes and the rest is zeroed. Such a volume has no entries:
+ *   a lookup reads only the nodes and a value is updated in its node. Files written before keep their entries.
  *
  * - Entry (M bytes):
  *     - KEY                      |=> takes KEY_SIZE bytes (4 bytes is enough for 10^8 different keys)
@@ -32,40 +95,263 @@
  *     or
  *        - NUMBER_OF_ELEMENTS    |=> takes 4 bytes
  *        - VALUES                |=> takes (ELEMENT_SIZE * NUMBER_OF_ELEMENTS) bytes
+ *     or, for a value compressed by the COMPRESSION codec:
+ *        - -STORED_SIZE          |=> takes 4 bytes                -> the negated size of RAW_SIZE and DATA
+ *        - RAW_SIZE              |=> takes 4 bytes                -> the size of the decompressed value
+ *        - DATA                  |=> takes STORED_SIZE - 4 bytes
  *     ----------–-----
+ *   A (w)string value is compressed if it takes MIN_COMPRESSED_VALUE_SIZE bytes at least and gets smaller.
+ *
+ * - Free space map (written at the end of file on close, dropped on open):
+ *     - NODES_COUNT              |=> takes 8 bytes
+ *     - NODE_POS                 |=> takes NODES_COUNT * 8 bytes     -> for free node slots
+ *     - EXTENTS_COUNT            |=> takes 8 bytes
+ *     - EXTENT                   |=> takes EXTENTS_COUNT * 12 bytes  -> for free extents of entries: POS (8), SIZE (4)
+ *   Nodes and entries are allocated from the map before the file grows. The map isn't updated in place: if the volume
+ *   isn't closed properly, the free space is lost, but it's never used twice.
 */
 namespace btree {
     template <typename K, typename V>
     class IOManager {
         using Node = BTreeNode<K, V>;
+        using BPlusNode = BPlusTreeNode<K, V>;
         using EntryT = typename BTree<K, V>::EntryT;
 
         const int16_t t = 0;
+        const EngineType engine;
+        Compression compression;
+        uint8_t format_version;
         MappedFile<K,V> file;
+        FreeSpaceMap free_space;
+        WriteAheadLog<K, V>* wal;
+        VersionLatches* latches;
+        VersionStore versions;
+        const int32_t node_slot_size;
+        // The slots of the next node extent, the extents grow up to NODE_EXTENT_SIZE
+        int32_t node_extent_slots;
+        // Entries freed while the values are pinned: POS, SIZE
+        std::vector<std::pair<int64_t, int32_t>> pinned_free_extents;
+        bool detached;
+        // Images of the nodes written while the writes are deferred, they're read instead of the file
+        std::unordered_map<int64_t, std::vector<uint8_t>> deferred_nodes;
+        int64_t deferred_bytes;
+        bool defer_writes;
+        // The state of the file before the batch being written (see BEGIN_BATCH())
+        struct BatchUndo {
+            int64_t file_end;
+            FreeSpaceMap free_space;
+            std::vector<std::pair<int64_t, int32_t>> pinned_free_extents;
+            int32_t node_extent_slots;
+            uint8_t format_version;
+            size_t deferred_frees;
+            // The pages of the file before their first modification by the batch
+            std::unordered_map<int64_t, std::vector<uint8_t>> pages;
+        };
+        std::optional<BatchUndo> batch_undo;
+        // Serialized node, reused by the writes
+        std::vector<uint8_t> node_image;
+        // The compressed value of the entry being allocated and written: RAW_SIZE + DATA
+        std::vector<uint8_t> value_image;
+        const uint8_t* value_image_source;
+        // The value decompressed by the last READ_ENTRY()
+        std::vector<uint8_t> value_buffer;
 
         static constexpr uint8_t ROOT_POS_IN_HEADER = sizeof(t) + 3;
+        static constexpr uint8_t FORMAT_VERSION_IN_HEADER = ROOT_POS_IN_HEADER + sizeof(int64_t);
+        static constexpr uint8_t ENGINE_IN_HEADER = FORMAT_VERSION_IN_HEADER + sizeof(format_version);
+        static constexpr uint8_t FREE_MAP_POS_IN_HEADER = ENGINE_IN_HEADER + sizeof(engine);
+        static constexpr uint8_t COMPRESSION_IN_HEADER = FREE_MAP_POS_IN_HEADER + sizeof(int64_t);
+        static constexpr int32_t NODE_EXTENT_SIZE = 64 * 1024;
+        // The deferred nodes are written in the middle of a batch if they take more, a node may be written again then
+        static constexpr int64_t MAX_DEFERRED_BYTES = 64 * 1024 * 1024;
     public:
-        static constexpr int64_t INITIAL_ROOT_POS_IN_HEADER = ROOT_POS_IN_HEADER + sizeof(int64_t);
+        static constexpr uint8_t LEGACY_FORMAT_VERSION = 1;
+        static constexpr uint8_t INLINE_KEYS_FORMAT_VERSION = 2;
+        static constexpr uint8_t ENGINE_FORMAT_VERSION = 3;
+        static constexpr uint8_t FREE_MAP_FORMAT_VERSION = 4;
+        static constexpr uint8_t COMPRESSION_FORMAT_VERSION = 5;
+        static constexpr uint8_t INLINE_VALUES_FORMAT_VERSION = 6;
+        static constexpr uint8_t CURRENT_FORMAT_VERSION = INLINE_VALUES_FORMAT_VERSION;
+
+        static constexpr int64_t INITIAL_ROOT_POS_IN_HEADER = COMPRESSION_IN_HEADER + sizeof(uint8_t);
+        /** Smaller values aren't compressed */
+        static constexpr int32_t MIN_COMPRESSED_VALUE_SIZE = 64;
         static constexpr int64_t INVALID_POS = -1;
+        /** The header is latched as a whole at this position */
+        static constexpr int64_t HEADER_POS = 0;
 
-        IOManager(const std::string& path, const int16_t user_t);
+        /** COMPRESSION is only for the (w)string values: the other ones are read in place or take a few bytes */
+        IOManager(const std::string& path, const int16_t user_t, const EngineType engine = BTREE,
+                  const MappingOptions& mapping = MappingOptions(), const Compression compression = NO_COMPRESSION);
+        ~IOManager();
 
         bool is_ready() const;
+        uint8_t get_format_version() const;
+        EngineType get_engine() const;
+        Compression get_compression() const;
+        const std::string& get_path() const;
+        /** The arithmetic values are kept in the nodes of the volumes of FORMAT_VERSION (see the inline values above) */
+        static bool has_inline_values(const uint8_t format_version);
+        bool has_inline_values() const;
 
         int64_t write_node(const Node& node, const int64_t pos);
+        int64_t write_node(const BPlusNode& node, const int64_t pos);
         void write_entry(const EntryT& e, const int64_t pos);
 
         Node read_node(const int64_t pos);
-        EntryT read_entry(const int64_t pos);
+        BPlusNode read_bplus_node(const int64_t pos);
+        /**
+         * The entry of KEY referenced from a node by POS, an inline value is taken from POS itself. A compressed value is
+         * decompressed to a buffer, it's valid till the next read (see IS_DECOMPRESSED())
+         */
+        EntryT read_entry(const K key, const int64_t pos);
         K read_key(const int64_t pos);
+        /** The value of E read by READ_ENTRY() isn't in the file, but in the decompression buffer */
+        bool is_decompressed(const EntryT& e) const;
+
+        /** Zero-copy views for the lookups, they are valid till the next write (see NodeView) */
+        NodeView<K> view_node(const int64_t pos) const;
+        NodeView<K> view_bplus_node(const int64_t pos) const;
+
+        /** Access pattern hint for the volume file (see AccessPattern) */
+        void advise(const AccessPattern pattern);
+        /** The node or the entry is read ahead in the background, an entry with (w)string or blob only from its start */
+        void prefetch_node(const int64_t pos) const;
+        void prefetch_entry(const int64_t pos) const;
+        /** With the io_uring reads of the buffer pool the nodes and entries are read in batches, waits for the current one */
+        void complete_prefetch() const;
+        bool has_read_ring() const;
 
         int64_t read_header();
-        int64_t write_header();
+        /** The header of an empty tree: the root is allocated and set by WRITE_NEW_POS_FOR_ROOT_NODE() */
+        void write_header();
 
         void write_invalidated_root();
         void write_new_pos_for_root_node(const int64_t posRoot);
 
         int64_t get_file_pos_end();
+
+        /** Free slot or a slot of a new node extent at the end of file */
+        int64_t allocate_node();
+        void free_node(const int64_t pos);
+
+        /**
+         * Free extent or the end of file: the entry must be written before the next allocation. An inline value
+         * isn't allocated, written or freed: its "position" is the value itself
+         */
+        int64_t allocate_entry(const EntryT& e);
+        void free_entry(const int64_t pos);
+
+        /** Makes all the written nodes and entries durable */
+        void flush();
+
+        /**
+         * The pages of the file are saved to WAL before they're modified for the first time since its checkpoint,
+         * none if it's null. The log is discarded when the file is closed
+         */
+        void enable_wal(WriteAheadLog<K, V>* wal);
+
+        /**
+         * The nodes are kept in memory till WRITE_DEFERRED_NODES(): a node rewritten several times by a batch is written
+         * to the file once, the reads and views of the writer see the deferred nodes. The positions are latched as usual,
+         * the latches must be released after the deferred nodes are written.
+         */
+        void defer_node_writes();
+        void write_deferred_nodes();
+
+        /**
+         * A batch is applied whole or not at all: its nodes are deferred, the pages of the file are kept before they're
+         * modified for the first time and the free space before the batch. ROLLBACK_BATCH() restores them and drops
+         * the deferred nodes, COMMIT_BATCH() writes the nodes. The tree must be read from the file after the rollback,
+         * the latches are released after both as usual.
+         */
+        void begin_batch();
+        void commit_batch();
+        void rollback_batch();
+
+        /**
+         * The written positions are latched in LATCHES till RELEASE_LATCHES() for the concurrent optimistic readers,
+         * the file isn't shrunk while it's open and its replaced mappings are retired to READER_EPOCHS
+         */
+        void enable_latches(VersionLatches* latches, ReaderEpochs* reader_epochs);
+        void release_latches();
+        /** The file is replaced by another one: it's closed as is, without the free space map */
+        void detach();
+
+        /**
+         * Thread-safe reads for the optimistic readers: they don't move the file position and return nothing
+         * if the data is out of file (it's being modified concurrently)
+         */
+        std::pair<int64_t, uint8_t> read_root_pos_and_format() const;
+        std::optional<Node> try_read_node(const int64_t pos, const uint8_t format_version) const;
+        std::optional<BPlusNode> try_read_bplus_node(const int64_t pos) const;
+        /** Zero-copy reads for the optimistic readers, nothing if the flag or the size of the node is torn */
+        std::optional<NodeView<K>> try_view_node(const int64_t pos, const uint8_t format_version) const;
+        std::optional<NodeView<K>> try_view_bplus_node(const int64_t pos) const;
+        /**
+         * The entry of KEY referenced by POS from a node of a tree of FORMAT_VERSION. A compressed value is decompressed
+         * to a buffer of the thread, it's valid till the next read by the thread
+         */
+        std::optional<EntryT> try_read_entry(const K key, const int64_t pos, const uint8_t format_version) const;
+
+        /**
+         * Snapshots (see VersionStore): a node rewritten in place is copied first, the freed space isn't reused
+         * and the file isn't shrunk while a snapshot can read them
+         */
+        uint64_t take_snapshot();
+        void release_snapshot(const uint64_t epoch);
+        bool has_snapshots() const;
+
+        /** The entries read before aren't moved or reused while the guard is alive, it may outlive the lock */
+        ReadGuard pin_values() const;
+        bool has_pinned_values() const;
+        /** The addresses of the values are valid only till the next operation: the windows or the frames are released */
+        bool has_transient_addresses() const;
+
+        /** Bytes taken by a node in the file with the padding to the next slot (see the node layout above) */
+        static int32_t get_node_slot_size(const int16_t t);
+
+        /** Thread-safe reads of the nodes as they were when the snapshot of EPOCH was taken */
+        std::optional<Node> read_snapshot_node(const int64_t pos, const uint8_t format_version, const uint64_t epoch) const;
+        std::optional<BPlusNode> read_snapshot_bplus_node(const int64_t pos, const uint64_t epoch) const;
+    private:
+        void latch(const int64_t pos);
+        /** Installs the hook of the file which saves the pages to WAL and to the undo of the batch */
+        void update_before_write();
+        void save_batch_pages(const int64_t pos, const int64_t size);
+        /** Writes NODE_IMAGE at POS or defers it, returns the position after the node */
+        int64_t write_node_image(const int64_t pos);
+        /** Address of the node at POS: its deferred image or the mapping */
+        const uint8_t* node_address(const int64_t pos, const int32_t size) const;
+        /** View of the node at NODE, nothing if its flag or its size don't fit the layout */
+        std::optional<NodeView<K>> node_view(const uint8_t* node, const uint8_t version,
+                                             const typename NodeView<K>::ReadKeyFunc read_key) const;
+        std::optional<NodeView<K>> bplus_node_view(const uint8_t* node) const;
+        template <typename T>
+        static void append_to_image(std::vector<uint8_t>& image, const T value);
+        template <typename T>
+        static void append_to_image(std::vector<uint8_t>& image, const std::vector<T>& vec);
+        void copy_on_write(const int64_t pos);
+        void release_freed_space(const std::vector<VersionStore::FreedSpace>& freed);
+        void put_free_extent(const int64_t pos, const int32_t size);
+
+        std::optional<Node> read_node(typename MappedFile<K,V>::ConstReader reader, const int64_t pos,
+                                      const uint8_t format_version) const;
+        std::optional<BPlusNode> read_bplus_node(typename MappedFile<K,V>::ConstReader reader, const int64_t pos) const;
+
+        uint8_t read_format_version();
+        void read_free_space_map();
+        void write_free_space_map();
+
+        /** The size of the value of E in the file: the value is compressed to VALUE_IMAGE if it's worth it */
+        int32_t stored_value_size(const EntryT& e);
+        /** Decompresses the value stored as STORED_SIZE bytes of DATA (RAW_SIZE + DATA) to OUT */
+        bool decompress_value(const uint8_t* data, const int32_t stored_size, std::vector<uint8_t>& out) const;
+
+        static constexpr int32_t entry_size_in_bytes(const int32_t value_size);
+        /** The inline value of E in the place of its entry position and back */
+        static int64_t to_inline_value(const EntryT& e);
+        static EntryT from_inline_value(const K key, const int64_t pos);
     };
 }
 #include "io_manager_impl.h"
\ No newline at end of file
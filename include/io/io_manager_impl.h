@@ -1,22 +1,60 @@
 #pragma once
 
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
 #include "utils/utils.h"
 #include "utils/error.h"
 
 namespace btree {
     template <typename K, typename V>
-    IOManager<K, V>::IOManager(const std::string& path, const int16_t user_t) : t(user_t), file(path, 0) {}
+    IOManager<K, V>::IOManager(const std::string& path, const int16_t user_t, const EngineType engine,
+                               const MappingOptions& mapping, const Compression compression) :
+        t(user_t), engine(engine), compression(compression), format_version(CURRENT_FORMAT_VERSION),
+        file(path, 0, mapping),
+        free_space(entry_size_in_bytes(std::is_arithmetic_v<V> ? sizeof(V) : get_element_size<V>())), wal(nullptr),
+        latches(nullptr), node_slot_size(get_node_slot_size(user_t)), node_extent_slots(1), detached(false),
+        deferred_bytes(0), defer_writes(false), value_image_source(nullptr)
+    {
+        validate(compression == NO_COMPRESSION || is_string_v<V>, error_msg::compressed_values_msg, path);
+    }
+
+    template <typename K, typename V>
+    IOManager<K, V>::~IOManager() {
+        if (detached)
+            return;
+        try {
+            release_freed_space(versions.release_all());
+            for (const auto& [pos, size]: pinned_free_extents)
+                free_space.put_extent(pos, size);
+            write_free_space_map();
+            // The file is durable with the map: there is nothing to restore or replay
+            if (wal) {
+                file.flush();
+                wal->discard();
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Can't write the free space map: " + file.path << std::endl;
+        }
+    }
 
     template <typename K, typename V>
-    int64_t IOManager<K, V>::write_header() {
+    void IOManager<K, V>::write_header() {
+        latch(HEADER_POS);
+        // The file isn't shrunk while the snapshots can read it, then the new nodes are allocated after its end
         file.set_pos(0);
 
         file.write_next_primitive(t);
         file.template write_next_primitive<uint8_t>(sizeof(K));
         file.template write_next_primitive<uint8_t>(get_value_type_code<V>());
         file.template write_next_primitive<uint8_t>(get_element_size<V>());
-        file.write_next_primitive(INITIAL_ROOT_POS_IN_HEADER);
-        return file.get_pos();
+        file.write_next_primitive(INVALID_POS);
+        file.write_next_primitive(CURRENT_FORMAT_VERSION);
+        file.template write_next_primitive<uint8_t>(engine);
+        file.write_next_primitive(INVALID_POS);
+        file.template write_next_primitive<uint8_t>(compression);
+        format_version = CURRENT_FORMAT_VERSION;
     }
 
     template <typename K, typename V>
@@ -35,10 +73,75 @@ namespace btree {
         auto element_size = file.read_byte();
         validate(element_size == get_element_size<V>(), error_msg::wrong_element_size_msg, file.path);
 
-        auto posRoot = file.read_int32();
+        auto posRoot = file.read_int64();
+        format_version = read_format_version();
+
+        // Volumes without ENGINE in the header are B-trees
+        auto engine_code = BTREE;
+        if (format_version >= ENGINE_FORMAT_VERSION) {
+            file.set_pos(ENGINE_IN_HEADER);
+            engine_code = static_cast<EngineType>(file.read_byte());
+        }
+        validate(engine == engine_code, error_msg::wrong_engine_msg, file.path);
+
+        // Volumes without COMPRESSION in the header aren't compressed
+        auto compression_code = NO_COMPRESSION;
+        if (format_version >= COMPRESSION_FORMAT_VERSION) {
+            file.set_pos(COMPRESSION_IN_HEADER);
+            compression_code = static_cast<Compression>(file.read_byte());
+        }
+        validate(compression == compression_code, error_msg::wrong_compression_msg, file.path);
+
+        if (format_version >= FREE_MAP_FORMAT_VERSION)
+            read_free_space_map();
         return posRoot;
     }
 
+    template <typename K, typename V>
+    uint8_t IOManager<K, V>::read_format_version() {
+        // Legacy (v1) header ends right before FORMAT_VERSION, there the FLAG of the first node (0 or 1) is placed
+        if (get_file_pos_end() <= FORMAT_VERSION_IN_HEADER)
+            return LEGACY_FORMAT_VERSION;
+
+        file.set_pos(FORMAT_VERSION_IN_HEADER);
+        auto version = file.read_byte();
+        if (version <= LEGACY_FORMAT_VERSION)
+            return LEGACY_FORMAT_VERSION;
+
+        validate(version <= CURRENT_FORMAT_VERSION, error_msg::wrong_format_version_msg, file.path);
+        return version;
+    }
+
+    template <typename K, typename V>
+    uint8_t IOManager<K, V>::get_format_version() const {
+        return format_version;
+    }
+
+    template <typename K, typename V>
+    EngineType IOManager<K, V>::get_engine() const {
+        return engine;
+    }
+
+    template <typename K, typename V>
+    Compression IOManager<K, V>::get_compression() const {
+        return compression;
+    }
+
+    template <typename K, typename V>
+    const std::string& IOManager<K, V>::get_path() const {
+        return file.path;
+    }
+
+    template <typename K, typename V>
+    bool IOManager<K, V>::has_inline_values(const uint8_t version) {
+        return std::is_arithmetic_v<V> && version >= INLINE_VALUES_FORMAT_VERSION;
+    }
+
+    template <typename K, typename V>
+    bool IOManager<K, V>::has_inline_values() const {
+        return has_inline_values(format_version);
+    }
+
     template <typename K, typename V>
     bool IOManager<K, V>::is_ready() const {
         return !file.is_empty();
@@ -46,21 +149,83 @@ namespace btree {
 
     template <typename K, typename V>
     void IOManager<K, V>::write_entry(const EntryT& e, const int64_t pos) {
+        if (has_inline_values())
+            return;
+        latch(pos);
         file.set_pos(pos);
 
         file.write_next_primitive(e.key);
+        if constexpr (is_string_v<V>) {
+            // The value is compressed by ALLOCATE_ENTRY() or here if the entry wasn't allocated
+            bool compressed = (e.data == value_image_source) ? !value_image.empty() : stored_value_size(e) < 0;
+            value_image_source = nullptr;
+            if (compressed) {
+                file.write_next_primitive(-static_cast<int32_t>(value_image.size()));
+                file.write_node_vector(value_image);
+                return;
+            }
+        }
         file.write_next_data(e.data, e.size_in_bytes);
     }
 
     template <typename K, typename V>
-    typename BTree<K,V>::EntryT IOManager<K, V>::read_entry(const int64_t pos) {
+    typename BTree<K,V>::EntryT IOManager<K, V>::read_entry(const K key_in_node, const int64_t pos) {
+        if (has_inline_values())
+            return from_inline_value(key_in_node, pos);
         file.set_pos(pos);
 
         K key = file.template read_next_primitive<K>();
+        if constexpr (is_string_v<V>) {
+            if (compression != NO_COMPRESSION) {
+                auto size = file.template read_next_primitive<int32_t>();
+                if (size < 0) {
+                    auto* data = file.address(pos + sizeof(K) + sizeof(int32_t), -size);
+                    validate(decompress_value(data, -size, value_buffer), error_msg::corrupted_value_msg, file.path);
+                    return { key, value_buffer.data(), static_cast<int32_t>(value_buffer.size()) };
+                }
+                file.set_pos(pos + sizeof(K));
+            }
+        }
         auto [value, size] = file.template read_next_data<typename EntryT::ValueType>();
         return { key, value, size };
     }
 
+    template <typename K, typename V>
+    bool IOManager<K, V>::is_decompressed(const EntryT& e) const {
+        if constexpr (std::is_arithmetic_v<V>)
+            return false;
+        else
+            return compression != NO_COMPRESSION && e.data == value_buffer.data();
+    }
+
+    template <typename K, typename V>
+    int32_t IOManager<K, V>::stored_value_size(const EntryT& e) {
+        value_image.clear();
+        value_image_source = nullptr;
+        if constexpr (is_string_v<V>) {
+            if (compression != NO_COMPRESSION && e.size_in_bytes >= MIN_COMPRESSED_VALUE_SIZE) {
+                append_to_image(value_image, e.size_in_bytes);
+                ValueCodec::compress(compression, e.data, e.size_in_bytes, value_image);
+                value_image_source = e.data;
+                // RAW_SIZE and the compressed value are negated
+                if (value_image.size() < static_cast<size_t>(e.size_in_bytes))
+                    return -static_cast<int32_t>(value_image.size());
+                value_image.clear();
+            }
+        }
+        return e.size_in_bytes;
+    }
+
+    template <typename K, typename V>
+    bool IOManager<K, V>::decompress_value(const uint8_t* data, const int32_t stored_size,
+                                           std::vector<uint8_t>& out) const {
+        int32_t raw_size;
+        if (stored_size < static_cast<int32_t>(sizeof(raw_size)))
+            return false;
+        std::memcpy(&raw_size, data, sizeof(raw_size));
+        return ValueCodec::decompress(compression, data + sizeof(raw_size), stored_size - sizeof(raw_size), raw_size, out);
+    }
+
     template <typename K, typename V>
     K IOManager<K, V>::read_key(const int64_t pos) {
         file.set_pos(pos);
@@ -70,6 +235,7 @@ namespace btree {
 
     template <typename K, typename V>
     void IOManager<K, V>::write_new_pos_for_root_node(const int64_t posRoot) {
+        latch(HEADER_POS);
         file.set_pos(ROOT_POS_IN_HEADER);
 
         file.write_next_primitive(posRoot);
@@ -77,39 +243,810 @@ namespace btree {
 
     template <typename K, typename V>
     void IOManager<K, V>::write_invalidated_root() {
+        latch(HEADER_POS);
         file.set_pos(ROOT_POS_IN_HEADER);
 
         file.write_next_primitive(INVALID_POS);
-        file.shrink_to_fit();
+        // The tree is empty, so there is nothing left in the legacy format
+        file.write_next_primitive(CURRENT_FORMAT_VERSION);
+        file.template write_next_primitive<uint8_t>(engine);
+        file.write_next_primitive(INVALID_POS);
+        file.template write_next_primitive<uint8_t>(compression);
+        format_version = CURRENT_FORMAT_VERSION;
+        free_space.clear();
+        deferred_nodes.clear();
+        deferred_bytes = 0;
+        // The snapshots may still read the nodes and entries, the pinned values and concurrent readers the file
+        if (versions.has_snapshots() || file.is_pinned())
+            return;
+        // The bytes dropped by a batch may be restored by its rollback, the file is shrunk when it's closed
+        if (latches || batch_undo)
+            file.truncate(file.get_pos());
+        else
+            file.shrink_to_fit();
     }
 
     template <typename K, typename V>
     int64_t IOManager<K, V>::write_node(const Node& node, const int64_t pos) {
+        latch(pos);
+        copy_on_write(pos);
+
+        node_image.clear();
+        append_to_image(node_image, node.is_leaf);
+        append_to_image(node_image, node.used_keys);
+        if (format_version != LEGACY_FORMAT_VERSION)
+            append_to_image(node_image, node.keys);
+        append_to_image(node_image, node.key_pos);
+        append_to_image(node_image, node.child_pos);
+        return write_node_image(pos);
+    }
+
+    template <typename K, typename V>
+    int64_t IOManager<K, V>::write_node(const BPlusNode& node, const int64_t pos) {
+        latch(pos);
+        copy_on_write(pos);
+
+        node_image.clear();
+        append_to_image(node_image, node.is_leaf);
+        append_to_image(node_image, node.used_keys);
+        if (node.is_leaf) {
+            append_to_image(node_image, node.prev_leaf_pos);
+            append_to_image(node_image, node.next_leaf_pos);
+        }
+        if (node.packed_keys) {
+            // BASE_KEY + DELTA_BITS, the bits of the deltas, then the positions in use only
+            using UnsignedK = std::make_unsigned_t<K>;
+            auto base = node.used_keys > 0 ? node.keys[0] : K{};
+            auto bits = node.used_keys > 0 ? BPlusNode::delta_bits(base, node.keys[node.used_keys - 1]) : 1;
+            append_to_image(node_image, base);
+            append_to_image(node_image, static_cast<uint8_t>(bits));
+            auto deltas_offset = node_image.size();
+            node_image.resize(deltas_offset + (node.used_keys * bits + 7) / 8, 0);
+            for (auto i = 0; i < node.used_keys; ++i) {
+                auto delta = static_cast<uint64_t>(static_cast<UnsignedK>(static_cast<UnsignedK>(node.keys[i]) -
+                                                                          static_cast<UnsignedK>(base)));
+                // The bits of the delta are or-ed into the bytes they cross
+                for (int32_t done = 0, bit = i * bits; done < bits;) {
+                    auto shift = (bit + done) % 8;
+                    node_image[deltas_offset + (bit + done) / 8] |= static_cast<uint8_t>((delta >> done) << shift);
+                    done += 8 - shift;
+                }
+            }
+            auto& positions = node.is_leaf ? node.entry_pos : node.child_pos;
+            auto* data = cast_to_const_uint8_t_data(positions.data());
+            auto positions_count = node.used_keys + (node.is_leaf ? 0 : 1);
+            node_image.insert(node_image.end(), data, data + positions_count * sizeof(int64_t));
+        } else if (node.is_leaf) {
+            append_to_image(node_image, node.keys);
+            append_to_image(node_image, node.entry_pos);
+        } else {
+            append_to_image(node_image, node.keys);
+            append_to_image(node_image, node.child_pos);
+        }
+
+        // The arrays may not fill the node completely, but the node takes the whole slot in file
+        auto node_size = static_cast<size_t>(BPlusNode::get_node_size_in_bytes(t));
+        if (node_image.size() < node_size)
+            node_image.resize(node_size, 0);
+        return write_node_image(pos);
+    }
+
+    template <typename K, typename V>
+    int64_t IOManager<K, V>::write_node_image(const int64_t pos) {
+        if (!defer_writes) {
+            file.set_pos(pos);
+            file.write_node_vector(node_image);
+            return file.get_pos();
+        }
+
+        auto [it, inserted] = deferred_nodes.try_emplace(pos);
+        if (inserted)
+            deferred_bytes += static_cast<int64_t>(node_image.size());
+        // The image of the same size is copied in place: the views of the node stay valid
+        it->second = node_image;
+        if (deferred_bytes > MAX_DEFERRED_BYTES) {
+            write_deferred_nodes();
+            defer_writes = true;
+        }
+        return pos + static_cast<int64_t>(node_image.size());
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::defer_node_writes() {
+        defer_writes = true;
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::write_deferred_nodes() {
+        defer_writes = false;
+        // In the file order: the neighbour nodes share the pages
+        std::vector<int64_t> positions;
+        positions.reserve(deferred_nodes.size());
+        for (const auto& [pos, image]: deferred_nodes)
+            positions.push_back(pos);
+        std::sort(positions.begin(), positions.end());
+        for (auto pos: positions) {
+            file.set_pos(pos);
+            file.write_node_vector(deferred_nodes[pos]);
+        }
+        deferred_nodes.clear();
+        deferred_bytes = 0;
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::begin_batch() {
+        batch_undo = BatchUndo{ get_file_pos_end(), free_space, pinned_free_extents, node_extent_slots, format_version,
+                                versions.freed_count(), {} };
+        update_before_write();
+        defer_node_writes();
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::commit_batch() {
+        write_deferred_nodes();
+        batch_undo.reset();
+        update_before_write();
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::rollback_batch() {
+        auto undo = std::move(*batch_undo);
+        batch_undo.reset();
+        update_before_write();
+        defer_writes = false;
+        deferred_nodes.clear();
+        deferred_bytes = 0;
+
+        for (const auto& [pos, page]: undo.pages) {
+            file.set_pos(pos);
+            file.write_node_vector(page);
+        }
+        // The file is back to its end before the batch, the grown part is dropped when it's closed
+        file.extend(undo.file_end);
+        file.truncate(undo.file_end);
+        free_space = std::move(undo.free_space);
+        pinned_free_extents = std::move(undo.pinned_free_extents);
+        node_extent_slots = undo.node_extent_slots;
+        format_version = undo.format_version;
+        // The space freed by the batch is in use again
+        versions.drop_freed(undo.deferred_frees);
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::update_before_write() {
+        if (!wal && !batch_undo) {
+            file.set_before_write(nullptr);
+            return;
+        }
+        file.set_before_write([this](const int64_t pos, const int64_t size) {
+            save_batch_pages(pos, size);
+            if (wal) {
+                wal->save_pages(pos, size, [this](const int64_t page_pos, const int64_t bytes) {
+                    return file.address(page_pos, bytes);
+                });
+            }
+        });
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::save_batch_pages(const int64_t pos, const int64_t size) {
+        if (!batch_undo)
+            return;
+        // Only the bytes of the file before the batch are restored
+        static const int64_t page_size = bip::mapped_region::get_page_size();
+        auto end = std::min(pos + size, batch_undo->file_end);
+        for (auto page_pos = pos / page_size * page_size; page_pos < end; page_pos += page_size) {
+            auto [it, inserted] = batch_undo->pages.try_emplace(page_pos);
+            if (!inserted)
+                continue;
+            auto bytes = std::min(page_size, batch_undo->file_end - page_pos);
+            auto* data = file.address(page_pos, bytes);
+            it->second.assign(data, data + bytes);
+        }
+    }
+
+    template <typename K, typename V>
+    template <typename T>
+    void IOManager<K, V>::append_to_image(std::vector<uint8_t>& image, const T value) {
+        static_assert(std::is_arithmetic_v<T>);
+        auto* data = cast_to_const_uint8_t_data(&value);
+        image.insert(image.end(), data, data + sizeof(T));
+    }
+
+    template <typename K, typename V>
+    template <typename T>
+    void IOManager<K, V>::append_to_image(std::vector<uint8_t>& image, const std::vector<T>& vec) {
+        auto* data = cast_to_const_uint8_t_data(vec.data());
+        image.insert(image.end(), data, data + sizeof(T) * vec.size());
+    }
+
+    template <typename K, typename V>
+    const uint8_t* IOManager<K, V>::node_address(const int64_t pos, const int32_t size) const {
+        if (auto it = deferred_nodes.find(pos); it != deferred_nodes.end())
+            return it->second.data();
+        return file.address(pos, size);
+    }
+
+    template <typename K, typename V>
+    BPlusTreeNode <K, V> IOManager<K, V>::read_bplus_node(const int64_t pos) {
+        if (auto it = deferred_nodes.find(pos); it != deferred_nodes.end()) {
+            auto& image = it->second;
+            return *read_bplus_node(typename MappedFile<K,V>::ConstReader(image.data(), image.size(), 0), pos);
+        }
+        if (engine == PACKED_BPLUS_TREE) {
+            auto node_size = BPlusNode::get_node_size_in_bytes(t);
+            auto node = read_bplus_node(typename MappedFile<K,V>::ConstReader(node_address(pos, node_size), node_size, 0), pos);
+            validate(node.has_value(), error_msg::wrong_node_msg, file.path);
+            return *node;
+        }
         file.set_pos(pos);
 
-        file.write_next_primitive(node.is_leaf);
-        file.write_next_primitive(node.used_keys);
-        file.write_node_vector(node.key_pos);
-        file.write_node_vector(node.child_pos);
-        return file.get_pos();
+        bool is_leaf = file.read_byte();
+        BPlusNode node(t, is_leaf);
+        node.m_pos = pos;
+        node.used_keys = file.read_int16();
+        if (is_leaf) {
+            node.prev_leaf_pos = file.read_int64();
+            node.next_leaf_pos = file.read_int64();
+            file.read_node_vector(node.keys);
+            file.read_node_vector(node.entry_pos);
+        } else {
+            file.read_node_vector(node.keys);
+            file.read_node_vector(node.child_pos);
+        }
+        return node;
     }
 
     template <typename K, typename V>
     BTreeNode <K, V> IOManager<K, V>::read_node(const int64_t pos) {
+        if (auto it = deferred_nodes.find(pos); it != deferred_nodes.end()) {
+            auto& image = it->second;
+            return *read_node(typename MappedFile<K,V>::ConstReader(image.data(), image.size(), 0), pos, format_version);
+        }
         file.set_pos(pos);
 
         Node node(t, false);
         node.m_pos = pos;
         node.is_leaf = file.read_byte();
         node.used_keys = file.read_int16();
-        file.read_node_vector(node.key_pos);
-        file.read_node_vector(node.child_pos);
+        if (format_version != LEGACY_FORMAT_VERSION) {
+            file.read_node_vector(node.keys);
+            file.read_node_vector(node.key_pos);
+            file.read_node_vector(node.child_pos);
+        } else {
+            file.read_node_vector(node.key_pos);
+            file.read_node_vector(node.child_pos);
+            for (auto i = 0; i < node.used_keys; ++i)
+                node.keys[i] = read_key(node.key_pos[i]);
+        }
         return node;
     }
 
+    template <typename K, typename V>
+    NodeView<K> IOManager<K, V>::view_node(const int64_t pos) const {
+        auto* node = node_address(pos, Node::get_node_size_in_bytes(t));
+        auto view = node_view(node, format_version, [](const void* f, const int64_t pos) {
+            auto* key = static_cast<const MappedFile<K,V>*>(f)->address(pos, sizeof(K));
+            K value;
+            std::memcpy(&value, key, sizeof(K));
+            return value;
+        });
+        validate(view.has_value(), error_msg::wrong_node_msg, file.path);
+        return *view;
+    }
+
+    template <typename K, typename V>
+    NodeView<K> IOManager<K, V>::view_bplus_node(const int64_t pos) const {
+        auto view = bplus_node_view(node_address(pos, BPlusNode::get_node_size_in_bytes(t)));
+        validate(view.has_value(), error_msg::wrong_node_msg, file.path);
+        return *view;
+    }
+
+    template <typename K, typename V>
+    std::optional<NodeView<K>> IOManager<K, V>::try_view_node(const int64_t pos, const uint8_t version) const {
+        auto* node = file.const_reader(pos).read_next_bytes(Node::get_node_size_in_bytes(t));
+        if (!node)
+            return std::nullopt;
+        // The entry position of a legacy key may be torn too
+        return node_view(node, version, [](const void* f, const int64_t pos) {
+            return static_cast<const MappedFile<K,V>*>(f)->const_reader(pos).template read_next_primitive<K>();
+        });
+    }
+
+    template <typename K, typename V>
+    std::optional<NodeView<K>> IOManager<K, V>::try_view_bplus_node(const int64_t pos) const {
+        auto* node = file.const_reader(pos).read_next_bytes(BPlusNode::get_node_size_in_bytes(t));
+        return node ? bplus_node_view(node) : std::nullopt;
+    }
+
+    template <typename K, typename V>
+    std::optional<NodeView<K>> IOManager<K, V>::node_view(const uint8_t* node, const uint8_t version,
+                                                          const typename NodeView<K>::ReadKeyFunc read_key) const {
+        // FLAG + USED_KEYS, then KEYS (since v2), KEY_POS and CHILD_POS of 2 * t - 1 keys
+        constexpr int32_t header_size = sizeof(uint8_t) + sizeof(int16_t);
+        const int32_t max_keys = 2 * t - 1;
+        const bool is_leaf = node[0];
+        int16_t used_keys;
+        std::memcpy(&used_keys, node + sizeof(uint8_t), sizeof(int16_t));
+        if (used_keys < 0 || used_keys > max_keys)
+            return std::nullopt;
+        auto keys_size = (version != LEGACY_FORMAT_VERSION) ? max_keys * static_cast<int32_t>(sizeof(K)) : 0;
+        auto keys_offset = (version != LEGACY_FORMAT_VERSION) ? header_size : -1;
+        auto key_pos_offset = header_size + keys_size;
+        auto child_pos_offset = key_pos_offset + max_keys * static_cast<int32_t>(sizeof(int64_t));
+        return NodeView<K>(node, is_leaf, used_keys, keys_offset, key_pos_offset, child_pos_offset, &file, read_key);
+    }
+
+    template <typename K, typename V>
+    std::optional<NodeView<K>> IOManager<K, V>::bplus_node_view(const uint8_t* node) const {
+        // FLAG + USED_KEYS, then PREV_LEAF_POS + NEXT_LEAF_POS in leaves, then KEYS and ENTRY_POS / CHILD_POS
+        constexpr int32_t header_size = sizeof(uint8_t) + sizeof(int16_t);
+        constexpr int32_t links_size = 2 * sizeof(int64_t);
+        const bool is_leaf = node[0];
+        int16_t used_keys;
+        std::memcpy(&used_keys, node + sizeof(uint8_t), sizeof(int16_t));
+        auto is_packed = engine == PACKED_BPLUS_TREE;
+        auto max_keys = is_leaf ? BPlusNode::max_leaf_keys(t, is_packed) : BPlusNode::max_inner_keys(t, is_packed);
+        if (used_keys < 0 || used_keys > max_keys)
+            return std::nullopt;
+        if (is_packed) {
+            // BASE_KEY + DELTA_BITS after the links, the deltas of USED_KEYS keys, then ENTRY_POS / CHILD_POS
+            auto base_offset = header_size + (is_leaf ? links_size : 0);
+            auto deltas_offset = base_offset + static_cast<int32_t>(sizeof(K) + sizeof(uint8_t));
+            K base;
+            std::memcpy(&base, node + base_offset, sizeof(K));
+            int32_t bits = node[base_offset + sizeof(K)];
+            auto positions_offset = deltas_offset + (used_keys * bits + 7) / 8;
+            auto positions_count = used_keys + (is_leaf ? 0 : 1);
+            // A torn header may give the bits of the other keys
+            if (bits < 1 || bits > 8 * static_cast<int32_t>(sizeof(K)) ||
+                positions_offset + positions_count * static_cast<int32_t>(sizeof(int64_t)) >
+                BPlusNode::get_node_size_in_bytes(t))
+                return std::nullopt;
+            return NodeView<K>(node, is_leaf, used_keys, base, bits, deltas_offset, is_leaf ? positions_offset : -1,
+                               is_leaf ? -1 : positions_offset);
+        }
+        if (is_leaf) {
+            auto keys_size = BPlusNode::max_leaf_keys(t) * static_cast<int32_t>(sizeof(K));
+            return NodeView<K>(node, is_leaf, used_keys, header_size + links_size,
+                               header_size + links_size + keys_size, -1);
+        }
+        auto keys_size = BPlusNode::max_inner_keys(t) * static_cast<int32_t>(sizeof(K));
+        return NodeView<K>(node, is_leaf, used_keys, header_size, -1, header_size + keys_size);
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::advise(const AccessPattern pattern) {
+        file.advise(pattern);
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::prefetch_node(const int64_t pos) const {
+        // B+ tree nodes take the same size
+        file.prefetch(pos, Node::get_node_size_in_bytes(t));
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::prefetch_entry(const int64_t pos) const {
+        if (has_inline_values())
+            return;
+        file.prefetch(pos, entry_size_in_bytes(std::is_arithmetic_v<V> ? sizeof(V) : 0));
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::complete_prefetch() const {
+        file.complete_prefetch();
+    }
+
+    template <typename K, typename V>
+    bool IOManager<K, V>::has_read_ring() const {
+        return file.has_read_ring();
+    }
+
     template <typename K, typename V>
     int64_t IOManager<K, V>::get_file_pos_end() {
         file.set_file_pos_to_end();
         return file.get_pos();
     }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::flush() {
+        file.flush();
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::enable_wal(WriteAheadLog<K, V>* write_ahead_log) {
+        wal = write_ahead_log;
+        update_before_write();
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::enable_latches(VersionLatches* version_latches, ReaderEpochs* reader_epochs) {
+        validate(!file.is_windowed(), error_msg::windowed_mapping_msg, file.path);
+        latches = version_latches;
+        file.retire_mappings_to(reader_epochs);
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::release_latches() {
+        if (latches)
+            latches->release_all();
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::latch(const int64_t pos) {
+        if (latches)
+            latches->latch(pos);
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::detach() {
+        detached = true;
+        file.detach();
+    }
+
+    template <typename K, typename V>
+    std::pair<int64_t, uint8_t> IOManager<K, V>::read_root_pos_and_format() const {
+        auto reader = file.const_reader(ROOT_POS_IN_HEADER);
+        auto root_pos = reader.template read_next_primitive<int64_t>();
+        if (reader.is_failed()) // the file is empty
+            return { INVALID_POS, CURRENT_FORMAT_VERSION };
+
+        // See read_format_version()
+        auto version = reader.template read_next_primitive<uint8_t>();
+        if (reader.is_failed() || version <= LEGACY_FORMAT_VERSION)
+            version = LEGACY_FORMAT_VERSION;
+        return { root_pos, version };
+    }
+
+    template <typename K, typename V>
+    std::optional<BTreeNode<K, V>> IOManager<K, V>::try_read_node(const int64_t pos, const uint8_t version) const {
+        return read_node(file.const_reader(pos), pos, version);
+    }
+
+    template <typename K, typename V>
+    std::optional<BPlusTreeNode<K, V>> IOManager<K, V>::try_read_bplus_node(const int64_t pos) const {
+        return read_bplus_node(file.const_reader(pos), pos);
+    }
+
+    template <typename K, typename V>
+    std::optional<BTreeNode<K, V>> IOManager<K, V>::read_node(typename MappedFile<K,V>::ConstReader reader,
+                                                              const int64_t pos, const uint8_t version) const {
+        Node node(t, false);
+        node.m_pos = pos;
+        node.is_leaf = reader.template read_next_primitive<uint8_t>();
+        node.used_keys = reader.template read_next_primitive<int16_t>();
+        if (version != LEGACY_FORMAT_VERSION)
+            reader.read_node_vector(node.keys);
+        reader.read_node_vector(node.key_pos);
+        reader.read_node_vector(node.child_pos);
+        if (reader.is_failed() || node.used_keys < 0 || node.used_keys >= 2 * t)
+            return std::nullopt;
+
+        if (version == LEGACY_FORMAT_VERSION) {
+            // The keys are read from the entries: they are never rewritten in place
+            for (auto i = 0; i < node.used_keys; ++i) {
+                auto key_reader = file.const_reader(node.key_pos[i]);
+                node.keys[i] = key_reader.template read_next_primitive<K>();
+                if (key_reader.is_failed())
+                    return std::nullopt;
+            }
+        }
+        return node;
+    }
+
+    template <typename K, typename V>
+    std::optional<BPlusTreeNode<K, V>> IOManager<K, V>::read_bplus_node(typename MappedFile<K,V>::ConstReader reader,
+                                                                        const int64_t pos) const {
+        bool is_leaf = reader.template read_next_primitive<uint8_t>();
+        BPlusNode node(t, is_leaf, engine == PACKED_BPLUS_TREE);
+        node.m_pos = pos;
+        node.used_keys = reader.template read_next_primitive<int16_t>();
+        if (is_leaf) {
+            node.prev_leaf_pos = reader.template read_next_primitive<int64_t>();
+            node.next_leaf_pos = reader.template read_next_primitive<int64_t>();
+        }
+        if (node.packed_keys) {
+            using UnsignedK = std::make_unsigned_t<K>;
+            auto base = reader.template read_next_primitive<K>();
+            int32_t bits = reader.template read_next_primitive<uint8_t>();
+            if (reader.is_failed() || bits < 1 || bits > 8 * static_cast<int32_t>(sizeof(K)) ||
+                node.used_keys < 0 || node.used_keys > node.max_keys())
+                return std::nullopt;
+            auto* deltas = reader.read_next_bytes((node.used_keys * bits + 7) / 8);
+            auto positions_count = node.used_keys + (is_leaf ? 0 : 1);
+            auto* positions = reader.read_next_bytes(positions_count * static_cast<int32_t>(sizeof(int64_t)));
+            if (reader.is_failed())
+                return std::nullopt;
+            // The positions follow the deltas: the 8 bytes from the first byte of a delta are in the node
+            auto mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+            for (auto i = 0; i < node.used_keys; ++i) {
+                uint64_t word;
+                std::memcpy(&word, deltas + i * bits / 8, sizeof(word));
+                auto delta = (word >> (i * bits % 8)) & mask;
+                node.keys[i] = static_cast<K>(static_cast<UnsignedK>(static_cast<UnsignedK>(base) + delta));
+            }
+            auto& node_positions = is_leaf ? node.entry_pos : node.child_pos;
+            std::memcpy(node_positions.data(), positions, positions_count * sizeof(int64_t));
+            return node;
+        }
+        if (is_leaf) {
+            reader.read_node_vector(node.keys);
+            reader.read_node_vector(node.entry_pos);
+        } else {
+            reader.read_node_vector(node.keys);
+            reader.read_node_vector(node.child_pos);
+        }
+        if (reader.is_failed() || node.used_keys < 0 || node.used_keys > node.max_keys())
+            return std::nullopt;
+        return node;
+    }
+
+    template <typename K, typename V>
+    std::optional<typename BTree<K, V>::EntryT> IOManager<K, V>::try_read_entry(const K key_in_node, const int64_t pos,
+                                                                               const uint8_t version) const {
+        if (has_inline_values(version))
+            return from_inline_value(key_in_node, pos);
+        auto reader = file.const_reader(pos);
+
+        K key = reader.template read_next_primitive<K>();
+        int32_t size = sizeof(V);
+        if constexpr (!std::is_arithmetic_v<V>)
+            size = reader.template read_next_primitive<int32_t>();
+        auto* data = reader.read_next_bytes(std::abs(size));
+        if (reader.is_failed())
+            return std::nullopt;
+
+        if constexpr (is_string_v<V>) {
+            if (size < 0) {
+                // The readers of the thread don't share the buffer with the others
+                thread_local std::vector<uint8_t> buffer;
+                if (!decompress_value(data, -size, buffer))
+                    return std::nullopt;
+                return EntryT{ key, buffer.data(), static_cast<int32_t>(buffer.size()) };
+            }
+        }
+
+        if constexpr (std::is_arithmetic_v<V>) {
+            V value;
+            std::copy(data, data + sizeof(V), cast_to_uint8_t_data(&value));
+            return EntryT{ key, value };
+        } else {
+            return EntryT{ key, data, size };
+        }
+    }
+
+    template <typename K, typename V>
+    int64_t IOManager<K, V>::allocate_node() {
+        if (auto pos = free_space.take_node())
+            return *pos;
+
+        // The padding before the aligned extent is left to the entries
+        auto end = get_file_pos_end();
+        auto alignment = std::min<int64_t>(node_slot_size, bip::mapped_region::get_page_size());
+        auto extent_pos = (end + alignment - 1) / alignment * alignment;
+        free_space.put_extent(end, static_cast<int32_t>(extent_pos - end));
+
+        auto slots = node_extent_slots;
+        file.extend(extent_pos + static_cast<int64_t>(slots) * node_slot_size);
+        node_extent_slots = std::min(2 * node_extent_slots, std::max(NODE_EXTENT_SIZE / node_slot_size, 1));
+        // The slots are taken in the file order
+        for (auto i = slots - 1; i > 0; --i)
+            free_space.put_node(extent_pos + static_cast<int64_t>(i) * node_slot_size);
+        return extent_pos;
+    }
+
+    template <typename K, typename V>
+    int32_t IOManager<K, V>::get_node_slot_size(const int16_t t) {
+        auto node_size = Node::get_node_size_in_bytes(t);
+        auto page_size = static_cast<int32_t>(bip::mapped_region::get_page_size());
+        if (node_size >= page_size)
+            return (node_size + page_size - 1) / page_size * page_size;
+
+        int32_t slot_size = 1;
+        while (slot_size < node_size)
+            slot_size *= 2;
+        return slot_size;
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::free_node(const int64_t pos) {
+        if (versions.has_snapshots())
+            versions.defer_free({ true, pos, 0 });
+        else
+            free_space.put_node(pos);
+    }
+
+    template <typename K, typename V>
+    int64_t IOManager<K, V>::allocate_entry(const EntryT& e) {
+        if (has_inline_values())
+            return to_inline_value(e);
+        if (!pinned_free_extents.empty() && !file.is_pinned()) {
+            for (const auto& [pos, size]: pinned_free_extents)
+                free_space.put_extent(pos, size);
+            pinned_free_extents.clear();
+        }
+        if (auto pos = free_space.take_extent(entry_size_in_bytes(std::abs(stored_value_size(e)))))
+            return *pos;
+        return get_file_pos_end();
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::free_entry(const int64_t pos) {
+        if (has_inline_values())
+            return;
+        int32_t value_size = sizeof(V);
+        if constexpr (!std::is_arithmetic_v<V>) {
+            file.set_pos(pos + sizeof(K));
+            // A compressed value takes the negated size
+            value_size = std::abs(file.read_int32());
+        }
+        if (versions.has_snapshots())
+            versions.defer_free({ false, pos, entry_size_in_bytes(value_size) });
+        else
+            put_free_extent(pos, entry_size_in_bytes(value_size));
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::put_free_extent(const int64_t pos, const int32_t size) {
+        // A pinned value may still be read, the extent is reused when all the pins are released
+        if (file.is_pinned())
+            pinned_free_extents.emplace_back(pos, size);
+        else
+            free_space.put_extent(pos, size);
+    }
+
+    template <typename K, typename V>
+    ReadGuard IOManager<K, V>::pin_values() const {
+        return file.pin();
+    }
+
+    template <typename K, typename V>
+    bool IOManager<K, V>::has_pinned_values() const {
+        return file.is_pinned();
+    }
+
+    template <typename K, typename V>
+    bool IOManager<K, V>::has_transient_addresses() const {
+        return file.is_windowed();
+    }
+
+    template <typename K, typename V>
+    uint64_t IOManager<K, V>::take_snapshot() {
+        validate(!file.is_windowed(), error_msg::windowed_mapping_msg, file.path);
+        // The snapshots read the file without the volume lock
+        file.keep_retired_mappings(true);
+        return versions.take_snapshot();
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::release_snapshot(const uint64_t epoch) {
+        release_freed_space(versions.release_snapshot(epoch));
+        if (!versions.has_snapshots())
+            file.keep_retired_mappings(false);
+    }
+
+    template <typename K, typename V>
+    bool IOManager<K, V>::has_snapshots() const {
+        return versions.has_snapshots();
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::release_freed_space(const std::vector<VersionStore::FreedSpace>& freed) {
+        for (const auto& space: freed) {
+            if (space.is_node)
+                free_space.put_node(space.pos);
+            else
+                put_free_extent(space.pos, space.size);
+        }
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::copy_on_write(const int64_t pos) {
+        if (!versions.needs_copy(pos))
+            return;
+
+        // The slot at the end of file is a new one, the nodes of both engines take the same number of bytes
+        if (pos >= get_file_pos_end())
+            return;
+        auto node_size = Node::get_node_size_in_bytes(t);
+        auto reader = file.const_reader(pos);
+        if (auto* page = reader.read_next_bytes(node_size))
+            versions.add_copy(pos, std::vector<uint8_t>(page, page + node_size));
+    }
+
+    template <typename K, typename V>
+    std::optional<BTreeNode<K, V>> IOManager<K, V>::read_snapshot_node(const int64_t pos, const uint8_t version,
+                                                                       const uint64_t epoch) const {
+        // The copy is made before the node is rewritten: if there is no copy after the file is read, the node is intact
+        auto node = try_read_node(pos, version);
+        versions.read_copy(pos, epoch, [&](const std::vector<uint8_t>& page) {
+            node = read_node(typename MappedFile<K,V>::ConstReader(page.data(), page.size(), 0), pos, version);
+        });
+        return node;
+    }
+
+    template <typename K, typename V>
+    std::optional<BPlusTreeNode<K, V>> IOManager<K, V>::read_snapshot_bplus_node(const int64_t pos,
+                                                                                 const uint64_t epoch) const {
+        auto node = try_read_bplus_node(pos);
+        versions.read_copy(pos, epoch, [&](const std::vector<uint8_t>& page) {
+            node = read_bplus_node(typename MappedFile<K,V>::ConstReader(page.data(), page.size(), 0), pos);
+        });
+        return node;
+    }
+
+    template <typename K, typename V>
+    constexpr int32_t IOManager<K, V>::entry_size_in_bytes(const int32_t value_size) {
+        // Values of non-arithmetic types are prefixed with their size
+        if constexpr (std::is_arithmetic_v<V>)
+            return sizeof(K) + value_size;
+        else
+            return sizeof(K) + sizeof(int32_t) + value_size;
+    }
+
+    template <typename K, typename V>
+    int64_t IOManager<K, V>::to_inline_value(const EntryT& e) {
+        int64_t pos = 0;
+        if constexpr (std::is_arithmetic_v<V>) {
+            static_assert(sizeof(V) <= sizeof(pos));
+            std::memcpy(&pos, &e.data, sizeof(V));
+        }
+        return pos;
+    }
+
+    template <typename K, typename V>
+    typename BTree<K, V>::EntryT IOManager<K, V>::from_inline_value(const K key, const int64_t pos) {
+        if constexpr (std::is_arithmetic_v<V>) {
+            V value;
+            std::memcpy(&value, &pos, sizeof(V));
+            return EntryT{ key, value };
+        } else {
+            return EntryT();
+        }
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::read_free_space_map() {
+        file.set_pos(FREE_MAP_POS_IN_HEADER);
+        auto map_pos = file.read_int64();
+        if (map_pos == INVALID_POS)
+            return;
+
+        file.set_pos(map_pos);
+        auto nodes_count = file.read_int64();
+        for (int64_t i = 0; i < nodes_count; ++i)
+            free_space.put_node(file.read_int64());
+
+        auto extents_count = file.read_int64();
+        for (int64_t i = 0; i < extents_count; ++i) {
+            auto pos = file.read_int64();
+            free_space.put_extent(pos, file.read_int32());
+        }
+
+        // The map is loaded: it's dropped from the file till the next close
+        file.set_pos(FREE_MAP_POS_IN_HEADER);
+        file.write_next_primitive(INVALID_POS);
+        file.truncate(map_pos);
+    }
+
+    template <typename K, typename V>
+    void IOManager<K, V>::write_free_space_map() {
+        if (format_version < FREE_MAP_FORMAT_VERSION || free_space.empty() || !is_ready())
+            return;
+
+        auto map_pos = get_file_pos_end();
+        file.write_next_primitive(static_cast<int64_t>(free_space.nodes().size()));
+        for (auto pos: free_space.nodes())
+            file.write_next_primitive(pos);
+
+        file.write_next_primitive(static_cast<int64_t>(free_space.entries().size()));
+        for (auto [size, pos]: free_space.entries()) {
+            file.write_next_primitive(pos);
+            file.write_next_primitive(size);
+        }
+
+        file.set_pos(FREE_MAP_POS_IN_HEADER);
+        file.write_next_primitive(map_pos);
+    }
 }
\ No newline at end of file
@@ -2,7 +2,18 @@
 
 #include <string>
 #include <fstream>
-
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "read_guard.h"
+#include "reader_epochs.h"
+#include "reserved_mapping.h"
+#include "windowed_mapping.h"
+#include "buffer_pool.h"
+#include "memory_advice.h"
+#include "utils/mapping_options.h"
 #include "utils/boost_include.h"
 #include "utils/utils.h"
 
@@ -11,23 +22,93 @@ namespace btree {
     class MappedFile {
         class MappedRegion {
             bip::mapped_region mapped_region;
-            uint8_t* mapped_region_begin;
+            std::atomic<uint8_t*> mapped_region_begin;
+            // The replaced regions are kept while the snapshots or the pinned values can use them
+            std::vector<bip::mapped_region> retired_regions;
+            bool keep_retired_regions;
+            // The released regions are freed when the optimistic readers leave them, right away if it's null
+            ReaderEpochs* reader_epochs;
+            // Used instead of the mapped region if the file grows in a reserved address range
+            std::unique_ptr<ReservedMapping> reserved;
+            const int64_t reserved_size;
+            // Used instead of the mapped region if the file is mapped by windows
+            std::unique_ptr<WindowedMapping> windows;
+            const int64_t window_size;
+            const int64_t max_mapped_bytes;
+            // Used instead of the mapping if the file is read and written by the buffer pool
+            std::unique_ptr<BufferPool> pool;
+            const int64_t buffer_pool_size;
+            const int64_t frame_size;
+            const bool direct_io;
+            const int32_t io_uring_depth;
+            // Reapplied when the file is remapped or grows
+            AccessPattern pattern;
+
+            void apply_pattern(const AccessPattern applied_pattern);
+            void release_retired();
         public:
-            explicit MappedRegion();
-            uint8_t* address_by_offset(const int64_t offset) const;
+            std::atomic<int32_t> pins;
+
+            explicit MappedRegion(const MappingOptions& mapping);
+            /** SIZE bytes from OFFSET are mapped contiguously, the buffered ones are written back if FOR_WRITE */
+            uint8_t* address_by_offset(const int64_t offset, const int64_t size = 1, const bool for_write = false) const;
+            bool is_windowed() const;
+            bool is_buffered() const;
+            /** Unmaps the least recently used windows or evicts the frames over the budget if no address is pinned */
+            void evict_windows();
             void remap(const std::string& path);
+            bool is_resized_in_place() const;
+            /** Resizes the file mapped in the reserved range or read by the buffer pool in place */
+            void resize_in_place(const std::string& path, const int64_t size);
+            void flush();
+            void keep_retired(const bool keep);
+            void retire_to(ReaderEpochs* epochs);
+            void advise(const AccessPattern new_pattern);
+            void prefetch(const int64_t offset, const int64_t size);
+            void complete_prefetch();
+            bool has_read_ring() const;
         };
 
         using ValueType = utils::conditional_t<std::is_arithmetic_v<V>, const V, const uint8_t*>;
 
         int64_t m_pos;
-        int64_t m_size;
+        std::atomic<int64_t> m_size;
         int64_t m_capacity;
         MappedRegion* m_mapped_region;
+        // Called before the bytes of the file are modified or dropped (see SET_BEFORE_WRITE())
+        std::function<void(const int64_t, const int64_t)> m_before_write;
+        bool m_detached;
+        const MappingOptions m_mapping;
     public:
         const std::string path;
 
-        MappedFile(const std::string& fn, const int64_t bytes_num);
+        /**
+         * Reads the mapping without moving the file position, so it may be used by the concurrent readers along with
+         * the writer: every read out of the mapped file fails the reader instead of accessing the memory.
+         */
+        class ConstReader {
+            const uint8_t* begin;
+            int64_t size;
+            int64_t pos;
+            bool failed;
+        public:
+            ConstReader(const uint8_t* begin, const int64_t size, const int64_t pos);
+
+            template <typename T>
+            T read_next_primitive();
+
+            /** Warning: do not read vector size */
+            template <typename T>
+            void read_node_vector(std::vector<T>& vec);
+
+            /** Returns the address of the next SIZE bytes */
+            const uint8_t* read_next_bytes(const int32_t size);
+
+            void set_pos(const int64_t pos);
+            bool is_failed() const;
+        };
+
+        MappedFile(const std::string& fn, const int64_t bytes_num, const MappingOptions& mapping = MappingOptions());
 
         ~MappedFile();
 
@@ -62,6 +143,52 @@ namespace btree {
         void shrink_to_fit();
         bool is_empty() const;
 
+        /** Drops the bytes after SIZE: the file ends there, they are overwritten by the next writes */
+        void truncate(const int64_t size);
+        /** The file ends at SIZE at least: the bytes up to it are allocated, they're written later */
+        void extend(const int64_t size);
+
+        /** Synchronously writes the modified pages of the mapping to the file */
+        void flush();
+
+        /**
+         * Address of SIZE bytes from POS in the current mapping: it's valid till the file is resized,
+         * with the windowed mapping or the buffer pool till the next SET_POS()
+         */
+        const uint8_t* address(const int64_t pos, const int64_t size = 1) const;
+        bool is_windowed() const;
+        bool is_buffered() const;
+
+        /** BEFORE_WRITE(pos, size) is called before SIZE bytes from POS are written or dropped by the shrinking */
+        void set_before_write(std::function<void(const int64_t, const int64_t)>&& before_write);
+
+        /** Access PATTERN of the whole mapping: it's kept when the file grows, WILLNEED is applied once */
+        void advise(const AccessPattern pattern);
+        /**
+         * The kernel starts reading SIZE bytes from POS in the background, or the buffer pool reads their frames by
+         * io_uring till COMPLETE_PREFETCH()
+         */
+        void prefetch(const int64_t pos, const int64_t size) const;
+        /** Waits till the frames are read by io_uring and caches them in the pool (see BufferPool::complete_prefetch) */
+        void complete_prefetch() const;
+        /** The prefetched ranges are read by io_uring into the frames of the buffer pool */
+        bool has_read_ring() const;
+
+        /** Thread-safe reader starting at POS */
+        ConstReader const_reader(const int64_t pos) const;
+
+        /** The mapping isn't unmapped and the data isn't moved while the guard is alive (see ReadGuard) */
+        ReadGuard pin() const;
+        bool is_pinned() const;
+
+        /** The mappings replaced on growth aren't unmapped while KEEP is set: the snapshots may still use them */
+        void keep_retired_mappings(const bool keep);
+        /** The mappings replaced on growth are retired to EPOCHS: the optimistic readers may still use them */
+        void retire_mappings_to(ReaderEpochs* epochs);
+
+        /** The file is replaced by another one at the same path: it's closed without resizing */
+        void detach();
+
     private:
         template <typename T>
         int64_t write_arithmetic(T val);
@@ -71,8 +198,10 @@ namespace btree {
 
         void resize(int64_t new_size, bool shrink_to_fit = false);
 
-        constexpr int64_t scale_current_size() const {
-            return static_cast<int64_t>(m_size * 1.1);
+        int64_t scale_current_size() const {
+            if (m_mapping.extent_size > 0)
+                return m_size + m_mapping.extent_size;
+            return static_cast<int64_t>(m_size * m_mapping.factor);
         }
     };
 }
@@ -9,7 +9,7 @@ namespace fs = std::filesystem;
 
 namespace btree {
 namespace file {
-    void seek_file_to_offset(const std::string& path, const std::ios_base::openmode file_open_mode, const int64_t offset) {
+    inline void seek_file_to_offset(const std::string& path, const std::ios_base::openmode file_open_mode, const int64_t offset) {
         std::filebuf buf;
         auto* p_file_buf = buf.open(path, file_open_mode);
         if (!p_file_buf)
@@ -23,8 +23,8 @@ namespace file {
     using namespace utils;
 
     template <typename K, typename V>
-    MappedFile<K,V>::MappedFile(const std::string& path, const int64_t bytes_num) :
-            m_pos(0), m_mapped_region(new MappedRegion()), path(path)
+    MappedFile<K,V>::MappedFile(const std::string& path, const int64_t bytes_num, const MappingOptions& mapping) :
+            m_pos(0), m_mapped_region(new MappedRegion(mapping)), m_detached(false), m_mapping(mapping), path(path)
     {
         bool file_exists = fs::exists(path);
         if (!file_exists) {
@@ -54,6 +54,8 @@ namespace file {
     - https://github.com/steinwurf/boost/blob/master/boost/interprocess/mapped_region.hpp#L555
 */
         delete m_mapped_region;
+        if (m_detached)
+            return;
         std::error_code error_code;
         fs::resize_file(path, m_capacity, error_code);
         if (error_code)
@@ -61,19 +63,182 @@ namespace file {
     }
 
     template <typename K, typename V>
-    MappedFile<K,V>::MappedRegion::MappedRegion() : mapped_region_begin(nullptr) {}
+    MappedFile<K,V>::MappedRegion::MappedRegion(const MappingOptions& mapping) :
+        mapped_region_begin(nullptr), keep_retired_regions(false), reader_epochs(nullptr),
+        reserved(mapping.reserve_address_range && mapping.window_size == 0 && mapping.buffer_pool_size == 0 &&
+                 ReservedMapping::is_supported ? new ReservedMapping() : nullptr),
+        reserved_size(mapping.reserved_size), window_size(mapping.window_size),
+        max_mapped_bytes(mapping.max_mapped_bytes),
+        buffer_pool_size(BufferPool::is_supported ? mapping.buffer_pool_size : 0), frame_size(mapping.frame_size),
+        direct_io(mapping.direct_io), io_uring_depth(mapping.io_uring_depth), pattern(NORMAL), pins(0) {}
 
     template <typename K, typename V>
-    uint8_t* MappedFile<K,V>::MappedRegion::address_by_offset(const int64_t offset) const {
-        return mapped_region_begin + offset;
+    bool MappedFile<K,V>::MappedRegion::is_windowed() const {
+        return window_size > 0 || is_buffered();
+    }
+
+    template <typename K, typename V>
+    bool MappedFile<K,V>::MappedRegion::is_buffered() const {
+        return buffer_pool_size > 0;
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::evict_windows() {
+        if (pool) {
+            // The frames of the previous operation are unpinned, the pinned values are checked by the pool
+            pool->release();
+            return;
+        }
+        // The pinned values may be in any window
+        if (windows && windows->get_mapped_bytes() > max_mapped_bytes && pins.load(std::memory_order_acquire) == 0)
+            windows->evict();
+    }
+
+    template <typename K, typename V>
+    bool MappedFile<K,V>::MappedRegion::is_resized_in_place() const {
+        return reserved != nullptr || is_buffered();
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::resize_in_place(const std::string& file_path, const int64_t size) {
+        if (is_buffered()) {
+            remap(file_path);
+            pool->resize(size);
+            return;
+        }
+        if (!reserved->is_open())
+            reserved->open(file_path, reserved_size);
+        reserved->resize(size);
+        mapped_region_begin.store(reserved->begin(), std::memory_order_release);
+        if (pattern != NORMAL)
+            apply_pattern(pattern);
+    }
+
+    template <typename K, typename V>
+    uint8_t* MappedFile<K,V>::MappedRegion::address_by_offset(const int64_t offset, const int64_t size,
+                                                              const bool for_write) const {
+        if (pool)
+            return pool->address(offset, size, for_write);
+        if (windows)
+            return windows->address(offset, size);
+        return mapped_region_begin.load(std::memory_order_relaxed) + offset;
     }
 
     template <typename K, typename V>
     void MappedFile<K,V>::MappedRegion::remap(const std::string& file_path) {
+        if (is_buffered()) {
+            // The file is read by the pool, it isn't mapped
+            if (!pool) {
+                pool = std::make_unique<BufferPool>(file_path, frame_size, buffer_pool_size, direct_io, io_uring_depth,
+                                                    pins);
+                if (pattern != NORMAL)
+                    pool->advise(pattern);
+            }
+            return;
+        }
+        if (is_windowed()) {
+            // The windows are mapped on demand at their full size, they don't depend on the file size
+            if (!windows)
+                windows = std::make_unique<WindowedMapping>(file_path, window_size, max_mapped_bytes);
+            return;
+        }
+        if (reserved) {
+            // The file is mapped once, then it grows in place
+            if (!reserved->is_open())
+                reserved->open(file_path, reserved_size);
+            mapped_region_begin.store(reserved->begin(), std::memory_order_release);
+            if (pattern != NORMAL)
+                apply_pattern(pattern);
+            return;
+        }
         auto file_mapping = bip::file_mapping(file_path.data(), bip::read_write);
         auto tmp_mapped_region = bip::mapped_region(file_mapping, bip::read_write);
         mapped_region.swap(tmp_mapped_region);
-        mapped_region_begin = cast_to_uint8_t_data(mapped_region.get_address());
+        mapped_region_begin.store(cast_to_uint8_t_data(mapped_region.get_address()), std::memory_order_release);
+        if (tmp_mapped_region.get_address())
+            retired_regions.push_back(std::move(tmp_mapped_region));
+        if (!keep_retired_regions && pins.load(std::memory_order_acquire) == 0)
+            release_retired();
+        if (pattern != NORMAL)
+            apply_pattern(pattern);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::keep_retired(const bool keep) {
+        keep_retired_regions = keep;
+        if (!keep && pins.load(std::memory_order_acquire) == 0)
+            release_retired();
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::retire_to(ReaderEpochs* epochs) {
+        reader_epochs = epochs;
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::release_retired() {
+        if (reader_epochs) {
+            for (auto& region: retired_regions)
+                reader_epochs->retire(std::make_shared<bip::mapped_region>(std::move(region)));
+        }
+        retired_regions.clear();
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::advise(const AccessPattern new_pattern) {
+        if (pool)
+            pool->advise(new_pattern);
+        else if (windows)
+            windows->advise(new_pattern);
+        else
+            apply_pattern(new_pattern);
+        if (new_pattern != WILLNEED)
+            pattern = new_pattern;
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::apply_pattern(const AccessPattern applied_pattern) {
+        if (reserved)
+            advise_memory(reserved->begin(), reserved->get_mapped_size(), applied_pattern);
+        else if (mapped_region_begin.load(std::memory_order_relaxed))
+            advise_memory(mapped_region.get_address(), static_cast<int64_t>(mapped_region.get_size()), applied_pattern);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::prefetch(const int64_t offset, const int64_t size) {
+        if (pool)
+            pool->prefetch(offset, size);
+        else
+            advise_memory(address_by_offset(offset, size), size, WILLNEED);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::complete_prefetch() {
+        if (pool)
+            pool->complete_prefetch();
+    }
+
+    template <typename K, typename V>
+    bool MappedFile<K,V>::MappedRegion::has_read_ring() const {
+        return pool && pool->has_read_ring();
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::MappedRegion::flush() {
+        if (pool) {
+            pool->flush();
+            return;
+        }
+        if (windows) {
+            windows->flush();
+            return;
+        }
+        if (reserved) {
+            reserved->flush();
+            return;
+        }
+        if (mapped_region_begin.load(std::memory_order_relaxed))
+            mapped_region.flush(0, 0, false);
     }
 
     template <typename K, typename V>
@@ -90,7 +255,7 @@ namespace file {
     std::pair<ValueType, int32_t> MappedFile<K,V>::read_next_data() {
         if constexpr(std::is_pointer_v<ValueType>) {
             auto len = read_next_primitive<int32_t>();
-            auto* value_begin = m_mapped_region->address_by_offset(m_pos);
+            auto* value_begin = m_mapped_region->address_by_offset(m_pos, len);
             m_pos += len;
             return std::make_pair(cast_to_const_uint8_t_data(value_begin), len);
         } else {
@@ -111,7 +276,7 @@ namespace file {
     template <typename T>
     T MappedFile<K,V>::read_next_primitive() {
         static_assert(std::is_arithmetic_v<T>);
-        auto* value_begin = m_mapped_region->address_by_offset(m_pos);
+        auto* value_begin = m_mapped_region->address_by_offset(m_pos, sizeof(T));
         m_pos += sizeof(T);
         return *(reinterpret_cast<T*>(value_begin));
     }
@@ -120,11 +285,14 @@ namespace file {
     template <typename T>
     void MappedFile<K,V>::write_node_vector(const std::vector<T>& vec) {
         int64_t total_size_in_bytes = sizeof(T) * vec.size();
+        if (m_before_write)
+            m_before_write(m_pos, total_size_in_bytes);
         if (m_pos + total_size_in_bytes > m_size)
             resize(m_pos + total_size_in_bytes);
 
         auto* data = cast_to_const_uint8_t_data(vec.data());
-        std::copy(data, data + total_size_in_bytes, m_mapped_region->address_by_offset(m_pos));
+        auto* destination = m_mapped_region->address_by_offset(m_pos, total_size_in_bytes, true);
+        std::copy(data, data + total_size_in_bytes, destination);
         m_pos += total_size_in_bytes;
         m_capacity = std::max(m_pos, m_capacity);
     }
@@ -135,7 +303,7 @@ namespace file {
         int64_t total_size = sizeof(T) * vec.size();
 
         auto* data = cast_to_uint8_t_data(vec.data());
-        auto* start = m_mapped_region->address_by_offset(m_pos);
+        auto* start = m_mapped_region->address_by_offset(m_pos, total_size);
         auto* end = start + total_size;
         std::copy(start, end, data);
         m_pos += total_size;
@@ -146,11 +314,14 @@ namespace file {
     int64_t MappedFile<K,V>::write_arithmetic(T val) {
         static_assert(std::is_arithmetic_v<T>);
         int64_t total_size_in_bytes = sizeof(T);
+        if (m_before_write)
+            m_before_write(m_pos, total_size_in_bytes);
         if (m_pos + total_size_in_bytes > m_size)
             resize(m_pos + total_size_in_bytes);
 
         auto* data = cast_to_const_uint8_t_data(&val);
-        std::copy(data, data + total_size_in_bytes, m_mapped_region->address_by_offset(m_pos));
+        auto* destination = m_mapped_region->address_by_offset(m_pos, total_size_in_bytes, true);
+        std::copy(data, data + total_size_in_bytes, destination);
         return m_pos + total_size_in_bytes;
     }
 
@@ -163,24 +334,34 @@ namespace file {
 
         // write values
         int64_t total_bytes_size = total_size_in_bytes;
+        if (m_before_write)
+            m_before_write(m_pos, total_bytes_size);
         if (m_pos + total_bytes_size > m_size)
             resize(m_pos + total_bytes_size);
 
         auto* data = cast_to_const_uint8_t_data(source_data);
-        std::copy(data, data + total_bytes_size, m_mapped_region->address_by_offset(m_pos));
+        std::copy(data, data + total_bytes_size, m_mapped_region->address_by_offset(m_pos, total_bytes_size, true));
         return m_pos + total_bytes_size;
     }
 
     template <typename K, typename V>
     void MappedFile<K,V>::resize(int64_t new_size, bool shrink_to_fit) {
-        // Can't use std::filesystem::resize_file(), see file_mapping_impl.h: ~MappedFile() {...}
-        m_size = shrink_to_fit ? new_size : std::max(scale_current_size(), new_size);
-        file::seek_file_to_offset(path, std::ios_base::in | std::ios_base::out, m_size);
-        m_mapped_region->remap(path);
+        auto size = shrink_to_fit ? new_size : std::max(scale_current_size(), new_size);
+        if (m_mapped_region->is_resized_in_place()) {
+            m_mapped_region->resize_in_place(path, size);
+        } else {
+            // Can't use std::filesystem::resize_file(), see file_mapping_impl.h: ~MappedFile() {...}
+            file::seek_file_to_offset(path, std::ios_base::in | std::ios_base::out, size);
+            m_mapped_region->remap(path);
+        }
+        // The size is published after the mapping: a concurrent reader never sees the size larger than its mapping
+        m_size.store(size, std::memory_order_release);
     }
 
     template <typename K, typename V>
     void MappedFile<K,V>::set_pos(int64_t pos) {
+        // The addresses of the previous operation aren't used anymore
+        m_mapped_region->evict_windows();
         m_pos = pos > 0 ? pos : 0;
     }
 
@@ -216,6 +397,8 @@ namespace file {
 
     template <typename K, typename V>
     void MappedFile<K,V>::shrink_to_fit() {
+        if (m_before_write && m_pos < m_size)
+            m_before_write(m_pos, m_size - m_pos);
         m_capacity = m_size = m_pos;
         resize(m_size, true);
         m_mapped_region->remap(path);
@@ -225,4 +408,139 @@ namespace file {
     bool MappedFile<K,V>::is_empty() const {
         return m_size == 0;
     }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::flush() {
+        if (m_size > 0)
+            m_mapped_region->flush();
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::set_before_write(std::function<void(const int64_t, const int64_t)>&& before_write) {
+        m_before_write = std::move(before_write);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::truncate(const int64_t size) {
+        m_capacity = std::min(m_capacity, size);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::extend(const int64_t size) {
+        if (size > m_size)
+            resize(size);
+        m_capacity = std::max(m_capacity, size);
+    }
+
+    template <typename K, typename V>
+    const uint8_t* MappedFile<K,V>::address(const int64_t pos, const int64_t size) const {
+        return m_mapped_region->address_by_offset(pos, size);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::advise(const AccessPattern pattern) {
+        m_mapped_region->advise(pattern);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::prefetch(const int64_t pos, const int64_t size) const {
+        auto prefetched_size = std::min<int64_t>(size, m_size - pos);
+        if (pos < 0 || prefetched_size <= 0)
+            return;
+        m_mapped_region->prefetch(pos, prefetched_size);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::complete_prefetch() const {
+        m_mapped_region->complete_prefetch();
+    }
+
+    template <typename K, typename V>
+    bool MappedFile<K,V>::has_read_ring() const {
+        return m_mapped_region->has_read_ring();
+    }
+
+    template <typename K, typename V>
+    bool MappedFile<K,V>::is_windowed() const {
+        return m_mapped_region->is_windowed();
+    }
+
+    template <typename K, typename V>
+    bool MappedFile<K,V>::is_buffered() const {
+        return m_mapped_region->is_buffered();
+    }
+
+    template <typename K, typename V>
+    typename MappedFile<K,V>::ConstReader MappedFile<K,V>::const_reader(const int64_t pos) const {
+        auto size = m_size.load(std::memory_order_acquire);
+        return ConstReader(m_mapped_region->address_by_offset(0), size, pos);
+    }
+
+    template <typename K, typename V>
+    ReadGuard MappedFile<K,V>::pin() const {
+        return ReadGuard(&m_mapped_region->pins);
+    }
+
+    template <typename K, typename V>
+    bool MappedFile<K,V>::is_pinned() const {
+        return m_mapped_region->pins.load(std::memory_order_acquire) > 0;
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::keep_retired_mappings(const bool keep) {
+        m_mapped_region->keep_retired(keep);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::retire_mappings_to(ReaderEpochs* epochs) {
+        m_mapped_region->retire_to(epochs);
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::detach() {
+        m_detached = true;
+    }
+
+    template <typename K, typename V>
+    MappedFile<K,V>::ConstReader::ConstReader(const uint8_t* begin, const int64_t size, const int64_t pos) :
+        begin(begin), size(size), pos(pos), failed(false) {}
+
+    template <typename K, typename V>
+    template <typename T>
+    T MappedFile<K,V>::ConstReader::read_next_primitive() {
+        static_assert(std::is_arithmetic_v<T>);
+        T val = 0;
+        if (auto* data = read_next_bytes(sizeof(T)))
+            std::copy(data, data + sizeof(T), cast_to_uint8_t_data(&val));
+        return val;
+    }
+
+    template <typename K, typename V>
+    template <typename T>
+    void MappedFile<K,V>::ConstReader::read_node_vector(std::vector<T>& vec) {
+        auto total_size = static_cast<int32_t>(sizeof(T) * vec.size());
+        if (auto* data = read_next_bytes(total_size))
+            std::copy(data, data + total_size, cast_to_uint8_t_data(vec.data()));
+    }
+
+    template <typename K, typename V>
+    const uint8_t* MappedFile<K,V>::ConstReader::read_next_bytes(const int32_t bytes_count) {
+        if (failed || pos < 0 || bytes_count < 0 || pos + bytes_count > size) {
+            failed = true;
+            return nullptr;
+        }
+        auto* data = begin + pos;
+        pos += bytes_count;
+        return data;
+    }
+
+    template <typename K, typename V>
+    void MappedFile<K,V>::ConstReader::set_pos(const int64_t new_pos) {
+        pos = new_pos;
+    }
+
+    template <typename K, typename V>
+    bool MappedFile<K,V>::ConstReader::is_failed() const {
+        return failed;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#ifndef _WIN32
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+#include "utils/access_pattern.h"
+
+namespace btree {
+    /**
+     * Passes the access PATTERN of SIZE mapped bytes from ADDRESS to the kernel (madvise), the range is extended
+     * to the page boundaries. It's only a hint: it's ignored if it fails or isn't supported.
+     */
+    inline void advise_memory(const void* address, const int64_t size, const AccessPattern pattern) {
+#ifndef _WIN32
+        if (!address || size <= 0)
+            return;
+        static const auto page_size = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+        auto begin = reinterpret_cast<uintptr_t>(address) / page_size * page_size;
+        auto end = reinterpret_cast<uintptr_t>(address) + static_cast<uintptr_t>(size);
+        int advice = MADV_NORMAL;
+        if (pattern == RANDOM)
+            advice = MADV_RANDOM;
+        else if (pattern == SEQUENTIAL)
+            advice = MADV_SEQUENTIAL;
+        else if (pattern == WILLNEED)
+            advice = MADV_WILLNEED;
+        ::madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+#else
+        (void) address;
+        (void) size;
+        (void) pattern;
+#endif
+    }
+}
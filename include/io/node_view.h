@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace btree {
+    /**
+     * Read-only view of a node in the mapped file: the fields are read directly from the mapping, so the lookups
+     * don't copy the nodes and don't allocate. The offsets of the arrays are given by the node layout (see IOManager).
+     *  - the view is valid till the file is remapped: it's used only within a read-only query
+     *  - the flag and USED_KEYS are read once, before the view is made: the searches of an optimistic reader stay
+     *    within the node checked by IOManager::try_view_node() even if the node is modified meanwhile
+     *  - legacy nodes have no inline keys (KEYS_OFFSET is -1): the keys are read from the entries by READ_KEY(FILE, pos)
+     *  - packed nodes keep BASE and the deltas of DELTA_BITS bits from KEYS_OFFSET: a delta is read by one unaligned
+     *    load, a shift and a mask, the binary search over them has no branches but the loop
+     */
+    template <typename K>
+    class NodeView final {
+    public:
+        using ReadKeyFunc = K (*)(const void* file, const int64_t pos);
+    private:
+        const uint8_t* node;
+        bool leaf;
+        int16_t count;
+        K base;
+        // 0 for the plain keys
+        int32_t delta_bits;
+        uint64_t delta_mask;
+        int32_t keys_offset;
+        int32_t entry_pos_offset;
+        int32_t child_pos_offset;
+        const void* file;
+        ReadKeyFunc read_key;
+
+        template <typename T>
+        static T load(const uint8_t* data) {
+            // The fields aren't aligned in the file
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+    public:
+        /** The offsets depend on the flag and USED_KEYS of the node, so they're given with them */
+        NodeView(const uint8_t* node, const bool is_leaf, const int16_t used_keys, const int32_t keys_offset,
+                 const int32_t entry_pos_offset, const int32_t child_pos_offset, const void* file = nullptr,
+                 ReadKeyFunc read_key = nullptr) :
+            node(node), leaf(is_leaf), count(used_keys), base(), delta_bits(0), delta_mask(0), keys_offset(keys_offset), entry_pos_offset(entry_pos_offset),
+            child_pos_offset(child_pos_offset), file(file), read_key(read_key) {}
+
+        NodeView(const uint8_t* node, const bool is_leaf, const int16_t used_keys, const K base,
+                 const int32_t delta_bits, const int32_t deltas_offset, const int32_t entry_pos_offset,
+                 const int32_t child_pos_offset) :
+            node(node), leaf(is_leaf), count(used_keys), base(base), delta_bits(delta_bits),
+            delta_mask(delta_bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << delta_bits) - 1),
+            keys_offset(deltas_offset), entry_pos_offset(entry_pos_offset), child_pos_offset(child_pos_offset),
+            file(nullptr), read_key(nullptr) {}
+
+        bool is_leaf() const {
+            return leaf;
+        }
+
+        int16_t used_keys() const {
+            return count;
+        }
+
+        K key(const int32_t idx) const {
+            if (delta_bits > 0)
+                return static_cast<K>(static_cast<UnsignedK>(static_cast<UnsignedK>(base) + delta(idx)));
+            if (keys_offset < 0)
+                return read_key(file, entry_pos(idx));
+            return load<K>(node + keys_offset + idx * sizeof(K));
+        }
+
+        int64_t entry_pos(const int32_t idx) const {
+            return load<int64_t>(node + entry_pos_offset + idx * sizeof(int64_t));
+        }
+
+        int64_t child_pos(const int32_t idx) const {
+            return load<int64_t>(node + child_pos_offset + idx * sizeof(int64_t));
+        }
+
+        /** Index of the first key >= KEY */
+        int32_t lower_bound(const K key) const {
+            if (delta_bits > 0) {
+                // The keys before BASE are before all the keys
+                if (key <= base)
+                    return 0;
+                auto target = to_delta(key);
+                return packed_search([target](const uint64_t curr) { return curr < target; });
+            }
+            return bin_search([key](const K curr) { return curr < key; });
+        }
+
+        /** Index of the first key > KEY */
+        int32_t upper_bound(const K key) const {
+            if (delta_bits > 0) {
+                if (key < base)
+                    return 0;
+                auto target = to_delta(key);
+                return packed_search([target](const uint64_t curr) { return curr <= target; });
+            }
+            return bin_search([key](const K curr) { return curr <= key; });
+        }
+
+        bool has_key(const int32_t idx, const K key) const {
+            return idx < used_keys() && this->key(idx) == key;
+        }
+
+    private:
+        using UnsignedK = std::make_unsigned_t<K>;
+
+        uint64_t delta(const int32_t idx) const {
+            auto bit = idx * delta_bits;
+            return (load<uint64_t>(node + keys_offset + bit / 8) >> (bit % 8)) & delta_mask;
+        }
+
+        /** KEY >= BASE as a delta, it's never less than the deltas of the keys <= KEY */
+        uint64_t to_delta(const K key) const {
+            return static_cast<uint64_t>(static_cast<UnsignedK>(static_cast<UnsignedK>(key) - static_cast<UnsignedK>(base)));
+        }
+
+        template <typename Pred>
+        int32_t packed_search(Pred&& is_before) const {
+            int32_t left = count;
+            if (left == 0)
+                return 0;
+            // The range is halved with a conditional move, the last delta left is compared at the end
+            int32_t first = 0;
+            while (left > 1) {
+                auto half = left / 2;
+                first = is_before(delta(first + half)) ? first + half : first;
+                left -= half;
+            }
+            return first + is_before(delta(first));
+        }
+
+        template <typename Pred>
+        int32_t bin_search(Pred&& is_before) const {
+            int32_t lo = 0;
+            int32_t hi = used_keys();
+            while (lo < hi) {
+                auto mid = lo + (hi - lo) / 2;
+                if (is_before(key(mid)))
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+    };
+}
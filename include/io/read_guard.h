@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace btree {
+    /**
+     * Pin of a mapped file: while any pin is alive, the replaced mappings aren't unmapped and the freed entries
+     * aren't reused, so the values read from the mapping stay in place. It's released from any thread.
+     */
+    class ReadGuard final {
+        std::atomic<int32_t>* pins;
+    public:
+        ReadGuard() : pins(nullptr) {}
+
+        explicit ReadGuard(std::atomic<int32_t>* pins) : pins(pins) {
+            pins->fetch_add(1, std::memory_order_acq_rel);
+        }
+
+        ReadGuard(ReadGuard&& other) noexcept : pins(other.pins) {
+            other.pins = nullptr;
+        }
+
+        ReadGuard& operator=(ReadGuard&& other) noexcept {
+            if (this != &other) {
+                release();
+                pins = other.pins;
+                other.pins = nullptr;
+            }
+            return *this;
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        ~ReadGuard() {
+            release();
+        }
+
+        void release() {
+            if (pins)
+                pins->fetch_sub(1, std::memory_order_release);
+            pins = nullptr;
+        }
+    };
+}
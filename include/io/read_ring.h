@@ -0,0 +1,204 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <linux/io_uring.h>
+#endif
+
+namespace btree {
+    /**
+     * Reads of a file into the buffers of the caller by io_uring. Up to DEPTH reads are in flight, the reads of a batch
+     * are submitted by one system call and complete in parallel. The file is read by the descriptor of the caller,
+     * so the reads bypass the page cache if it's opened with O_DIRECT. The ring is closed after a failed read: the reads
+     * which aren't completed then are failed, the next ones aren't issued. If io_uring isn't available (an old kernel,
+     * a seccomp filter), the ring isn't open.
+     */
+    class ReadRing final {
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+        int ring_fd = -1;
+        int file_fd = -1;
+        void* sq_ring = MAP_FAILED;
+        void* cq_ring = MAP_FAILED;
+        size_t sq_ring_size = 0;
+        size_t cq_ring_size = 0;
+        io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+        size_t sqes_size = 0;
+
+        unsigned* sq_tail = nullptr;
+        unsigned* sq_mask = nullptr;
+        unsigned* sq_array = nullptr;
+        unsigned* cq_head = nullptr;
+        unsigned* cq_tail = nullptr;
+        unsigned* cq_mask = nullptr;
+        io_uring_cqe* cqes = nullptr;
+        unsigned depth = 0;
+
+        // Queued but not submitted yet and submitted but not completed
+        unsigned queued = 0;
+        unsigned in_flight = 0;
+        // The bytes read by the reads since the last WAIT(), the user data of a read is its index
+        std::vector<int64_t> results;
+#endif
+    public:
+        static constexpr int64_t FAILED_READ = -1;
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+        ReadRing(const int fd, const int32_t queue_depth) {
+            io_uring_params params {};
+            ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, std::max(queue_depth, 1), &params));
+            if (ring_fd < 0)
+                return;
+            depth = params.sq_entries;
+
+            sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap)
+                sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+            sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                             IORING_OFF_SQ_RING);
+            cq_ring = single_mmap ? sq_ring : ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+            sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+            if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED || fd < 0) {
+                close();
+                return;
+            }
+            file_fd = fd;
+
+            auto* sq = static_cast<uint8_t*>(sq_ring);
+            sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            auto* cq = static_cast<uint8_t*>(cq_ring);
+            cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        }
+
+        ReadRing(const ReadRing&) = delete;
+        ReadRing& operator=(const ReadRing&) = delete;
+
+        ~ReadRing() {
+            wait();
+            close();
+        }
+
+        bool is_open() const {
+            return file_fd >= 0;
+        }
+
+        /** Queues the read of SIZE bytes from OFFSET into BUFFER, the queue is submitted when it's full */
+        void read(const int64_t offset, uint8_t* buffer, const int64_t size) {
+            results.push_back(FAILED_READ);
+            if (is_open() && queued + in_flight == depth)
+                reap();
+            if (!is_open())
+                return;
+
+            auto tail = *sq_tail;
+            auto index = tail & *sq_mask;
+            auto& sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = file_fd;
+            sqe.off = static_cast<uint64_t>(offset);
+            sqe.addr = reinterpret_cast<uint64_t>(buffer);
+            sqe.len = static_cast<uint32_t>(size);
+            sqe.user_data = results.size() - 1;
+            sq_array[index] = index;
+            __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+            ++queued;
+        }
+
+        /**
+         * Submits the queued reads and waits till all the reads complete. Returns the number of bytes read by every read
+         * since the last WAIT() in their order (fewer at the end of the file), FAILED_READ for the failed ones
+         */
+        std::vector<int64_t> wait() {
+            reap();
+            std::vector<int64_t> done;
+            done.swap(results);
+            return done;
+        }
+
+    private:
+        /** After a failure the queued reads aren't submitted, the ones in flight are waited for, then the ring is closed */
+        void reap() {
+            bool has_failed_reads = false;
+            while (in_flight > 0 || (queued > 0 && !has_failed_reads)) {
+                if (queued > 0 && !has_failed_reads) {
+                    auto submitted = ::syscall(__NR_io_uring_enter, ring_fd, queued, 0, 0, nullptr, 0);
+                    if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                        has_failed_reads = true;
+                    if (submitted > 0) {
+                        queued -= static_cast<unsigned>(submitted);
+                        in_flight += static_cast<unsigned>(submitted);
+                    }
+                }
+                if (in_flight > 0) {
+                    auto completed = ::syscall(__NR_io_uring_enter, ring_fd, 0, in_flight, IORING_ENTER_GETEVENTS,
+                                               nullptr, 0);
+                    // The ring itself is broken, only closing it cancels the reads
+                    if (completed < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                        break;
+                }
+
+                auto head = *cq_head;
+                auto tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+                for (; head != tail; ++head) {
+                    const auto& cqe = cqes[head & *cq_mask];
+                    auto index = static_cast<size_t>(cqe.user_data);
+                    // The opcode isn't supported or the file can't be read by the ring, the next reads aren't issued
+                    if (cqe.res >= 0)
+                        results[index] = cqe.res;
+                    else
+                        has_failed_reads = true;
+                    --in_flight;
+                }
+                __atomic_store_n(cq_head, tail, __ATOMIC_RELEASE);
+            }
+            if (has_failed_reads || in_flight > 0)
+                close();
+        }
+
+        /** Closes the ring, the reads which haven't completed stay failed */
+        void close() {
+            if (sqes != MAP_FAILED)
+                ::munmap(sqes, sqes_size);
+            if (cq_ring != MAP_FAILED && cq_ring != sq_ring)
+                ::munmap(cq_ring, cq_ring_size);
+            if (sq_ring != MAP_FAILED)
+                ::munmap(sq_ring, sq_ring_size);
+            sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+            sq_ring = cq_ring = MAP_FAILED;
+            if (ring_fd >= 0)
+                ::close(ring_fd);
+            file_fd = ring_fd = -1;
+            queued = in_flight = 0;
+        }
+#else
+        ReadRing(const int, const int32_t) {}
+        bool is_open() const { return false; }
+        void read(const int64_t, uint8_t*, const int64_t) { results.push_back(FAILED_READ); }
+        std::vector<int64_t> wait() {
+            std::vector<int64_t> done;
+            done.swap(results);
+            return done;
+        }
+    private:
+        std::vector<int64_t> results;
+#endif
+    };
+}
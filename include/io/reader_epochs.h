@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace btree {
+    /**
+     * Reclamation of the memory replaced under the lock-free readers (the mappings, the files, the filter tables):
+     *  - a reader enters the current epoch before it loads the shared pointers and leaves it after its last access,
+     *    it's counted in the slot of its thread by the parity of the epoch, so the readers don't share a counter
+     *  - the writer retires an object after it's unpublished. The retired objects are freed in generations: the epoch
+     *    is advanced, the new readers are counted by the other parity, and the generation is freed when the count
+     *    of the previous parity drains. The next generation waits for it, so a parity is drained before it's reused
+     *  - RECLAIM() doesn't wait for the readers: the writer calls it after its operations, a generation whose readers
+     *    haven't left yet is freed by a later call or when the epochs are destroyed
+     * The writers must be serialized.
+     */
+    class ReaderEpochs final {
+        static constexpr size_t SLOTS_COUNT = 64;
+
+        // A slot takes a cache line: the readers of different threads don't write to the same line
+        struct alignas(64) Slot {
+            std::atomic<int64_t> readers[2];
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<uint64_t> epoch;
+        // Retired before the epoch was advanced, freed when the previous parity drains
+        std::vector<std::shared_ptr<void>> draining;
+        // Retired since, they're the next generation
+        std::vector<std::shared_ptr<void>> pending;
+    public:
+        /** The reader is in the epoch while the guard is alive */
+        class Guard final {
+            std::atomic<int64_t>* readers;
+        public:
+            explicit Guard(std::atomic<int64_t>* readers) : readers(readers) {}
+
+            Guard(Guard&& other) noexcept : readers(other.readers) {
+                other.readers = nullptr;
+            }
+
+            Guard(const Guard&) = delete;
+            Guard& operator=(const Guard&) = delete;
+            Guard& operator=(Guard&&) = delete;
+
+            ~Guard() {
+                if (readers)
+                    readers->fetch_sub(1, std::memory_order_release);
+            }
+        };
+
+        ReaderEpochs() : slots(new Slot[SLOTS_COUNT]), epoch(0) {
+            for (size_t i = 0; i < SLOTS_COUNT; ++i) {
+                slots[i].readers[0].store(0, std::memory_order_relaxed);
+                slots[i].readers[1].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        ReaderEpochs(const ReaderEpochs&) = delete;
+        ReaderEpochs& operator=(const ReaderEpochs&) = delete;
+
+        Guard enter() const {
+            auto& slot = slots[thread_slot()];
+            while (true) {
+                auto current = epoch.load(std::memory_order_seq_cst);
+                auto& readers = slot.readers[current & 1];
+                readers.fetch_add(1, std::memory_order_seq_cst);
+                // Advanced meanwhile: the writer may have checked the parity before the reader was counted
+                if (epoch.load(std::memory_order_seq_cst) == current)
+                    return Guard(&readers);
+                readers.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        /** OBJECT isn't reachable by the readers which enter from now, it's freed when the ones inside leave */
+        void retire(std::shared_ptr<void> object) {
+            pending.push_back(std::move(object));
+        }
+
+        /** Frees the generations the readers have left, the retired objects start a new one */
+        void reclaim() {
+            if (!draining.empty() && has_readers(previous_parity()))
+                return;
+            free(draining);
+            if (pending.empty())
+                return;
+            draining.swap(pending);
+            epoch.fetch_add(1, std::memory_order_seq_cst);
+            if (!has_readers(previous_parity()))
+                free(draining);
+        }
+
+        /** The objects retired and not freed yet */
+        size_t retired_count() const {
+            return draining.size() + pending.size();
+        }
+
+    private:
+        static size_t thread_slot() {
+            static std::atomic<size_t> next_slot(0);
+            thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SLOTS_COUNT;
+            return slot;
+        }
+
+        size_t previous_parity() const {
+            return (epoch.load(std::memory_order_relaxed) - 1) & 1;
+        }
+
+        bool has_readers(const size_t parity) const {
+            for (size_t i = 0; i < SLOTS_COUNT; ++i)
+                if (slots[i].readers[parity].load(std::memory_order_seq_cst) != 0)
+                    return true;
+            return false;
+        }
+
+        /** The objects are moved out first: the destructor of a retired object may retire others */
+        static void free(std::vector<std::shared_ptr<void>>& objects) {
+            std::vector<std::shared_ptr<void>> freed;
+            freed.swap(objects);
+        }
+    };
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include <cstdint>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace btree {
+    /**
+     * Shared mapping of a file at the beginning of a reserved PROT_NONE range of the address space: the file grows
+     * by ftruncate and the new tail is mapped with MAP_FIXED right after the mapped part, so the base address
+     * doesn't move. If the file outgrows the range, it's mapped into a new one and the old range is kept till close:
+     * the readers may still use it.
+     */
+    class ReservedMapping final {
+#ifndef _WIN32
+        int fd = -1;
+        uint8_t* base = nullptr;
+        int64_t reserved_size = 0;
+        // The mapped part is page-aligned, it may exceed the file size
+        int64_t mapped_size = 0;
+        int64_t file_size = 0;
+        std::vector<std::pair<uint8_t*, int64_t>> retired_ranges;
+#endif
+    public:
+#ifndef _WIN32
+        static constexpr bool is_supported = true;
+#else
+        static constexpr bool is_supported = false;
+#endif
+
+        ReservedMapping() = default;
+        ReservedMapping(const ReservedMapping&) = delete;
+        ReservedMapping& operator=(const ReservedMapping&) = delete;
+
+#ifndef _WIN32
+        ~ReservedMapping() {
+            unmap(base, reserved_size);
+            for (const auto& [range, size]: retired_ranges)
+                unmap(range, size);
+            if (fd >= 0)
+                ::close(fd);
+        }
+
+        /** Maps the file, at least RANGE_SIZE bytes of the address space are reserved */
+        void open(const std::string& path, const int64_t range_size) {
+            fd = ::open(path.c_str(), O_RDWR);
+            if (fd < 0)
+                throw std::runtime_error("Can't open the mapped file, path = " + path);
+            struct stat st {};
+            ::fstat(fd, &st);
+            file_size = st.st_size;
+            reserve(std::max(range_size, 2 * align(file_size)));
+        }
+
+        bool is_open() const {
+            return fd >= 0;
+        }
+
+        uint8_t* begin() const {
+            return base;
+        }
+
+        /** The mapped part of the range, page-aligned */
+        int64_t get_mapped_size() const {
+            return mapped_size;
+        }
+
+        /** Resizes the file, the base address is changed only if the file doesn't fit into the range */
+        void resize(const int64_t size) {
+            if (::ftruncate(fd, size) != 0)
+                throw std::runtime_error("Can't resize the mapped file");
+            file_size = size;
+
+            auto new_mapped_size = align(size);
+            if (new_mapped_size > reserved_size) {
+                retired_ranges.emplace_back(base, reserved_size);
+                base = nullptr;
+                reserve(2 * new_mapped_size);
+            } else if (new_mapped_size > mapped_size) {
+                map(mapped_size, new_mapped_size);
+            } else if (new_mapped_size < mapped_size) {
+                // The dropped tail is reserved again
+                auto* tail = ::mmap(base + new_mapped_size, mapped_size - new_mapped_size, PROT_NONE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+                if (tail == MAP_FAILED)
+                    throw std::runtime_error("Can't shrink the mapped file");
+                mapped_size = new_mapped_size;
+            }
+        }
+
+        void flush() {
+            if (mapped_size > 0)
+                ::msync(base, mapped_size, MS_SYNC);
+        }
+
+    private:
+        static int64_t align(const int64_t size) {
+            static const int64_t page_size = ::sysconf(_SC_PAGESIZE);
+            return (size + page_size - 1) / page_size * page_size;
+        }
+
+        static void unmap(uint8_t* range, const int64_t size) {
+            if (range)
+                ::munmap(range, size);
+        }
+
+        void reserve(const int64_t size) {
+            auto* range = ::mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (range == MAP_FAILED)
+                throw std::runtime_error("Can't reserve the address range for the mapped file");
+            base = static_cast<uint8_t*>(range);
+            reserved_size = size;
+            mapped_size = 0;
+            map(0, align(file_size));
+        }
+
+        void map(const int64_t from, const int64_t to) {
+            if (from >= to)
+                return;
+            auto* part = ::mmap(base + from, to - from, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, from);
+            if (part == MAP_FAILED)
+                throw std::runtime_error("Can't map the file into the reserved range");
+            mapped_size = to;
+        }
+#else
+        void open(const std::string&, const int64_t) {}
+        bool is_open() const { return false; }
+        uint8_t* begin() const { return nullptr; }
+        int64_t get_mapped_size() const { return 0; }
+        void resize(const int64_t) {}
+        void flush() {}
+#endif
+    };
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/array.hpp>
+
+#include "utils/compression.h"
+
+namespace btree {
+    /**
+     * Compression of the values by the codec of the volume. The codecs don't keep any state between the values,
+     * every value is decompressed on its own.
+     * LZ_COMPRESSION writes a sequence of (TOKEN, LITERALS, OFFSET) blocks: the high half of TOKEN is the number
+     * of literals, the low half is the match length - 4, the halves equal to 15 are continued by the bytes
+     * till one is less than 255; OFFSET (2 bytes) is the distance back to the match. The last block has no match.
+     */
+    class ValueCodec final {
+        static constexpr int32_t MIN_MATCH = 4;
+        static constexpr int32_t MAX_OFFSET = 65535;
+        static constexpr int32_t HASH_BITS = 12;
+
+        /** Sink of Boost.Iostreams appending to a vector */
+        struct VectorSink {
+            using char_type = char;
+            using category = boost::iostreams::sink_tag;
+
+            std::vector<uint8_t>* out;
+
+            std::streamsize write(const char* data, std::streamsize size) {
+                out->insert(out->end(), data, data + size);
+                return size;
+            }
+        };
+    public:
+        /** Appends DATA of SIZE bytes compressed by CODEC to OUT */
+        static void compress(const Compression codec, const uint8_t* data, const int32_t size, std::vector<uint8_t>& out) {
+            if (codec == ZLIB_COMPRESSION)
+                zlib_compress(data, size, out);
+            else
+                lz_compress(data, size, out);
+        }
+
+        /** Writes RAW_SIZE bytes decompressed from DATA of SIZE bytes to OUT, returns false if DATA is corrupted */
+        static bool decompress(const Compression codec, const uint8_t* data, const int32_t size, const int32_t raw_size,
+                               std::vector<uint8_t>& out) {
+            if (raw_size < 0)
+                return false;
+            out.resize(raw_size);
+            if (codec == ZLIB_COMPRESSION)
+                return zlib_decompress(data, size, out);
+            return lz_decompress(data, size, out);
+        }
+
+    private:
+        static void zlib_compress(const uint8_t* data, const int32_t size, std::vector<uint8_t>& out) {
+            namespace bio = boost::iostreams;
+            bio::filtering_ostream stream;
+            stream.push(bio::zlib_compressor(bio::zlib::best_speed));
+            stream.push(VectorSink{ &out });
+            stream.write(reinterpret_cast<const char*>(data), size);
+            // The compressor is flushed to the sink when the chain is closed
+            stream.reset();
+        }
+
+        static bool zlib_decompress(const uint8_t* data, const int32_t size, std::vector<uint8_t>& out) {
+            namespace bio = boost::iostreams;
+            try {
+                bio::filtering_istream stream;
+                stream.push(bio::zlib_decompressor());
+                stream.push(bio::array_source(reinterpret_cast<const char*>(data), size));
+                stream.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(out.size()));
+                return stream.gcount() == static_cast<std::streamsize>(out.size());
+            } catch (const std::exception&) {
+                return false;
+            }
+        }
+
+        static uint32_t load32(const uint8_t* data) {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        static void write_length(const int32_t length, std::vector<uint8_t>& out) {
+            for (auto rest = length - 15; rest >= 0; rest -= 255)
+                out.push_back(static_cast<uint8_t>(std::min(rest, 255)));
+        }
+
+        static void lz_compress(const uint8_t* data, const int32_t size, std::vector<uint8_t>& out) {
+            auto write_block = [&](const int32_t literals_begin, const int32_t literals_end, const int32_t offset,
+                                   const int32_t match_length) {
+                auto literals = literals_end - literals_begin;
+                auto match_code = (offset > 0) ? match_length - MIN_MATCH : 0;
+                out.push_back(static_cast<uint8_t>((std::min(literals, 15) << 4) | std::min(match_code, 15)));
+                write_length(literals, out);
+                out.insert(out.end(), data + literals_begin, data + literals_end);
+                if (offset > 0) {
+                    out.push_back(static_cast<uint8_t>(offset & 0xFF));
+                    out.push_back(static_cast<uint8_t>(offset >> 8));
+                    write_length(match_code, out);
+                }
+            };
+
+            // The last position of every hash of 4 bytes
+            std::array<int32_t, 1 << HASH_BITS> last_pos;
+            last_pos.fill(-1);
+            int32_t literals_begin = 0;
+            for (int32_t i = 0; i + MIN_MATCH <= size;) {
+                auto sequence = load32(data + i);
+                auto& candidate = last_pos[(sequence * 2654435761u) >> (32 - HASH_BITS)];
+                auto match_pos = candidate;
+                candidate = i;
+                if (match_pos < 0 || i - match_pos > MAX_OFFSET || load32(data + match_pos) != sequence) {
+                    ++i;
+                    continue;
+                }
+
+                auto match_length = MIN_MATCH;
+                while (i + match_length < size && data[match_pos + match_length] == data[i + match_length])
+                    ++match_length;
+                write_block(literals_begin, i, i - match_pos, match_length);
+                i += match_length;
+                literals_begin = i;
+            }
+            write_block(literals_begin, size, 0, 0);
+        }
+
+        static bool lz_decompress(const uint8_t* data, const int32_t size, std::vector<uint8_t>& out) {
+            const uint8_t* in = data;
+            const uint8_t* in_end = data + size;
+            size_t out_pos = 0;
+            auto read_length = [&](int32_t length) {
+                if (length < 15)
+                    return length;
+                for (uint8_t next = 255; next == 255 && in < in_end && length <= static_cast<int32_t>(out.size()); length += next)
+                    next = *in++;
+                return length;
+            };
+
+            while (in < in_end) {
+                auto token = *in++;
+                auto literals = read_length(token >> 4);
+                if (literals > in_end - in || static_cast<size_t>(literals) > out.size() - out_pos)
+                    return false;
+                if (literals > 0)
+                    std::memcpy(out.data() + out_pos, in, literals);
+                in += literals;
+                out_pos += literals;
+                // The last block has only the literals
+                if (in == in_end)
+                    break;
+
+                if (in_end - in < 2)
+                    return false;
+                size_t offset = in[0] | (in[1] << 8);
+                in += 2;
+                auto match_length = read_length(token & 0xF) + MIN_MATCH;
+                if (offset == 0 || offset > out_pos || static_cast<size_t>(match_length) > out.size() - out_pos)
+                    return false;
+                // The match may overlap the bytes it writes
+                for (auto i = 0; i < match_length; ++i, ++out_pos)
+                    out[out_pos] = out[out_pos - offset];
+            }
+            return out_pos == out.size();
+        }
+    };
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace btree {
+    /**
+     * Version latches of the file positions (nodes, entries, the header) for optimistic lock coupling:
+     *  - the writer latches a position before it's modified and releases all its latches at the end of the operation,
+     *    so the version is odd while the position is modified and grows after
+     *  - a reader takes the version before reading and validates it after, it never writes to the shared memory
+     * Positions are hashed to a fixed number of latches: a collision only causes a spurious restart of the reader.
+     * The writers must be serialized.
+     */
+    class VersionLatches final {
+        static constexpr int32_t LATCHES_BITS = 12;
+        static constexpr size_t LATCHES_COUNT = size_t(1) << LATCHES_BITS;
+
+        std::unique_ptr<std::atomic<uint64_t>[]> versions;
+        std::vector<size_t> held;
+    public:
+        VersionLatches() : versions(new std::atomic<uint64_t>[LATCHES_COUNT]) {
+            for (size_t i = 0; i < LATCHES_COUNT; ++i)
+                versions[i].store(0, std::memory_order_relaxed);
+        }
+
+        static bool is_latched(const uint64_t version) {
+            return version & 1;
+        }
+
+        uint64_t read_version(const int64_t pos) const {
+            return versions[index(pos)].load(std::memory_order_acquire);
+        }
+
+        /** True if POS hasn't been latched since READ_VERSION returned VERSION: the data read meanwhile is consistent */
+        bool validate(const int64_t pos, const uint64_t version) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return versions[index(pos)].load(std::memory_order_relaxed) == version;
+        }
+
+        void latch(const int64_t pos) {
+            auto i = index(pos);
+            auto version = versions[i].load(std::memory_order_relaxed);
+            if (is_latched(version))
+                return;
+            versions[i].store(version + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            held.push_back(i);
+        }
+
+        void release_all() {
+            for (auto i: held)
+                versions[i].store(versions[i].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            held.clear();
+        }
+
+    private:
+        static size_t index(const int64_t pos) {
+            // Fibonacci hashing: the neighbour positions get different latches
+            return (static_cast<uint64_t>(pos) * 0x9E3779B97F4A7C15ull) >> (64 - LATCHES_BITS);
+        }
+    };
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <set>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <unordered_map>
+
+namespace btree {
+    /**
+     * Copy-on-write state of the snapshots of a volume file, the old pages are reclaimed by epochs:
+     *  - every snapshot gets the next epoch
+     *  - the first rewrite of a node in place after the last snapshot keeps the copy of the node page tagged with
+     *    the epoch of the last snapshot, a snapshot reads the first copy tagged with an epoch >= its own one
+     *  - the freed nodes and entries are tagged in the same way and aren't reused: the snapshots may still read them
+     *  - the copies and the freed space of an epoch are released when all the snapshots up to this epoch are released
+     * The copies are read concurrently with the writer, the other methods are called by the writer.
+     */
+    class VersionStore final {
+    public:
+        struct FreedSpace {
+            bool is_node;
+            int64_t pos;
+            int32_t size;
+        };
+
+        uint64_t take_snapshot() {
+            std::scoped_lock lock(mutex_);
+            live_epochs.insert(++current_epoch);
+            has_live_epochs.store(true, std::memory_order_relaxed);
+            return current_epoch;
+        }
+
+        /** Returns the freed space which isn't visible to any snapshot anymore */
+        std::vector<FreedSpace> release_snapshot(const uint64_t epoch) {
+            std::scoped_lock lock(mutex_);
+            auto it = live_epochs.find(epoch);
+            if (it != live_epochs.end())
+                live_epochs.erase(it);
+            has_live_epochs.store(!live_epochs.empty(), std::memory_order_relaxed);
+            auto oldest_epoch = live_epochs.empty() ? std::numeric_limits<uint64_t>::max() : *live_epochs.begin();
+
+            while (!copies_order.empty() && copies_order.front().first < oldest_epoch) {
+                auto copies = page_copies.find(copies_order.front().second);
+                copies->second.erase(copies->second.begin());
+                if (copies->second.empty())
+                    page_copies.erase(copies);
+                copies_order.pop_front();
+            }
+
+            std::vector<FreedSpace> released;
+            while (!freed.empty() && freed.front().first < oldest_epoch) {
+                released.push_back(freed.front().second);
+                freed.pop_front();
+            }
+            return released;
+        }
+
+        bool has_snapshots() const {
+            return has_live_epochs.load(std::memory_order_relaxed);
+        }
+
+        /** True if the page at POS must be copied before it's rewritten */
+        bool needs_copy(const int64_t pos) const {
+            if (!has_snapshots())
+                return false;
+            std::scoped_lock lock(mutex_);
+            auto copies = page_copies.find(pos);
+            return copies == page_copies.end() || copies->second.back().epoch < current_epoch;
+        }
+
+        void add_copy(const int64_t pos, std::vector<uint8_t>&& bytes) {
+            std::scoped_lock lock(mutex_);
+            page_copies[pos].push_back({ current_epoch, std::move(bytes) });
+            copies_order.emplace_back(current_epoch, pos);
+        }
+
+        /** Calls ON_COPY(bytes) for the copy of the page at POS which is visible to the snapshot of EPOCH if there is one */
+        template <typename Func>
+        bool read_copy(const int64_t pos, const uint64_t epoch, Func&& on_copy) const {
+            std::scoped_lock lock(mutex_);
+            auto copies = page_copies.find(pos);
+            if (copies == page_copies.end())
+                return false;
+            for (const auto& copy: copies->second) {
+                if (copy.epoch >= epoch) {
+                    on_copy(copy.bytes);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void defer_free(const FreedSpace& space) {
+            std::scoped_lock lock(mutex_);
+            freed.emplace_back(current_epoch, space);
+        }
+
+        size_t freed_count() const {
+            std::scoped_lock lock(mutex_);
+            return freed.size();
+        }
+
+        /** The space deferred after the first COUNT ones is in use again */
+        void drop_freed(const size_t count) {
+            std::scoped_lock lock(mutex_);
+            if (freed.size() > count)
+                freed.resize(count);
+        }
+
+        /** Drops all the snapshots, returns all the deferred space */
+        std::vector<FreedSpace> release_all() {
+            std::scoped_lock lock(mutex_);
+            live_epochs.clear();
+            has_live_epochs.store(false, std::memory_order_relaxed);
+            page_copies.clear();
+            copies_order.clear();
+
+            std::vector<FreedSpace> released;
+            for (const auto& [epoch, space]: freed)
+                released.push_back(space);
+            freed.clear();
+            return released;
+        }
+
+    private:
+        struct PageCopy {
+            uint64_t epoch;
+            std::vector<uint8_t> bytes;
+        };
+
+        mutable std::mutex mutex_;
+        uint64_t current_epoch = 0;
+        std::multiset<uint64_t> live_epochs;
+        // The writer checks it without the lock: the snapshots are taken and released by the writer
+        std::atomic<bool> has_live_epochs = false;
+        // The copies of a page are ordered by epoch
+        std::unordered_map<int64_t, std::vector<PageCopy>> page_copies;
+        std::deque<std::pair<uint64_t, int64_t>> copies_order;
+        std::deque<std::pair<uint64_t, FreedSpace>> freed;
+    };
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+
+#include "memory_advice.h"
+#include "utils/boost_include.h"
+
+namespace btree {
+    /**
+     * Mapping of a file by windows on demand, for the files which can't be mapped as a whole:
+     *  - the file is split into chunks of WINDOW_SIZE bytes, a chunk is mapped by its window when it's first accessed,
+     *    the windows are found by the chunk index
+     *  - a range which straddles the chunk boundary (or is larger than a chunk) is mapped by its own window
+     *  - the windows are mapped at their full size, so they stay valid when the file grows
+     *  - the least recently used windows are unmapped by EVICT() when more than MAX_MAPPED_BYTES are mapped,
+     *    the addresses taken before are valid till then
+     */
+    class WindowedMapping final {
+        struct Window {
+            int64_t begin;
+            int64_t size;
+            uint64_t last_use;
+            bip::mapped_region region;
+
+            uint8_t* address(const int64_t offset) const {
+                return static_cast<uint8_t*>(region.get_address()) + (offset - begin);
+            }
+        };
+
+        bip::file_mapping file;
+        const int64_t window_size;
+        const int64_t max_mapped_bytes;
+        int64_t mapped_bytes = 0;
+        uint64_t clock = 0;
+        // Applied to every new window
+        AccessPattern pattern = NORMAL;
+        std::unordered_map<int64_t, Window> chunks;
+        std::vector<Window> wide_windows;
+    public:
+        WindowedMapping(const std::string& path, const int64_t window_size, const int64_t max_mapped_bytes) :
+            file(path.data(), bip::read_write), window_size(align(std::max<int64_t>(window_size, 1))),
+            max_mapped_bytes(max_mapped_bytes) {}
+
+        /** Address of the contiguously mapped range [OFFSET, OFFSET + SIZE) */
+        uint8_t* address(const int64_t offset, const int64_t size) {
+            auto chunk = offset / window_size;
+            auto chunk_begin = chunk * window_size;
+            bool fits_chunk = offset + size <= chunk_begin + window_size;
+            if (fits_chunk) {
+                auto it = chunks.find(chunk);
+                if (it == chunks.end())
+                    it = chunks.emplace(chunk, map(chunk_begin, window_size)).first;
+                it->second.last_use = ++clock;
+                return it->second.address(offset);
+            }
+
+            for (auto& window: wide_windows) {
+                if (window.begin <= offset && offset + size <= window.begin + window.size) {
+                    window.last_use = ++clock;
+                    return window.address(offset);
+                }
+            }
+            auto begin = offset / page_size() * page_size();
+            wide_windows.push_back(map(begin, align(offset + size) - begin));
+            wide_windows.back().last_use = ++clock;
+            return wide_windows.back().address(offset);
+        }
+
+        /** Unmaps the least recently used windows till MAX_MAPPED_BYTES are mapped */
+        void evict() {
+            while (mapped_bytes > max_mapped_bytes && (!chunks.empty() || !wide_windows.empty())) {
+                auto lru_chunk = std::min_element(chunks.begin(), chunks.end(), [](const auto& a, const auto& b) {
+                    return a.second.last_use < b.second.last_use;
+                });
+                auto lru_wide = std::min_element(wide_windows.begin(), wide_windows.end(), [](const auto& a, const auto& b) {
+                    return a.last_use < b.last_use;
+                });
+                bool is_chunk = lru_wide == wide_windows.end() ||
+                                (lru_chunk != chunks.end() && lru_chunk->second.last_use < lru_wide->last_use);
+                if (is_chunk) {
+                    mapped_bytes -= lru_chunk->second.size;
+                    chunks.erase(lru_chunk);
+                } else {
+                    mapped_bytes -= lru_wide->size;
+                    wide_windows.erase(lru_wide);
+                }
+            }
+        }
+
+        void flush() {
+            for (auto& [chunk, window]: chunks)
+                window.region.flush(0, 0, false);
+            for (auto& window: wide_windows)
+                window.region.flush(0, 0, false);
+        }
+
+        /** PATTERN is applied to the mapped windows and to the windows mapped later, WILLNEED only to the mapped ones */
+        void advise(const AccessPattern new_pattern) {
+            for (auto& [chunk, window]: chunks)
+                advise_memory(window.region.get_address(), window.size, new_pattern);
+            for (auto& window: wide_windows)
+                advise_memory(window.region.get_address(), window.size, new_pattern);
+            if (new_pattern != WILLNEED)
+                pattern = new_pattern;
+        }
+
+        int64_t get_mapped_bytes() const {
+            return mapped_bytes;
+        }
+
+    private:
+        static int64_t page_size() {
+            return static_cast<int64_t>(bip::mapped_region::get_page_size());
+        }
+
+        static int64_t align(const int64_t size) {
+            return (size + page_size() - 1) / page_size() * page_size();
+        }
+
+        Window map(const int64_t begin, const int64_t size) {
+            mapped_bytes += size;
+            Window window{ begin, size, 0, bip::mapped_region(file, bip::read_write, begin, size) };
+            if (pattern != NORMAL)
+                advise_memory(window.region.get_address(), size, pattern);
+            return window;
+        }
+    };
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+
+#include "utils/forward_decl.h"
+
+/**
+ * Write-ahead log (WAL) file "<volume path>.wal" keeps logical operations since the last checkpoint
+ * and the images of the volume file pages they modify:
+ *
+ * - Record:
+ *     - PAYLOAD_SIZE             |=> takes 4 bytes
+ *     - CRC32                    |=> takes 4 bytes -> checksum of the payload, a torn record ends the log
+ *     - PAYLOAD:
+ *        - OP                    |=> takes 1 byte  -> OP = 0 for set, OP = 1 for remove
+ *        - KEY                   |=> takes KEY_SIZE bytes
+ *        - VALUE                 |=> takes (PAYLOAD_SIZE - 1 - KEY_SIZE) bytes, only for set
+ *     or for batch:
+ *        - OP                    |=> takes 1 byte  -> OP = 4
+ *        - OPERATION             |=> repeated till the end of payload:
+ *            - OP                |=> takes 1 byte  -> OP = 0 for set, OP = 1 for remove
+ *            - KEY               |=> takes KEY_SIZE bytes
+ *            - SIZE              |=> takes 4 bytes
+ *            - VALUE             |=> takes SIZE bytes
+ *   The operations of a batch share the checksum: the batch is replayed whole or not at all.
+ *     or for page:
+ *        - OP                    |=> takes 1 byte  -> OP = 2
+ *        - POS                   |=> takes 8 bytes -> pos of the page in the volume file
+ *        - DATA                  |=> takes (PAYLOAD_SIZE - 9) bytes -> the page as it was at the checkpoint
+ *     or for checkpoint:
+ *        - OP                    |=> takes 1 byte  -> OP = 3
+ *        - FILE_END              |=> takes 8 bytes -> the end of the volume file flushed by the checkpoint
+ *
+ * An operation is durable when its record is synced. Concurrent writers are group committed:
+ * one of them syncs the log for all the records appended so far while the others wait for it.
+ * The checkpoint flushes the volume file and truncates the log.
+ *
+ * The kernel writes the modified pages of the mapping back at any time, so a page older than the checkpoint
+ * is logged before it's modified for the first time since it. The image is written to the log right away
+ * and synced with the records by the group commit, no sync is added per page. After a crash the pages are
+ * written back and the volume file is cut at FILE_END: it's restored to the checkpoint, then the records are replayed.
+ * A power loss may leave a page torn only if the kernel has written it back between its first modification
+ * and the sync of that operation.
+ */
+namespace btree {
+    /** Counters of the write-ahead log since the volume is opened */
+    struct WalStats {
+        // The logged operations
+        int64_t records = 0;
+        // The syncs of the group commit, the checkpoints aren't counted
+        int64_t syncs = 0;
+        // The page images written to the log
+        int64_t saved_pages = 0;
+    };
+
+    template <typename K, typename V>
+    class WriteAheadLog final {
+        using EntryT = typename BTree<K, V>::EntryT;
+
+        enum Op: uint8_t {
+            SET = 0,
+            REMOVE = 1,
+            PAGE = 2,
+            CHECKPOINT = 3,
+            BATCH = 4
+        };
+        static constexpr int32_t record_header_size_in_bytes = 2 * sizeof(uint32_t);
+        static constexpr int64_t NO_CHECKPOINT = -1;
+
+        mutable std::mutex mutex_;
+        std::condition_variable synced;
+        std::FILE* file;
+        int64_t size_in_bytes;
+        uint64_t appended_lsn;
+        uint64_t synced_lsn;
+        bool sync_in_progress;
+        const int64_t page_size;
+        // The end of the volume file at the checkpoint: the pages after it aren't saved
+        int64_t file_end;
+        std::unordered_set<int64_t> saved_pages;
+        WalStats stats;
+    public:
+        const std::string path;
+
+        explicit WriteAheadLog(const std::string& volume_path);
+        ~WriteAheadLog();
+
+        static std::string path_of(const std::string& volume_path);
+
+        /**
+         * Writes the pages saved since the last checkpoint back to the volume file at VOLUME_PATH, cuts it at FILE_END
+         * and syncs it. The log is kept: its records are replayed on the restored file, its torn tail is cut
+         */
+        static void restore(const std::string& volume_path);
+
+        /** Both return the log sequence number (LSN) of the record */
+        uint64_t append_set(const EntryT& e);
+        uint64_t append_remove(const K key);
+        /** One record for all the operations of BATCH */
+        uint64_t append_batch(const WriteBatch<K, V>& batch);
+
+        /**
+         * Logs the images of the pages of SIZE bytes from POS which are older than the checkpoint and aren't logged yet,
+         * PAGE(pos, size) returns their bytes. They're written to the log when it returns, they're synced with the records
+         */
+        template <typename PageFunc>
+        void save_pages(const int64_t pos, const int64_t size, PageFunc&& page);
+
+        /** Returns when all the records up to LSN are synced */
+        void sync(const uint64_t lsn);
+
+        /** Calls ON_SET(key, data, size) and ON_REMOVE(key) for the valid records, returns the number of records */
+        template <typename SetFunc, typename RemoveFunc>
+        int64_t replay(SetFunc&& on_set, RemoveFunc&& on_remove);
+
+        /** Must be called after the volume file is flushed up to FILE_END: all the logged operations are durable */
+        void truncate(const int64_t file_end);
+
+        /**
+         * Must be called after the restored volume file is flushed up to FILE_END: the pages saved before aren't restored
+         * anymore, the records are kept till they're replayed
+         */
+        void restart_pages(const int64_t file_end);
+
+        /**
+         * Must be called after the last flush of the volume file before it's replaced: the pages saved before aren't
+         * restored on any file, the records are kept till DISCARD() since the replaced file and the new one contain them
+         */
+        void drop_pages();
+
+        /** Must be called after the last flush of the volume file: nothing is restored or replayed on next open */
+        void discard();
+
+        int64_t size() const;
+        WalStats get_stats() const;
+    private:
+        uint64_t append(const Op op, const K key, const uint8_t* data, const int32_t size);
+        uint64_t append(std::vector<uint8_t>& record);
+        void write(std::vector<uint8_t>& record);
+        void write_checkpoint(const int64_t checkpoint_end);
+        template <typename SetFunc, typename RemoveFunc>
+        static void replay_batch(const uint8_t* payload, const uint32_t payload_size, SetFunc& on_set, RemoveFunc& on_remove);
+        void open(const char* mode);
+
+        /** Calls ON_PAYLOAD(payload, size) for the records of LOG till the first torn one, returns their size in bytes */
+        template <typename Func>
+        static int64_t read_records(std::FILE* log, const int64_t log_size, Func&& on_payload);
+    };
+}
+
+#include "io/write_ahead_log_impl.h"
@@ -0,0 +1,388 @@
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <filesystem>
+#include <boost/crc.hpp>
+
+#include "utils/utils.h"
+#include "utils/boost_include.h"
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+#endif
+
+namespace btree {
+namespace file {
+    inline void sync(std::FILE* file) {
+#if defined(_WIN32)
+        _commit(_fileno(file));
+#elif defined(__APPLE__)
+        fsync(fileno(file));
+#else
+        fdatasync(fileno(file));
+#endif
+    }
+
+    /** The file or the directory at PATH is synced: a directory is synced to make a rename in it durable */
+    inline void sync(const std::string& path, const bool is_directory = false) {
+#if defined(_WIN32)
+        // The directory entries are written through on Windows
+        if (is_directory)
+            return;
+        int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+        if (fd < 0)
+            throw std::runtime_error("Can't sync the file: " + path);
+        _commit(fd);
+        _close(fd);
+#else
+        int fd = ::open(path.c_str(), is_directory ? O_RDONLY | O_DIRECTORY : O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Can't sync the file: " + path);
+        ::fsync(fd);
+        ::close(fd);
+#endif
+    }
+
+    inline uint32_t crc32(const uint8_t* data, const size_t size) {
+        boost::crc_32_type crc;
+        crc.process_bytes(data, size);
+        return crc.checksum();
+    }
+}
+
+    template <typename K, typename V>
+    WriteAheadLog<K, V>::WriteAheadLog(const std::string& volume_path) :
+        file(nullptr), size_in_bytes(0), appended_lsn(0), synced_lsn(0), sync_in_progress(false),
+        page_size(bip::mapped_region::get_page_size()), file_end(NO_CHECKPOINT), path(path_of(volume_path))
+    {
+        open("ab+");
+        std::fseek(file, 0, SEEK_END);
+        size_in_bytes = std::ftell(file);
+    }
+
+    template <typename K, typename V>
+    WriteAheadLog<K, V>::~WriteAheadLog() {
+        std::fclose(file);
+    }
+
+    template <typename K, typename V>
+    std::string WriteAheadLog<K, V>::path_of(const std::string& volume_path) {
+        return volume_path + ".wal";
+    }
+
+    template <typename K, typename V>
+    void WriteAheadLog<K, V>::open(const char* mode) {
+        file = std::fopen(path.c_str(), mode);
+        if (!file)
+            throw std::runtime_error("Can't open the write-ahead log: " + path);
+    }
+
+    template <typename K, typename V>
+    void WriteAheadLog<K, V>::restore(const std::string& volume_path) {
+        const auto log_path = path_of(volume_path);
+        std::FILE* log = std::fopen(log_path.c_str(), "rb");
+        if (!log)
+            return;
+
+        std::error_code error_code;
+        auto log_size = static_cast<int64_t>(std::filesystem::file_size(log_path, error_code));
+        int64_t checkpoint_end = NO_CHECKPOINT;
+        std::vector<std::pair<int64_t, std::vector<uint8_t>>> pages;
+        auto valid_size = read_records(log, log_size, [&](const uint8_t* payload, const uint32_t payload_size) {
+            if ((payload[0] != PAGE && payload[0] != CHECKPOINT) || payload_size < sizeof(Op) + sizeof(int64_t))
+                return;
+            int64_t pos;
+            std::memcpy(&pos, payload + sizeof(Op), sizeof(pos));
+            if (payload[0] == CHECKPOINT) {
+                // The pages saved before the last checkpoint are in the file already
+                checkpoint_end = pos;
+                pages.clear();
+            } else {
+                pages.emplace_back(pos, std::vector<uint8_t>(payload + sizeof(Op) + sizeof(pos), payload + payload_size));
+            }
+        });
+        std::fclose(log);
+        // The torn tail is cut: the records appended from now on follow the valid ones
+        if (valid_size < log_size)
+            std::filesystem::resize_file(log_path, valid_size);
+        if (checkpoint_end == NO_CHECKPOINT || !std::filesystem::exists(volume_path))
+            return;
+
+        std::filesystem::resize_file(volume_path, checkpoint_end);
+        std::FILE* volume_file = std::fopen(volume_path.c_str(), "rb+");
+        if (!volume_file)
+            throw std::runtime_error("Can't restore the volume file: " + volume_path);
+        for (const auto& [pos, data]: pages) {
+            std::fseek(volume_file, pos, SEEK_SET);
+            std::fwrite(data.data(), 1, data.size(), volume_file);
+        }
+        std::fflush(volume_file);
+        file::sync(volume_file);
+        std::fclose(volume_file);
+    }
+
+    template <typename K, typename V>
+    uint64_t WriteAheadLog<K, V>::append_set(const EntryT& e) {
+        if constexpr (std::is_arithmetic_v<V>)
+            return append(SET, e.key, cast_to_const_uint8_t_data(&e.data), e.size_in_bytes);
+        else
+            return append(SET, e.key, e.data, e.size_in_bytes);
+    }
+
+    template <typename K, typename V>
+    uint64_t WriteAheadLog<K, V>::append_remove(const K key) {
+        return append(REMOVE, key, nullptr, 0);
+    }
+
+    template <typename K, typename V>
+    uint64_t WriteAheadLog<K, V>::append_batch(const WriteBatch<K, V>& batch) {
+        std::vector<uint8_t> record(record_header_size_in_bytes);
+        record.push_back(BATCH);
+        auto append_op = [&record](const Op op, const K key, const uint8_t* data, const int32_t size) {
+            record.push_back(op);
+            auto* key_data = cast_to_const_uint8_t_data(&key);
+            record.insert(record.end(), key_data, key_data + sizeof(key));
+            auto* size_data = cast_to_const_uint8_t_data(&size);
+            record.insert(record.end(), size_data, size_data + sizeof(size));
+            if (size > 0)
+                record.insert(record.end(), data, data + size);
+        };
+        batch.for_each([&](const K key, const uint8_t* data, const int32_t size) { append_op(SET, key, data, size); },
+                       [&](const K key) { append_op(REMOVE, key, nullptr, 0); });
+        return append(record);
+    }
+
+    template <typename K, typename V>
+    uint64_t WriteAheadLog<K, V>::append(const Op op, const K key, const uint8_t* data, const int32_t size) {
+        std::vector<uint8_t> record(record_header_size_in_bytes + sizeof(op) + sizeof(key) + size);
+        uint8_t* payload = record.data() + record_header_size_in_bytes;
+
+        payload[0] = op;
+        std::memcpy(payload + sizeof(op), &key, sizeof(key));
+        if (size > 0)
+            std::memcpy(payload + sizeof(op) + sizeof(key), data, size);
+        return append(record);
+    }
+
+    template <typename K, typename V>
+    uint64_t WriteAheadLog<K, V>::append(std::vector<uint8_t>& record) {
+        std::scoped_lock lock(mutex_);
+        write(record);
+        ++stats.records;
+        return ++appended_lsn;
+    }
+
+    template <typename K, typename V>
+    void WriteAheadLog<K, V>::write(std::vector<uint8_t>& record) {
+        // The header is filled here, the payload follows it
+        uint8_t* payload = record.data() + record_header_size_in_bytes;
+        uint32_t payload_size = static_cast<uint32_t>(record.size() - record_header_size_in_bytes);
+        uint32_t crc = file::crc32(payload, payload_size);
+        std::memcpy(record.data(), &payload_size, sizeof(payload_size));
+        std::memcpy(record.data() + sizeof(payload_size), &crc, sizeof(crc));
+
+        if (std::fwrite(record.data(), 1, record.size(), file) != record.size())
+            throw std::runtime_error("Can't write to the write-ahead log: " + path);
+        size_in_bytes += static_cast<int64_t>(record.size());
+    }
+
+    template <typename K, typename V>
+    template <typename PageFunc>
+    void WriteAheadLog<K, V>::save_pages(const int64_t pos, const int64_t size, PageFunc&& page) {
+        std::scoped_lock lock(mutex_);
+        if (pos >= file_end)
+            return;
+
+        bool is_saved = false;
+        auto last = std::min(pos + size, file_end);
+        for (auto page_pos = pos / page_size * page_size; page_pos < last; page_pos += page_size) {
+            if (!saved_pages.insert(page_pos).second)
+                continue;
+            auto page_bytes = std::min(page_size, file_end - page_pos);
+            std::vector<uint8_t> record(record_header_size_in_bytes + sizeof(Op) + sizeof(page_pos) + page_bytes);
+            uint8_t* payload = record.data() + record_header_size_in_bytes;
+            payload[0] = PAGE;
+            std::memcpy(payload + sizeof(Op), &page_pos, sizeof(page_pos));
+            std::memcpy(payload + sizeof(Op) + sizeof(page_pos), page(page_pos, page_bytes), page_bytes);
+            write(record);
+            ++stats.saved_pages;
+            is_saved = true;
+        }
+        // The image leaves the process before the page is modified: it survives a crash of the process
+        if (is_saved && std::fflush(file) != 0)
+            throw std::runtime_error("Can't write to the write-ahead log: " + path);
+    }
+
+    template <typename K, typename V>
+    void WriteAheadLog<K, V>::sync(const uint64_t lsn) {
+        std::unique_lock lock(mutex_);
+        while (synced_lsn < lsn) {
+            if (sync_in_progress) {
+                // The current leader may sync only a part of the records we need, then the next round starts
+                synced.wait(lock);
+                continue;
+            }
+
+            // Become the leader: one sync for all the records and the pages appended so far
+            sync_in_progress = true;
+            auto target_lsn = appended_lsn;
+            std::fflush(file);
+            ++stats.syncs;
+            lock.unlock();
+
+            file::sync(file);
+
+            lock.lock();
+            synced_lsn = std::max(synced_lsn, target_lsn);
+            sync_in_progress = false;
+            synced.notify_all();
+        }
+    }
+
+    template <typename K, typename V>
+    template <typename SetFunc, typename RemoveFunc>
+    int64_t WriteAheadLog<K, V>::replay(SetFunc&& on_set, RemoveFunc&& on_remove) {
+        int64_t log_size;
+        {
+            std::scoped_lock lock(mutex_);
+            std::fflush(file);
+            log_size = size_in_bytes;
+        }
+        // The replayed operations save the pages they modify to the log: it's read by another handle without the lock
+        std::FILE* log = std::fopen(path.c_str(), "rb");
+        if (!log)
+            throw std::runtime_error("Can't open the write-ahead log: " + path);
+
+        int64_t records = 0;
+        read_records(log, log_size, [&](const uint8_t* payload, const uint32_t payload_size) {
+            if (payload[0] == BATCH) {
+                replay_batch(payload, payload_size, on_set, on_remove);
+                ++records;
+                return;
+            }
+            if ((payload[0] != SET && payload[0] != REMOVE) || payload_size < sizeof(Op) + sizeof(K))
+                return;
+
+            K key;
+            std::memcpy(&key, payload + sizeof(Op), sizeof(key));
+            if (payload[0] == SET)
+                on_set(key, payload + sizeof(Op) + sizeof(key), static_cast<int32_t>(payload_size - sizeof(Op) - sizeof(key)));
+            else
+                on_remove(key);
+            ++records;
+        });
+        std::fclose(log);
+        return records;
+    }
+
+    template <typename K, typename V>
+    template <typename SetFunc, typename RemoveFunc>
+    void WriteAheadLog<K, V>::replay_batch(const uint8_t* payload, const uint32_t payload_size, SetFunc& on_set,
+                                           RemoveFunc& on_remove) {
+        constexpr uint32_t op_header_size = sizeof(Op) + sizeof(K) + sizeof(int32_t);
+        for (uint32_t pos = sizeof(Op); pos + op_header_size <= payload_size;) {
+            K key;
+            int32_t size;
+            std::memcpy(&key, payload + pos + sizeof(Op), sizeof(key));
+            std::memcpy(&size, payload + pos + sizeof(Op) + sizeof(key), sizeof(size));
+            const uint8_t* data = payload + pos + op_header_size;
+            if (payload[pos] == SET)
+                on_set(key, data, size);
+            else
+                on_remove(key);
+            pos += op_header_size + size;
+        }
+    }
+
+    template <typename K, typename V>
+    template <typename Func>
+    int64_t WriteAheadLog<K, V>::read_records(std::FILE* log, const int64_t log_size, Func&& on_payload) {
+        int64_t valid_size = 0;
+        std::vector<uint8_t> payload;
+        uint32_t header[2];
+        while (std::fread(header, 1, record_header_size_in_bytes, log) == record_header_size_in_bytes) {
+            auto [payload_size, crc] = std::make_pair(header[0], header[1]);
+            // The shortest record is a remove of a key or a checkpoint
+            if (payload_size < sizeof(Op) + std::min(sizeof(K), sizeof(int64_t)) || payload_size > log_size)
+                break;
+
+            payload.resize(payload_size);
+            if (std::fread(payload.data(), 1, payload_size, log) != payload_size || file::crc32(payload.data(), payload_size) != crc)
+                break;
+            on_payload(payload.data(), payload_size);
+            valid_size += record_header_size_in_bytes + payload_size;
+        }
+        return valid_size;
+    }
+
+    template <typename K, typename V>
+    void WriteAheadLog<K, V>::truncate(const int64_t checkpoint_end) {
+        std::unique_lock lock(mutex_);
+        synced.wait(lock, [this]() { return !sync_in_progress; });
+
+        std::fclose(file);
+        open("wb+");
+        size_in_bytes = 0;
+        write_checkpoint(checkpoint_end);
+        synced_lsn = appended_lsn;
+        synced.notify_all();
+    }
+
+    template <typename K, typename V>
+    void WriteAheadLog<K, V>::restart_pages(const int64_t checkpoint_end) {
+        std::scoped_lock lock(mutex_);
+        write_checkpoint(checkpoint_end);
+    }
+
+    template <typename K, typename V>
+    void WriteAheadLog<K, V>::write_checkpoint(const int64_t checkpoint_end) {
+        std::vector<uint8_t> record(record_header_size_in_bytes + sizeof(Op) + sizeof(checkpoint_end));
+        uint8_t* payload = record.data() + record_header_size_in_bytes;
+        payload[0] = CHECKPOINT;
+        std::memcpy(payload + sizeof(Op), &checkpoint_end, sizeof(checkpoint_end));
+        write(record);
+        std::fflush(file);
+        file::sync(file);
+
+        file_end = checkpoint_end;
+        saved_pages.clear();
+    }
+
+    template <typename K, typename V>
+    void WriteAheadLog<K, V>::drop_pages() {
+        std::scoped_lock lock(mutex_);
+        write_checkpoint(NO_CHECKPOINT);
+    }
+
+    template <typename K, typename V>
+    void WriteAheadLog<K, V>::discard() {
+        std::unique_lock lock(mutex_);
+        synced.wait(lock, [this]() { return !sync_in_progress; });
+
+        std::fclose(file);
+        open("wb+");
+        file::sync(file);
+        size_in_bytes = 0;
+        synced_lsn = appended_lsn;
+        file_end = NO_CHECKPOINT;
+        saved_pages.clear();
+        synced.notify_all();
+    }
+
+    template <typename K, typename V>
+    int64_t WriteAheadLog<K, V>::size() const {
+        return size_in_bytes;
+    }
+
+    template <typename K, typename V>
+    WalStats WriteAheadLog<K, V>::get_stats() const {
+        std::scoped_lock lock(mutex_);
+        return stats;
+    }
+}
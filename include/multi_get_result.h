@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "io/read_guard.h"
+
+namespace btree {
+    /**
+     * Result of Volume::multi_get, the i-th element corresponds to the i-th requested key.
+     * VALUES is a contiguous array (for arithmetic V too), V() is set for absent keys.
+     * The blob values point into the volume file, the guard keeps them in place till the result is destroyed.
+     */
+    template <typename V>
+    struct MultiGetResult {
+        std::vector<V> values;
+        std::vector<uint8_t> found;
+        ReadGuard guard;
+
+        explicit MultiGetResult(const size_t n) : values(n), found(n, false) {}
+
+        size_t size() const { return values.size(); }
+        bool has_value(const size_t i) const { return found[i]; }
+        const V& operator[](const size_t i) const { return values[i]; }
+    };
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include <functional>
+#include <vector>
+#include <algorithm>
+
+#include "io/io_manager.h"
+#include "btree_impl/btree.h"
+#include "bplus_tree_impl/bplus_tree.h"
+#include "hash_impl/extendible_hash.h"
+#include "utils/error.h"
+
+namespace btree::snapshot {
+    /**
+     * Read-only point-in-time view of a volume: it's pinned to the root of the moment it was taken and reads the nodes
+     * rewritten since then from their copies (see VersionStore). The hash directory is read when the snapshot is taken.
+     *  - the queries don't take the volume lock: long reads don't block the writers and see no modifications
+     *  - the snapshot must be destroyed before the volume is closed
+     */
+    template <typename K, typename V>
+    class Snapshot final {
+        using IOManagerT = IOManager<K, V>;
+        using EntryT = typename BTree<K, V>::EntryT;
+
+        const IOManagerT* io;
+        EngineType engine;
+        uint8_t format_version;
+        int64_t root_pos;
+        uint64_t epoch;
+        std::string path;
+        std::function<void(uint64_t)> release;
+        // The bucket positions and the local depths of the hash directory
+        std::vector<int64_t> directory;
+        std::vector<uint8_t> local_depths;
+        int32_t global_depth = 0;
+    public:
+        Snapshot(const IOManagerT& io, const uint8_t format_version, const int64_t root_pos, const uint64_t epoch,
+                 const std::string& path, std::function<void(uint64_t)>&& release) :
+            io(&io), engine(io.get_engine()), format_version(format_version), root_pos(root_pos), epoch(epoch),
+            path(path), release(std::move(release))
+        {
+            if (engine == HASH)
+                read_directory();
+        }
+
+        Snapshot(Snapshot&& other) noexcept :
+            io(other.io), engine(other.engine), format_version(other.format_version), root_pos(other.root_pos),
+            epoch(other.epoch), path(std::move(other.path)), release(std::move(other.release)),
+            directory(std::move(other.directory)), local_depths(std::move(other.local_depths)),
+            global_depth(other.global_depth)
+        {
+            other.release = nullptr;
+        }
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+
+        ~Snapshot() {
+            if (release)
+                release(epoch);
+        }
+
+        bool exist(const K key) const {
+            return find(key).has_value();
+        }
+
+        std::optional<V> get(const K key) const {
+            auto entry = find(key);
+            return entry ? entry->value() : std::nullopt;
+        }
+
+        /** Calls FN(key, value) for each key in [LO, HI) in ascending order, returns the number of visited keys */
+        template <typename Func>
+        int64_t scan(const K lo, const K hi, Func&& fn) const {
+            int64_t count = 0;
+            if (root_pos == IOManagerT::INVALID_POS)
+                return count;
+            if (engine == HASH)
+                scan_buckets(lo, hi, fn, count);
+            else if (is_bplus_tree(engine))
+                scan_leaves(lo, hi, fn, count);
+            else
+                scan_subtree(root_pos, lo, hi, fn, count);
+            return count;
+        }
+
+    private:
+        std::optional<EntryT> find(const K key) const {
+            if (engine == HASH) {
+                if (directory.empty())
+                    return std::nullopt;
+                auto bucket = read_bplus_node(directory[ExtendibleHash<K, V>::slot_of(key, global_depth)]);
+                auto idx = bucket.find_key_pos(key);
+                if (idx < bucket.used_keys && bucket.keys[idx] == key)
+                    return read_entry(key, bucket.entry_pos[idx]);
+                return std::nullopt;
+            }
+
+            for (auto pos = root_pos; pos != IOManagerT::INVALID_POS;) {
+                if (is_bplus_tree(engine)) {
+                    auto node = read_bplus_node(pos);
+                    if (node.is_leaf) {
+                        auto idx = node.find_key_pos(key);
+                        if (idx < node.used_keys && node.keys[idx] == key)
+                            return read_entry(key, node.entry_pos[idx]);
+                        return std::nullopt;
+                    }
+                    pos = node.child_pos[node.find_child_idx(key)];
+                } else {
+                    auto node = read_node(pos);
+                    auto begin = node.keys.begin();
+                    auto end = begin + node.used_keys;
+                    auto lower = std::lower_bound(begin, end, key);
+                    auto idx = std::distance(begin, lower);
+                    if (lower != end && *lower == key)
+                        return read_entry(key, node.key_pos[idx]);
+                    if (node.is_leaf)
+                        return std::nullopt;
+                    pos = node.child_pos[idx];
+                }
+            }
+            return std::nullopt;
+        }
+
+        /** Returns false when a key >= HI is reached */
+        template <typename Func>
+        bool scan_subtree(const int64_t pos, const K lo, const K hi, Func& fn, int64_t& count) const {
+            auto node = read_node(pos);
+            for (int32_t i = 0; i < node.used_keys; ++i) {
+                if (!node.is_leaf && lo < node.keys[i] && !scan_subtree(node.child_pos[i], lo, hi, fn, count))
+                    return false;
+                if (node.keys[i] >= hi)
+                    return false;
+                if (node.keys[i] >= lo) {
+                    fn(node.keys[i], read_entry(node.keys[i], node.key_pos[i]).value().value_or(V()));
+                    ++count;
+                }
+            }
+            return node.is_leaf || scan_subtree(node.child_pos[node.used_keys], lo, hi, fn, count);
+        }
+
+        template <typename Func>
+        void scan_leaves(const K lo, const K hi, Func& fn, int64_t& count) const {
+            auto node = read_bplus_node(root_pos);
+            while (!node.is_leaf)
+                node = read_bplus_node(node.child_pos[node.find_child_idx(lo)]);
+
+            for (auto idx = node.find_key_pos(lo);; idx = 0) {
+                for (; idx < node.used_keys; ++idx) {
+                    if (node.keys[idx] >= hi)
+                        return;
+                    fn(node.keys[idx], read_entry(node.keys[idx], node.entry_pos[idx]).value().value_or(V()));
+                    ++count;
+                }
+                if (node.next_leaf_pos == IOManagerT::INVALID_POS)
+                    return;
+                node = read_bplus_node(node.next_leaf_pos);
+            }
+        }
+
+        /** The keys of the buckets aren't ordered: the ones in [LO, HI) are sorted first */
+        template <typename Func>
+        void scan_buckets(const K lo, const K hi, Func& fn, int64_t& count) const {
+            std::vector<std::pair<K, int64_t>> keys;
+            for (size_t i = 0; i < directory.size(); ++i) {
+                // The first slot of the bucket
+                if (i >= (size_t(1) << local_depths[i]))
+                    continue;
+                auto bucket = read_bplus_node(directory[i]);
+                for (auto idx = bucket.find_key_pos(lo); idx < bucket.used_keys && bucket.keys[idx] < hi; ++idx)
+                    keys.emplace_back(bucket.keys[idx], bucket.entry_pos[idx]);
+            }
+            std::sort(keys.begin(), keys.end());
+            for (const auto& [key, entry_pos]: keys) {
+                fn(key, read_entry(key, entry_pos).value().value_or(V()));
+                ++count;
+            }
+        }
+
+        /** The directory pages are linked from the root position (see IOManager) */
+        void read_directory() {
+            for (auto pos = root_pos; pos != IOManagerT::INVALID_POS;) {
+                auto page = read_bplus_node(pos);
+                for (auto i = 0; i < page.used_keys; ++i) {
+                    directory.push_back(page.entry_pos[i]);
+                    local_depths.push_back(static_cast<uint8_t>(page.keys[i]));
+                }
+                pos = page.next_leaf_pos;
+            }
+            while ((size_t(1) << global_depth) < directory.size())
+                ++global_depth;
+        }
+
+        BTreeNode<K, V> read_node(const int64_t pos) const {
+            auto node = io->read_snapshot_node(pos, format_version, epoch);
+            utils::validate(node.has_value(), error_msg::snapshot_read_msg, path);
+            return std::move(*node);
+        }
+
+        BPlusTreeNode<K, V> read_bplus_node(const int64_t pos) const {
+            auto node = io->read_snapshot_bplus_node(pos, epoch);
+            utils::validate(node.has_value(), error_msg::snapshot_read_msg, path);
+            return std::move(*node);
+        }
+
+        /** The entries aren't rewritten in place and the freed ones aren't reused while the snapshot is alive */
+        EntryT read_entry(const K key, const int64_t pos) const {
+            auto entry = io->try_read_entry(key, pos, format_version);
+            utils::validate(entry.has_value(), error_msg::snapshot_read_msg, path);
+            return *entry;
+        }
+    };
+}
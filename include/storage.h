@@ -28,7 +28,14 @@ namespace btree::storage {
             storage_map.erase(this);
         }
 
-        VolumeT open_volume(const std::string& path, const int16_t user_t) {
+        /**
+         * LOCKING is used only by the multithreaded storage, COMPRESSION only by the (w)string volumes. USE_FILTER keeps
+         * a filter of the keys which rejects most of the lookups of the absent keys without reading the tree
+         */
+        VolumeT open_volume(const std::string& path, const int16_t user_t, const EngineType engine = BTREE,
+                            const bool use_wal = false, const LockingMode locking = COARSE_LOCK,
+                            const MappingOptions& mapping = MappingOptions(),
+                            const Compression compression = NO_COMPRESSION, const bool use_filter = false) {
             for (const auto& storage: storage_map) {
                 auto& curr_volume_map = storage->volume_map;
                 auto it = curr_volume_map.find(path);
@@ -40,7 +47,12 @@ namespace btree::storage {
                     }
                 }
             }
-            auto[pos, success] = volume_map.emplace(path, std::make_unique<VolumeType>(path, user_t));
+            std::unique_ptr<VolumeType> volume;
+            if constexpr (SupportMultithreading)
+                volume = std::make_unique<VolumeType>(path, user_t, engine, use_wal, locking, mapping, compression, use_filter);
+            else
+                volume = std::make_unique<VolumeType>(path, user_t, engine, use_wal, mapping, compression, use_filter);
+            auto[pos, success] = volume_map.emplace(path, std::move(volume));
             return VolumeT(pos->second.get());
         }
 
@@ -63,9 +75,53 @@ namespace btree::storage {
 
             std::optional<V> get(const K key) const { return ptr->get(key); }
 
+            /** Only for the multithreaded storage: the operations of the volume are run on the library executor in order */
+            std::future<std::optional<V>> async_get(const K key) const { return ptr->async_get(key); }
+
+            std::future<void> async_set(const K key, const ValueType value) { return ptr->async_set(key, value); }
+
+            std::future<void> async_set(const K key, const V& value, const int32_t size) {
+                return ptr->async_set(key, value, size);
+            }
+
+            std::future<bool> async_remove(const K key) { return ptr->async_remove(key); }
+
+            ValueView<V> get_view(const K key) const { return ptr->get_view(key); }
+
             bool remove(const K key) { return ptr->remove(key); }
 
+            void write(const WriteBatch<K, V>& batch) { ptr->write(batch); }
+
             std::string path() const { return ptr->path; }
+
+            EngineType engine() const { return ptr->engine(); }
+            FilterStats filter_stats() const { return ptr->filter_stats(); }
+
+            void checkpoint() { ptr->checkpoint(); }
+
+            WalStats wal_stats() const { return ptr->wal_stats(); }
+
+            int64_t compact(const int64_t max_bytes_per_second = 0) { return ptr->compact(max_bytes_per_second); }
+
+            /** Only for the multithreaded storage */
+            std::future<int64_t> compact_async(const int64_t max_bytes_per_second = 0) {
+                return ptr->compact_async(max_bytes_per_second);
+            }
+
+            typename VolumeType::CursorT cursor() const { return ptr->cursor(); }
+
+            snapshot::Snapshot<K, V> snapshot() const { return ptr->snapshot(); }
+
+            template <typename Func>
+            int64_t scan(const K lo, const K hi, Func&& fn) const { return ptr->scan(lo, hi, std::forward<Func>(fn)); }
+
+            MultiGetResult<V> multi_get(const std::vector<K>& keys) const { return ptr->multi_get(keys); }
+
+            std::vector<bool> multi_exist(const std::vector<K>& keys) const { return ptr->multi_exist(keys); }
+
+            void advise(const AccessPattern pattern) { ptr->advise(pattern); }
+
+            void prefetch(const std::vector<K>& keys) const { ptr->prefetch(keys); }
         };
     };
 }
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace btree {
+    /** Expected access to the volume file, it's passed to the kernel as a hint for the mapping (see Volume::advise) */
+    enum AccessPattern: uint8_t {
+        NORMAL = 0,        // the default readahead
+        RANDOM = 1,        // point lookups: no readahead of the neighbouring pages
+        SEQUENTIAL = 2,    // scans: aggressive readahead, the pages behind may be dropped early
+        WILLNEED = 3       // the whole file is read ahead once, the previous pattern stays
+    };
+}
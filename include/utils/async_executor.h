@@ -0,0 +1,51 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
+
+#include <boost/asio/strand.hpp>
+
+#include "utils/boost_include.h"
+
+namespace btree {
+    /** Threads of the asynchronous volume operations, shared by all the volumes: the pool is created on first use */
+    inline basio::thread_pool& async_executor() {
+        static basio::thread_pool pool(std::max(2u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+
+    /**
+     * Queue of the asynchronous operations of one volume on the shared executor: the operations are run one at a time
+     * in the order they're posted, the operations of the different queues run in parallel. The destructor waits
+     * for the posted operations, so the queue mustn't be destroyed by one of them.
+     */
+    class AsyncQueue final {
+        using Strand = basio::strand<basio::thread_pool::executor_type>;
+
+        std::once_flag strand_flag;
+        std::unique_ptr<Strand> strand;
+    public:
+        AsyncQueue() = default;
+        AsyncQueue(const AsyncQueue&) = delete;
+        AsyncQueue& operator=(const AsyncQueue&) = delete;
+
+        ~AsyncQueue() {
+            if (strand)
+                post([]() {}).wait();
+        }
+
+        /** The future gets the result of OP or its exception */
+        template <typename Func>
+        std::future<std::invoke_result_t<Func>> post(Func&& op) {
+            std::call_once(strand_flag, [this]() { strand = std::make_unique<Strand>(basio::make_strand(async_executor())); });
+            auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Func>()>>(std::forward<Func>(op));
+            auto future = task->get_future();
+            basio::post(*strand, [task]() { (*task)(); });
+            return future;
+        }
+    };
+}
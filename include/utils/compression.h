@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace btree {
+    /** Codec of the (w)string values of a volume, it's recorded in the volume header */
+    enum Compression: uint8_t {
+        NO_COMPRESSION = 0,    // the values are stored as is
+        ZLIB_COMPRESSION = 1,  // deflate by Boost.Iostreams: the smallest values, the slowest writes
+        LZ_COMPRESSION = 2     // byte-oriented LZ77 (see ValueCodec): faster, but the values are larger
+    };
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace btree {
+    /** Index engine of a volume, it's recorded in the volume header */
+    enum EngineType: uint8_t {
+        BTREE = 0,             // classic B-tree: entries are referenced from every level
+        BPLUS_TREE = 1,        // B+ tree: separator-only inner nodes, entries are referenced from sibling-linked leaves
+        PACKED_BPLUS_TREE = 2, // B+ tree with the keys of a node stored as a base key and narrow deltas: more keys fit
+        HASH = 3               // extendible hashing: a lookup reads one bucket, the keys are ordered only by the cursor
+    };
+
+    /** Both B+ tree engines share the algorithms, they differ by the node layout */
+    constexpr bool is_bplus_tree(const EngineType engine) {
+        return engine == BPLUS_TREE || engine == PACKED_BPLUS_TREE;
+    }
+}
@@ -14,4 +14,45 @@ namespace btree::error_msg {
 
     constexpr std::string_view wrong_element_size_msg =
             "The ELEMENT_SIZE for your tree doesn't equal to the ELEMENT_SIZE used in storage: ";
-}
\ No newline at end of file
+
+    constexpr std::string_view wrong_format_version_msg =
+            "The FORMAT_VERSION of storage isn't supported by your tree: ";
+
+    constexpr std::string_view wrong_engine_msg =
+            "The ENGINE for your tree doesn't equal to the ENGINE used in storage: ";
+
+    constexpr std::string_view wrong_node_msg =
+            "The node of storage is corrupted, its packed keys don't fit the node: ";
+
+    constexpr std::string_view wrong_directory_msg =
+            "The hash directory of storage is corrupted, its size isn't a power of two: ";
+
+    constexpr std::string_view wrong_compression_msg =
+            "The COMPRESSION for your tree doesn't equal to the COMPRESSION used in storage: ";
+
+    constexpr std::string_view compressed_values_msg =
+            "Only the (w)string values are compressed, the other ones are stored as is: ";
+
+    constexpr std::string_view corrupted_value_msg =
+            "The compressed value of storage is corrupted, it can't be decompressed: ";
+
+    constexpr std::string_view volume_exists_msg =
+            "The bulk loader builds a new volume, but the file already exists: ";
+
+    constexpr std::string_view bulk_loader_finished_msg =
+            "The bulk loader has already built the volume: ";
+
+    constexpr std::string_view compaction_in_progress_msg =
+            "The volume is already being compacted: ";
+
+    constexpr std::string_view snapshot_read_msg =
+            "The snapshot can't read the node or entry, it has outlived the volume: ";
+
+    constexpr std::string_view windowed_mapping_msg =
+            "The lock-free readers and the snapshots need the whole file mapped, the volume is mapped by windows "
+            "or read by the buffer pool: ";
+
+    constexpr std::string_view transient_blob_msg =
+            "The blob of async_get would be overwritten by the next get of the executor, the volume is mapped by windows "
+            "or read by the buffer pool: ";
+}
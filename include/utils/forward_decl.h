@@ -1,6 +1,8 @@
 #pragma once
 
 namespace btree {
+    class VersionLatches;
+
     template <typename K, typename V>
     class IOManager;
 
@@ -9,4 +11,16 @@ namespace btree {
 
     template <typename K, typename V>
     struct BTreeNode;
+
+    template <typename K, typename V>
+    struct BPlusTree;
+
+    template <typename K, typename V>
+    struct BPlusTreeNode;
+
+    template <typename K, typename V>
+    struct ExtendibleHash;
+
+    template <typename K, typename V>
+    class WriteBatch;
 }
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace btree {
+    /** Synchronization of the multithreaded volume */
+    enum LockingMode: uint8_t {
+        COARSE_LOCK = 0,                // every query takes the volume mutex
+        OPTIMISTIC_LOCK_COUPLING = 1    // exist/get read the nodes without locks validating their version latches,
+                                        // the writers are serialized by the volume mutex
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+namespace btree {
+    /** Mapping of the volume file to memory and its growth when a write doesn't fit into it (see MappedFile) */
+    struct MappingOptions {
+        /** The file grows by EXTENT_SIZE bytes if it's set, otherwise its size is multiplied by FACTOR */
+        double factor = 1.1;
+        int64_t extent_size = 0;
+        /**
+         * The file is mapped at the beginning of a reserved range of RESERVED_SIZE bytes of the address space and grows
+         * in place: the new tail is mapped after the mapped part, the base address doesn't move and the file isn't
+         * remapped. A file larger than the range is moved to a new range twice as large. Only on POSIX systems.
+         */
+        bool reserve_address_range = false;
+        int64_t reserved_size = int64_t(64) << 30;
+        /**
+         * The file is mapped by windows of WINDOW_SIZE bytes on demand instead of as a whole, the least recently used
+         * windows are unmapped when more than MAX_MAPPED_BYTES are mapped: for the files larger than the address space.
+         * The lock-free readers and the snapshots need the whole mapping, they aren't supported with windows.
+         */
+        int64_t window_size = 0;
+        int64_t max_mapped_bytes = 0;
+        /**
+         * The file isn't mapped, it's read and written by pread/pwrite through a pool of BUFFER_POOL_SIZE bytes split
+         * into frames of FRAME_SIZE bytes, the frames are evicted by CLOCK (see BufferPool). With DIRECT_IO the page
+         * cache is bypassed where the file system supports it. Like the windows, it doesn't support the lock-free
+         * readers and the snapshots. Only on POSIX systems, elsewhere the file is mapped.
+         */
+        int64_t buffer_pool_size = 0;
+        int64_t frame_size = int64_t(64) << 10;
+        bool direct_io = false;
+        /**
+         * The buffer pool reads the frames of the nodes and the entries of a tree level of the batched lookups by io_uring
+         * with up to IO_URING_DEPTH reads in flight, the lookups read them from the pool. Where io_uring isn't available
+         * (not Linux, an old kernel, a seccomp filter) or after a failed read the frames are read on demand. The mapped
+         * file ignores it: the kernel reads the pages of the mapping.
+         */
+        int32_t io_uring_depth = 0;
+
+        /** Doubling in place, the default for large volumes */
+        static MappingOptions reserved(const int64_t extent_size = 0) {
+            MappingOptions mapping;
+            mapping.factor = 2.0;
+            mapping.extent_size = extent_size;
+            mapping.reserve_address_range = true;
+            return mapping;
+        }
+
+        static MappingOptions windowed(const int64_t window_size = int64_t(64) << 20,
+                                       const int64_t max_mapped_bytes = int64_t(1) << 30) {
+            MappingOptions mapping;
+            mapping.window_size = window_size;
+            mapping.max_mapped_bytes = max_mapped_bytes;
+            return mapping;
+        }
+
+        static MappingOptions buffer_pool(const int64_t buffer_pool_size = int64_t(256) << 20,
+                                          const int64_t frame_size = int64_t(64) << 10, const bool direct_io = false) {
+            MappingOptions mapping;
+            mapping.buffer_pool_size = buffer_pool_size;
+            mapping.frame_size = frame_size;
+            mapping.direct_io = direct_io;
+            return mapping;
+        }
+    };
+}
@@ -92,6 +92,15 @@ namespace utils {
         }
     }
 
+    /** The finalizer of splitmix64: every bit of X changes half of the bits, distinct X give distinct results */
+    constexpr uint64_t mix_bits(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
     template <typename PtrT>
     constexpr uint8_t* cast_to_uint8_t_data(PtrT t) {
         return reinterpret_cast<uint8_t*>(t);
@@ -102,7 +111,7 @@ namespace utils {
         return reinterpret_cast<const uint8_t*>(t);
     }
 
-    void validate(bool expression, const std::string_view& err_msg, const std::string& file_path) {
+    inline void validate(bool expression, const std::string_view& err_msg, const std::string& file_path) {
         if (!expression)
             throw std::logic_error(err_msg.data() + file_path);
     }
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+#include "io/read_guard.h"
+#include "utils/utils.h"
+
+namespace btree {
+    /**
+     * Result of Volume::get_view: the value of a (w)string or blob volume read in place from the mapping.
+     * The guard keeps the value in place till the view is destroyed, so it may be used after the volume lock
+     * is released; the view must be destroyed before the volume is closed. A compressed value is decompressed,
+     * the view owns its copy.
+     */
+    template <typename V>
+    class ValueView final {
+        static_assert(utils::is_string_v<V> || std::is_pointer_v<V>);
+        using CharT = typename utils::conditional_t<utils::is_string_v<V>,
+                                                    utils::underlying_type<V>, utils::identity_type<char>>::type;
+
+        const uint8_t* data;
+        int32_t size_in_bytes;
+        ReadGuard guard;
+        std::vector<uint8_t> decompressed;
+    public:
+        ValueView() : data(nullptr), size_in_bytes(0) {}
+
+        ValueView(const uint8_t* data, const int32_t size_in_bytes, ReadGuard&& guard) :
+            data(data), size_in_bytes(size_in_bytes), guard(std::move(guard)) {}
+
+        explicit ValueView(std::vector<uint8_t>&& decompressed) :
+            data(decompressed.data()), size_in_bytes(static_cast<int32_t>(decompressed.size())),
+            decompressed(std::move(decompressed)) {}
+
+        bool has_value() const { return data != nullptr; }
+        explicit operator bool() const { return has_value(); }
+
+        /** The characters of a (w)string value, the bytes of a blob */
+        std::basic_string_view<CharT> value() const {
+            return { reinterpret_cast<const CharT*>(data), size_in_bytes / sizeof(CharT) };
+        }
+
+        const uint8_t* bytes() const { return data; }
+        int32_t size() const { return size_in_bytes; }
+    };
+}
@@ -2,76 +2,962 @@
 
 #include <string>
 #include <mutex>
+#include <atomic>
+#include <variant>
+#include <numeric>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <future>
+#include <filesystem>
 
 #include "io/io_manager.h"
+#include "io/write_ahead_log.h"
+#include "io/version_latches.h"
+#include "io/reader_epochs.h"
+#include "io/cuckoo_filter.h"
+#include "utils/locking_mode.h"
+#include "utils/access_pattern.h"
+#include "utils/async_executor.h"
 #include "btree_impl/btree.h"
+#include "bplus_tree_impl/bplus_tree.h"
+#include "hash_impl/extendible_hash.h"
+#include "cursor.h"
+#include "snapshot.h"
+#include "bulk_load/bulk_loader.h"
+#include "multi_get_result.h"
+#include "write_batch.h"
+#include "value_view.h"
 
 namespace btree::volume {
     template <typename K, typename V>
     class Volume final {
-        IOManager <K, V> io;
-        BTree <K, V> btree;
+        using TreeType = std::variant<BTree<K, V>, BPlusTree<K, V>, ExtendibleHash<K, V>>;
+
+        // Opened before the file: the file is restored from it first, it saves the pages of the file till it's closed
+        std::unique_ptr<WriteAheadLog<K, V>> wal;
+        // The volume file as it was closed: the filter saved then is loaded only if the file hasn't changed since
+        const uint64_t closed_file_tag;
+        // Optimistic readers of VolumeMT: the replaced mappings and files are freed when they leave them. It's destroyed
+        // after the file: the file retires its mappings to it till it's closed
+        std::unique_ptr<ReaderEpochs> reader_epochs;
+        std::unique_ptr<IOManager<K, V>> io;
+        TreeType tree;
+        const int16_t order;
+        const MappingOptions mapping;
+        const Compression compression;
     public:
         using ValueType = typename BTree<K,V>::ValueType;
+        using CursorT = cursor::Cursor<K, V>;
+        using SnapshotT = snapshot::Snapshot<K, V>;
         const std::string path;
 
-        explicit Volume(const std::string& path, const int16_t order) : io(path, order), btree(order, io), path(path) {}
+        /**
+         * USE_WAL: log the modifications to "<path>.wal", replay the log left by a crash.
+         *          The log left by a crash is replayed without USE_WAL too, then it's removed
+         * GROWTH: how the volume file grows (see MappingOptions)
+         * COMPRESSION: the codec of the (w)string values, it's recorded in the header (see Compression)
+         * USE_FILTER: the misses of the lookups are answered by a cuckoo filter of the keys without the tree,
+         *             it's saved to "<path>.filter" on close and built from the keys when it can't be loaded
+         */
+        explicit Volume(const std::string& path, const int16_t order, const EngineType engine = BTREE,
+                        const bool use_wal = false, const MappingOptions& mapping = MappingOptions(),
+                        const Compression compression = NO_COMPRESSION, const bool use_filter = false) :
+            wal(open_wal(path, use_wal)), closed_file_tag(use_filter ? file_tag(path) : 0),
+            io(std::make_unique<IOManager<K, V>>(path, order, engine, mapping, compression)),
+            tree(make_tree(order, *io, engine)), order(order), mapping(mapping), compression(compression), path(path)
+        {
+            open_filter(use_filter);
+            if (wal)
+                recover(use_wal);
+        }
+
+        ~Volume() {
+            if (filter) {
+                // The file is closed first: the free space map is written, so the tag of the file is final
+                io.reset();
+                filter->save(path + FILTER_SUFFIX, file_tag(path));
+            }
+        }
 
         bool exist(const K key) {
-            return btree.exist(io, key);
+            if (is_filtered_out(key))
+                return false;
+            return record_if_missed(std::visit([&](auto& t) { return t.exist(*io, key); }, tree));
         }
 
         void set(const K key, const ValueType value) {
-            btree.set(io, key, value);
+            wait_durable(set_and_log(key, value));
         }
 
         void set(const K key, const V& value, const int32_t size) {
-            btree.set(io, key, value, size);
+            wait_durable(set_and_log(key, value, size));
         }
 
+        /**
+         * A blob is read in place, or copied to a buffer of the thread if the addresses are transient (see
+         * IOManager::has_transient_addresses): then it's valid till the next GET() of the thread, GET_VIEW() keeps it
+         */
         std::optional <V> get(const K key) {
-            return btree.get(io, key);
+            if (is_filtered_out(key))
+                return std::nullopt;
+            if constexpr (std::is_pointer_v<V>) {
+                if (io->has_transient_addresses()) {
+                    auto entry = std::visit([&](auto& t) { return t.find(*io, key); }, tree);
+                    if (!record_if_missed(entry.is_valid()))
+                        return std::nullopt;
+                    thread_local std::vector<uint8_t> blob_buffer;
+                    blob_buffer.assign(entry.data, entry.data + entry.size_in_bytes);
+                    return reinterpret_cast<V>(blob_buffer.data());
+                }
+            }
+            auto value = std::visit([&](auto& t) { return t.get(*io, key); }, tree);
+            record_if_missed(value.has_value());
+            return value;
+        }
+
+        /** Zero-copy get for (w)string and blob values: the view reads the value in the mapping (see ValueView) */
+        ValueView<V> get_view(const K key) {
+            if (is_filtered_out(key))
+                return ValueView<V>();
+            auto entry = std::visit([&](auto& t) { return t.find(*io, key); }, tree);
+            if (!record_if_missed(entry.is_valid()))
+                return ValueView<V>();
+            // A decompressed value isn't in the mapping, the view keeps a copy of it
+            if (io->is_decompressed(entry))
+                return ValueView<V>(std::vector<uint8_t>(entry.data, entry.data + entry.size_in_bytes));
+            return ValueView<V>(entry.data, entry.size_in_bytes, io->pin_values());
         }
 
         bool remove(const K key) {
-            return btree.remove(io, key);
+            auto [removed, lsn] = remove_and_log(key);
+            wait_durable(lsn);
+            return removed;
+        }
+
+        /**
+         * Applies the operations of BATCH in the key order. Every operation descends the tree on its own, the node writes
+         * are deferred: a node modified by several of them is written once (unless the nodes of the batch take more than
+         * IOManager::MAX_DEFERRED_BYTES, then they're written in parts). If an operation fails, the volume is restored
+         * as it was before the batch and the error is rethrown. The batch is logged as one record: it's recovered whole
+         * or not at all.
+         */
+        void write(const WriteBatch<K, V>& batch) {
+            wait_durable(write_deferred_and_log(batch));
+        }
+
+        /** Flushes the volume file and truncates the write-ahead log */
+        void checkpoint() {
+            io->flush();
+            if (wal)
+                wal->truncate(io->get_file_pos_end());
+        }
+
+        EngineType engine() const {
+            return io->get_engine();
+        }
+
+        /** The counters of the write-ahead log, they're empty if the volume is opened without it */
+        WalStats wal_stats() const {
+            return wal ? wal->get_stats() : WalStats();
+        }
+
+        /** The counters of the filter, they're empty if the volume is opened without it */
+        FilterStats filter_stats() const {
+            return filter ? filter->stats() : FilterStats();
+        }
+
+        CursorT cursor() {
+            return std::visit([&](auto& t) { return CursorT(t.cursor(*io)); }, tree);
+        }
+
+        template <typename Func>
+        int64_t scan(const K lo, const K hi, Func&& fn) {
+            return cursor().scan(lo, hi, std::forward<Func>(fn));
+        }
+
+        MultiGetResult<V> multi_get(const std::vector<K>& keys) {
+            MultiGetResult<V> result(keys.size());
+            if constexpr (std::is_pointer_v<V>)
+                result.guard = io->pin_values();
+            find_batch(keys, [&](const size_t i, const int64_t entry_pos) {
+                auto value = io->read_entry(keys[i], entry_pos).value();
+                result.found[i] = value.has_value();
+                if (value)
+                    result.values[i] = std::move(*value);
+            });
+            return result;
+        }
+
+        std::vector<bool> multi_exist(const std::vector<K>& keys) {
+            std::vector<bool> result(keys.size(), false);
+            find_batch(keys, [&](const size_t i, const int64_t) { result[i] = true; });
+            return result;
+        }
+
+        /** Hint for the kernel how the volume file is going to be read: RANDOM for point lookups, SEQUENTIAL for scans */
+        void advise(const AccessPattern pattern) {
+            io->advise(pattern);
+            if (pattern != WILLNEED)
+                access_pattern = pattern;
+        }
+
+        /**
+         * Warms the nodes and the entries of KEYS for an upcoming batch, the pages are read in the background
+         * or, with the io_uring reads of the buffer pool, they're in the pool when it returns
+         */
+        void prefetch(const std::vector<K>& keys) {
+            std::vector<K> sorted_keys(keys);
+            std::sort(sorted_keys.begin(), sorted_keys.end());
+            sorted_keys.erase(std::unique(sorted_keys.begin(), sorted_keys.end()), sorted_keys.end());
+            std::visit([&](auto& t) { t.prefetch(*io, sorted_keys.data(), sorted_keys.size()); }, tree);
+        }
+
+        /** Read-only point-in-time view of the volume, it must be destroyed before the volume is closed */
+        SnapshotT snapshot() {
+            return make_snapshot([io = io.get()](const uint64_t epoch) { io->release_snapshot(epoch); });
+        }
+
+        /**
+         * Rewrites the volume into a dense file with packed nodes and swaps it in, the cursors opened before are invalidated.
+         * MAX_BYTES_PER_SECOND limits the copying rate (0 - no limit). Returns the number of reclaimed bytes.
+         * It's synchronous: the volume isn't thread-safe, VolumeMT::compact_async() runs it on a background thread.
+         */
+        int64_t compact(const int64_t max_bytes_per_second = 0) {
+            // The chunks aren't locked: nothing modifies the volume while it's compacted
+            return compact(max_bytes_per_second, []() { return std::unique_lock<std::mutex>(); });
+        }
+
+    private:
+        template <typename, typename>
+        friend class VolumeMT;
+
+        static constexpr int64_t WAL_CHECKPOINT_SIZE = 64 * 1024 * 1024;
+        static constexpr uint64_t NO_LSN = 0;
+        static constexpr int32_t COMPACTION_CHUNK_SIZE = 1024;
+        static constexpr const char* FILTER_SUFFIX = ".filter";
+
+        std::unique_ptr<CuckooFilter<K>> filter;
+        // Optimistic readers of VolumeMT: the file they read and the latches they validate
+        std::unique_ptr<VersionLatches> latches;
+        std::atomic<IOManager<K, V>*> shared_io = nullptr;
+        // The files replaced by the compaction are kept while the snapshots or the value views can read them, then they're
+        // retired to the reader epochs
+        std::vector<std::unique_ptr<IOManager<K, V>>> retired_io;
+        bool compacting = false;
+        // Applied to the file swapped in by the compaction
+        AccessPattern access_pattern = NORMAL;
+        // Keys modified while the compaction copies the volume, they're reapplied to the new file before the swap
+        std::vector<K> compaction_dirty_keys;
+
+        /**
+         * The operation is applied first and logged after it, it's acknowledged only when the record is synced.
+         * Return the LSN to wait for.
+         */
+        uint64_t set_and_log(const K key, const ValueType value) {
+            mark_dirty(key);
+            set_filtered(key, [&](auto& t) { t.set(*io, key, value); });
+            end_write();
+            return wal ? log(wal->append_set(typename BTree<K, V>::EntryT{ key, value })) : NO_LSN;
+        }
+
+        uint64_t set_and_log(const K key, const V& value, const int32_t size) {
+            mark_dirty(key);
+            if (size != 0)
+                set_filtered(key, [&](auto& t) { t.set(*io, key, value, size); });
+            end_write();
+            bool is_logged = wal && (size != 0);
+            return is_logged ? log(wal->append_set(typename BTree<K, V>::EntryT{ key, value, size })) : NO_LSN;
+        }
+
+        std::pair<bool, uint64_t> remove_and_log(const K key) {
+            mark_dirty(key);
+            bool removed = remove_filtered(key);
+            end_write();
+            return { removed, (wal && removed) ? log(wal->append_remove(key)) : NO_LSN };
+        }
+
+        uint64_t write_deferred_and_log(const WriteBatch<K, V>& batch) {
+            if (batch.empty())
+                return NO_LSN;
+            auto on_set = [&](const K key, const uint8_t* data, const int32_t size) {
+                mark_dirty(key);
+                set_filtered(key, [&](auto& t) { set_raw(t, *io, key, data, size); });
+            };
+            // The removed keys are put back to the filter if the batch is rolled back
+            std::vector<K> removed_keys;
+            auto on_remove = [&](const K key) {
+                mark_dirty(key);
+                if (remove_filtered(key) && filter)
+                    removed_keys.push_back(key);
+            };
+
+            io->begin_batch();
+            try {
+                batch.for_each(on_set, on_remove);
+            } catch (...) {
+                io->rollback_batch();
+                reload_tree();
+                auto insert = [&](const K key) { return filter->insert(key); };
+                if (filter && !std::all_of(removed_keys.begin(), removed_keys.end(), insert))
+                    build_filter();
+                end_write();
+                throw;
+            }
+            io->commit_batch();
+            end_write();
+            return wal ? log(wal->append_batch(batch)) : NO_LSN;
+        }
+
+        /** The latches of the operation are released, then what the readers have left is freed */
+        void end_write() {
+            io->release_latches();
+            release_retired();
+        }
+
+        /** A replaced file is closed once its snapshots and value views are released and the optimistic readers leave it */
+        void release_retired() {
+            for (auto& retired_file: retired_io) {
+                if (!retired_file->has_snapshots() && !retired_file->has_pinned_values())
+                    retire(std::move(retired_file));
+            }
+            retired_io.erase(std::remove(retired_io.begin(), retired_io.end(), nullptr), retired_io.end());
+            if (reader_epochs)
+                reader_epochs->reclaim();
+        }
+
+        void retire(std::unique_ptr<IOManager<K, V>> replaced_io) {
+            if (reader_epochs)
+                reader_epochs->retire(std::shared_ptr<IOManager<K, V>>(std::move(replaced_io)));
+        }
+
+        uint64_t log(const uint64_t lsn) {
+            if (wal->size() >= WAL_CHECKPOINT_SIZE)
+                checkpoint();
+            return lsn;
+        }
+
+        void wait_durable(const uint64_t lsn) {
+            if (lsn != NO_LSN)
+                wal->sync(lsn);
+        }
+
+        /** The file is restored to the last checkpoint before it's opened, then the records are replayed on it */
+        static std::unique_ptr<WriteAheadLog<K, V>> open_wal(const std::string& path, const bool use_wal) {
+            std::error_code error_code;
+            auto log_size = std::filesystem::file_size(WriteAheadLog<K, V>::path_of(path), error_code);
+            if (!use_wal && (error_code || log_size == 0))
+                return nullptr;
+            WriteAheadLog<K, V>::restore(path);
+            return std::make_unique<WriteAheadLog<K, V>>(path);
+        }
+
+        void recover(const bool use_wal) {
+            io->enable_wal(wal.get());
+            // The replay modifies the restored file: its pages are saved, so an interrupted replay is restored too
+            io->flush();
+            wal->restart_pages(io->get_file_pos_end());
+            replay_wal();
+            if (use_wal)
+                return;
+
+            // The records are applied: the volume goes on without the log
+            checkpoint();
+            wal->discard();
+            io->enable_wal(nullptr);
+            auto log_path = wal->path;
+            wal.reset();
+            std::filesystem::remove(log_path);
+        }
+
+        void enable_optimistic_reads() {
+            latches = std::make_unique<VersionLatches>();
+            reader_epochs = std::make_unique<ReaderEpochs>();
+            io->enable_latches(latches.get(), reader_epochs.get());
+            shared_io.store(io.get(), std::memory_order_release);
+        }
+
+        /**
+         * Lock-free lookup, see BTree::find_optimistic. The caller must retry it if it returns false.
+         * The file and its mapping aren't freed till it returns (see ReaderEpochs)
+         */
+        template <typename Func>
+        bool find_optimistic(const K key, Func&& on_entry) const {
+            auto guard = reader_epochs->enter();
+            auto& reader_io = *shared_io.load(std::memory_order_acquire);
+            if (is_bplus_tree(reader_io.get_engine()))
+                return BPlusTree<K, V>::find_optimistic(reader_io, *latches, key, on_entry);
+            return BTree<K, V>::find_optimistic(reader_io, *latches, key, on_entry);
+        }
+
+        template <typename ReleaseFunc>
+        SnapshotT make_snapshot(ReleaseFunc&& release) {
+            auto epoch = io->take_snapshot();
+            auto [root_pos, format_version] = io->read_root_pos_and_format();
+            return SnapshotT(*io, format_version, root_pos, epoch, path, std::forward<ReleaseFunc>(release));
+        }
+
+        void mark_dirty(const K key) {
+            if (compacting)
+                compaction_dirty_keys.push_back(key);
+        }
+
+        /**
+         * The live entries are bulk loaded into "<path>.compact" in chunks, LOCK_VOLUME() guards every chunk,
+         * so the volume is served between them. The keys modified meanwhile are reapplied under the lock before the swap.
+         */
+        template <typename LockFunc>
+        int64_t compact(const int64_t max_bytes_per_second, LockFunc&& lock_volume) {
+            const auto compact_path = path + ".compact";
+            int64_t size_before;
+            {
+                auto lock = lock_volume();
+                validate(!compacting, error_msg::compaction_in_progress_msg, path);
+                compacting = true;
+                size_before = io->get_file_pos_end();
+            }
+
+            try {
+                std::error_code error_code;
+                std::filesystem::remove(compact_path, error_code);
+                copy_live_entries(compact_path, max_bytes_per_second, lock_volume);
+
+                auto lock = lock_volume();
+                apply_dirty_keys(compact_path);
+                swap_volume_file(compact_path);
+                return size_before - io->get_file_pos_end();
+            } catch (...) {
+                auto lock = lock_volume();
+                compacting = false;
+                compaction_dirty_keys.clear();
+                std::error_code error_code;
+                std::filesystem::remove(compact_path, error_code);
+                throw;
+            }
+        }
+
+        template <typename LockFunc>
+        void copy_live_entries(const std::string& compact_path, const int64_t max_bytes_per_second, LockFunc& lock_volume) {
+            using namespace std::chrono;
+
+            bulk::BulkLoader<K, V> loader(compact_path, order, engine(), bulk::BulkLoader<K, V>::DEFAULT_MEMORY_BUDGET, 1,
+                                          compression);
+            if (engine() == HASH) {
+                copy_live_keys(loader, max_bytes_per_second, lock_volume);
+                loader.finish();
+                return;
+            }
+            auto start = steady_clock::now();
+            int64_t copied_bytes = 0;
+            std::optional<K> last_key;
+            for (bool has_more = true; has_more;) {
+                {
+                    auto lock = lock_volume();
+                    auto c = cursor();
+                    // The volume could be modified between the chunks, so the copying continues after the last copied key
+                    bool valid = last_key ? c.seek(*last_key) : c.seek_to_first();
+                    if (valid && last_key && c.key() == *last_key)
+                        valid = c.next();
+                    for (int32_t i = 0; valid && i < COMPACTION_CHUNK_SIZE; ++i, valid = c.next()) {
+                        auto e = c.entry();
+                        loader.add(e);
+                        copied_bytes += sizeof(K) + e.size_in_bytes;
+                        last_key = e.key;
+                    }
+                    has_more = valid;
+                }
+
+                throttle(start, copied_bytes, max_bytes_per_second);
+            }
+            loader.finish();
+        }
+
+        /**
+         * COPY_LIVE_ENTRIES of the hash: its cursor sorts all the keys on the seek, so they're listed once and looked up
+         * by chunks. The keys removed meanwhile aren't found, the added ones are dirty
+         */
+        template <typename LockFunc>
+        void copy_live_keys(bulk::BulkLoader<K, V>& loader, const int64_t max_bytes_per_second, LockFunc& lock_volume) {
+            auto start = std::chrono::steady_clock::now();
+            int64_t copied_bytes = 0;
+            std::vector<K> keys;
+            {
+                auto lock = lock_volume();
+                auto c = cursor();
+                for (bool valid = c.seek_to_first(); valid; valid = c.next())
+                    keys.push_back(c.key());
+            }
+
+            for (size_t first = 0; first < keys.size(); first += COMPACTION_CHUNK_SIZE) {
+                {
+                    auto lock = lock_volume();
+                    auto last = std::min(keys.size(), first + COMPACTION_CHUNK_SIZE);
+                    for (auto i = first; i < last; ++i) {
+                        auto e = std::visit([&](auto& t) { return t.find(*io, keys[i]); }, tree);
+                        if (!e.is_valid())
+                            continue;
+                        loader.add(e);
+                        copied_bytes += sizeof(K) + e.size_in_bytes;
+                    }
+                }
+                throttle(start, copied_bytes, max_bytes_per_second);
+            }
+        }
+
+        /** Sleeps while the copying since START is faster than MAX_BYTES_PER_SECOND */
+        static void throttle(const std::chrono::steady_clock::time_point start, const int64_t copied_bytes,
+                             const int64_t max_bytes_per_second) {
+            using namespace std::chrono;
+
+            if (max_bytes_per_second <= 0)
+                return;
+            auto expected = microseconds(copied_bytes * 1'000'000 / max_bytes_per_second);
+            auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+            if (elapsed < expected)
+                std::this_thread::sleep_for(expected - elapsed);
+        }
+
+        void apply_dirty_keys(const std::string& compact_path) {
+            auto& keys = compaction_dirty_keys;
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+            IOManager<K, V> compact_io(compact_path, order, engine(), mapping, compression);
+            auto compact_tree = make_tree(order, compact_io, engine());
+            for (const auto key: keys) {
+                auto e = std::visit([&](auto& t) { return t.find(*io, key); }, tree);
+                if (e.is_valid()) {
+                    std::visit([&](auto& t) { set_raw(t, compact_io, key, entry_data(e), e.size_in_bytes); }, compact_tree);
+                } else {
+                    std::visit([&](auto& t) { t.remove(compact_io, key); }, compact_tree);
+                }
+            }
+            compact_io.flush();
+        }
+
+        void swap_volume_file(const std::string& compact_path) {
+            auto engine_type = engine();
+            if (wal) {
+                // The replaced file is durable, so its pages aren't restored on the new file after a crash
+                io->flush();
+                wal->drop_pages();
+                io->enable_wal(nullptr);
+            }
+            // The optimistic readers, the snapshots and the value views may still read the replaced file
+            bool is_read = io->has_snapshots() || io->has_pinned_values();
+            if (latches || is_read)
+                io->detach();
+            if (is_read)
+                retired_io.push_back(std::move(io));
+            else
+                retire(std::move(io));
+            // The new file and its name are durable before the log is emptied: its records are applied to the new file
+            file::sync(compact_path);
+            std::filesystem::rename(compact_path, path);
+            file::sync(parent_directory(path), true);
+            if (wal)
+                wal->discard();
+            io = std::make_unique<IOManager<K, V>>(path, order, engine_type, mapping, compression);
+            if (access_pattern != NORMAL)
+                io->advise(access_pattern);
+            if (latches) {
+                io->enable_latches(latches.get(), reader_epochs.get());
+                shared_io.store(io.get(), std::memory_order_release);
+            }
+            if (wal)
+                io->enable_wal(wal.get());
+            reload_tree();
+
+            compacting = false;
+            compaction_dirty_keys.clear();
+            // The log records are applied to the new file already
+            checkpoint();
+            // The replaced file isn't reachable from now
+            release_retired();
+        }
+
+        /** The tree is read from the file again: the file is replaced or restored */
+        void reload_tree() {
+            auto engine_type = engine();
+            if (engine_type == HASH)
+                tree.template emplace<ExtendibleHash<K, V>>(order, *io);
+            else if (is_bplus_tree(engine_type))
+                tree.template emplace<BPlusTree<K, V>>(order, *io);
+            else
+                tree.template emplace<BTree<K, V>>(order, *io);
+        }
+
+        static const uint8_t* entry_data(const typename BTree<K, V>::EntryT& e) {
+            if constexpr (std::is_arithmetic_v<V>)
+                return reinterpret_cast<const uint8_t*>(&e.data);
+            else
+                return reinterpret_cast<const uint8_t*>(e.data);
+        }
+
+        static std::string parent_directory(const std::string& file_path) {
+            auto parent = std::filesystem::path(file_path).parent_path();
+            return parent.empty() ? "." : parent.string();
+        }
+
+        void replay_wal() {
+            auto on_set = [&](const K key, const uint8_t* data, const int32_t size) {
+                set_filtered(key, [&](auto& t) { set_raw(t, *io, key, data, size); });
+            };
+            auto on_remove = [&](const K key) {
+                remove_filtered(key);
+            };
+            if (wal->replay(on_set, on_remove) > 0)
+                checkpoint();
+        }
+
+        /** Sets the value stored as SIZE bytes of DATA: in the log or in another volume file */
+        template <typename Tree>
+        static void set_raw(Tree& t, IOManager<K, V>& io, const K key, const uint8_t* data, const int32_t size) {
+            if constexpr (std::is_arithmetic_v<V>) {
+                V value;
+                std::memcpy(&value, data, sizeof(V));
+                t.set(io, key, value);
+            } else if constexpr (is_string_v<V>) {
+                using CharT = typename V::value_type;
+                t.set(io, key, V(reinterpret_cast<const CharT*>(data), size / sizeof(CharT)));
+            } else {
+                t.set(io, key, reinterpret_cast<V>(data), size);
+            }
+        }
+
+        /** SET_KEY(tree) sets KEY, the filter gets KEY if it's new */
+        template <typename Func>
+        void set_filtered(const K key, Func&& set_key) {
+            bool is_new = filter && !(filter->may_contain(key) && std::visit([&](auto& t) { return t.exist(*io, key); }, tree));
+            // The key is in the filter before it's in the tree: a concurrent reader doesn't miss it
+            bool inserted = is_new && filter->insert(key);
+            std::visit(set_key, tree);
+            if (is_new && !inserted)
+                build_filter();
+        }
+
+        bool remove_filtered(const K key) {
+            bool removed = std::visit([&](auto& t) { return t.remove(*io, key); }, tree);
+            if (removed && filter)
+                filter->remove(key);
+            return removed;
+        }
+
+        /** True if the filter tells KEY isn't in the volume: the lookup is answered without the tree */
+        bool is_filtered_out(const K key) const {
+            if (!filter || filter->may_contain(key))
+                return false;
+            filter->record_rejected();
+            return true;
+        }
+
+        /** Counts the lookup passed by the filter as a false positive unless the key is FOUND, returns FOUND */
+        bool record_if_missed(const bool found) const {
+            if (!found && filter)
+                filter->record_false_positives(1);
+            return found;
+        }
+
+        /** The file of the filter is removed even if the volume is opened without it: it'd be stale on next open */
+        void open_filter(const bool use_filter) {
+            const auto filter_path = path + FILTER_SUFFIX;
+            bool loaded = false;
+            if (use_filter) {
+                filter = std::make_unique<CuckooFilter<K>>(0);
+                loaded = closed_file_tag != 0 && filter->load(filter_path, closed_file_tag);
+            }
+            // The file is valid only till the volume is modified: it's written again on close
+            std::error_code error_code;
+            std::filesystem::remove(filter_path, error_code);
+            if (filter && !loaded)
+                build_filter();
+        }
+
+        /** The filter is built from the keys of the tree, it grows till they all fit */
+        void build_filter() {
+            std::vector<K> keys;
+            auto c = cursor();
+            for (bool valid = c.seek_to_first(); valid; valid = c.next())
+                keys.push_back(c.key());
+            filter->rebuild(keys);
+        }
+
+        /** The size and the modification time of the file or 0 if it's missing */
+        static uint64_t file_tag(const std::string& path) {
+            std::error_code error_code;
+            auto size = std::filesystem::file_size(path, error_code);
+            if (error_code)
+                return 0;
+            auto time = std::filesystem::last_write_time(path, error_code).time_since_epoch().count();
+            if (error_code)
+                return 0;
+            return (static_cast<uint64_t>(size) * 0x9E3779B97F4A7C15ull) ^ static_cast<uint64_t>(time);
+        }
+
+        /**
+         * Sorts KEYS and looks them up with one traversal, ON_FOUND gets the index of the key in KEYS.
+         * The keys rejected by the filter aren't looked up.
+         */
+        template <typename Func>
+        void find_batch(const std::vector<K>& keys, Func&& on_found) {
+            std::vector<size_t> order;
+            order.reserve(keys.size());
+            for (size_t i = 0; i < keys.size(); ++i)
+                if (!is_filtered_out(keys[i]))
+                    order.push_back(i);
+            std::sort(order.begin(), order.end(), [&keys](const size_t l, const size_t r) { return keys[l] < keys[r]; });
+
+            std::vector<K> sorted_keys(order.size());
+            for (size_t i = 0; i < order.size(); ++i)
+                sorted_keys[i] = keys[order[i]];
+
+            if (filter) {
+                size_t found_count = 0;
+                find_sorted_batch(sorted_keys, [&](const size_t i, const int64_t entry_pos) {
+                    ++found_count;
+                    on_found(order[i], entry_pos);
+                });
+                filter->record_false_positives(order.size() - found_count);
+                return;
+            }
+            find_sorted_batch(sorted_keys, [&](const size_t i, const int64_t entry_pos) { on_found(order[i], entry_pos); });
+        }
+
+        /** ON_FOUND gets the index of the key in SORTED_KEYS */
+        template <typename Func>
+        void find_sorted_batch(const std::vector<K>& sorted_keys, Func&& on_found) {
+            if (io->has_read_ring()) {
+                // Every level of the batch is read by io_uring at once, then the found entries at once
+                std::vector<std::pair<size_t, int64_t>> found;
+                auto on_level_found = [&](const size_t i, const int64_t entry_pos) {
+                    io->prefetch_entry(entry_pos);
+                    found.emplace_back(i, entry_pos);
+                };
+                std::visit([&](auto& t) {
+                    t.find_batch_by_levels(*io, sorted_keys.data(), sorted_keys.size(), on_level_found);
+                }, tree);
+                io->complete_prefetch();
+                for (auto [i, entry_pos]: found)
+                    on_found(i, entry_pos);
+                return;
+            }
+
+            std::visit([&](auto& t) { t.find_batch(*io, sorted_keys.data(), sorted_keys.size(), on_found); }, tree);
+        }
+
+        static TreeType make_tree(const int16_t order, IOManager<K, V>& io, const EngineType engine) {
+            if (engine == HASH)
+                return TreeType(std::in_place_type<ExtendibleHash<K, V>>, order, io);
+            if (is_bplus_tree(engine))
+                return TreeType(std::in_place_type<BPlusTree<K, V>>, order, io);
+            return TreeType(std::in_place_type<BTree<K, V>>, order, io);
         }
     };
 
-    /** Volume with coarse-grained locks for multithreading usage */
+    /**
+     * Volume for multithreading usage, the queries are synchronized according to the LockingMode:
+     *  - COARSE_LOCK: every query takes the volume mutex
+     *  - OPTIMISTIC_LOCK_COUPLING: exist/get don't take the mutex, they read the nodes validating their version latches
+     *    and are retried if a writer has modified them meanwhile; after MAX_OPTIMISTIC_ATTEMPTS they take the mutex
+     *    (the HASH volumes take the mutex: the directory of the hash is read from memory, not from the latched file)
+     * The asynchronous operations run on the shared executor in the order they're issued (see AsyncQueue).
+     */
     template <typename K, typename V>
     class VolumeMT final {
+        static constexpr int32_t MAX_OPTIMISTIC_ATTEMPTS = 16;
+
         Volume<K, V> volume;
         std::mutex mutex_;
+        const bool optimistic;
     public:
         using ValueType = typename Volume<K,V>::ValueType;
+        using CursorT = typename Volume<K,V>::CursorT;
         const std::string path;
+    private:
+        // Destroyed first: the queued operations use the volume
+        AsyncQueue async_queue;
+    public:
 
-        VolumeMT(const std::string& path, int16_t order) : volume(path, order) {}
+        VolumeMT(const std::string& path, int16_t order, const EngineType engine = BTREE, const bool use_wal = false,
+                 const LockingMode locking = COARSE_LOCK, const MappingOptions& mapping = MappingOptions(),
+                 const Compression compression = NO_COMPRESSION, const bool use_filter = false) :
+            volume(path, order, engine, use_wal, mapping, compression, use_filter),
+            optimistic(locking == OPTIMISTIC_LOCK_COUPLING && volume.engine() != HASH),
+            path(path)
+        {
+            if (optimistic)
+                volume.enable_optimistic_reads();
+        }
 
+        /** The filter is checked without the lock */
         bool exist(const K key) {
+            if (volume.is_filtered_out(key))
+                return false;
+
+            bool found = false;
+            auto on_entry = [&found](const auto&) { found = true; };
+            for (int32_t i = 0; optimistic && i < MAX_OPTIMISTIC_ATTEMPTS; ++i, found = false)
+                if (volume.find_optimistic(key, on_entry))
+                    return volume.record_if_missed(found);
+
             std::scoped_lock lock(mutex_);
             return volume.exist(key);
         }
 
+        /** The log is synced without the lock: concurrent writers share one sync (group commit) */
         void set(const K key, const ValueType value) {
-            std::scoped_lock lock(mutex_);
-            volume.set(key, value);
+            uint64_t lsn;
+            {
+                std::scoped_lock lock(mutex_);
+                lsn = volume.set_and_log(key, value);
+            }
+            volume.wait_durable(lsn);
         }
 
         void set(const K key, const V& value, const int32_t size) {
-            std::scoped_lock lock(mutex_);
-            volume.set(key, value, size);
+            uint64_t lsn;
+            {
+                std::scoped_lock lock(mutex_);
+                lsn = volume.set_and_log(key, value, size);
+            }
+            volume.wait_durable(lsn);
         }
 
         std::optional <V> get(const K key) {
+            if (volume.is_filtered_out(key))
+                return std::nullopt;
+
+            std::optional<V> value;
+            auto on_entry = [&value](const auto& e) { value = e.value(); };
+            for (int32_t i = 0; optimistic && i < MAX_OPTIMISTIC_ATTEMPTS; ++i, value.reset())
+                if (volume.find_optimistic(key, on_entry)) {
+                    volume.record_if_missed(value.has_value());
+                    return value;
+                }
+
             std::scoped_lock lock(mutex_);
             return volume.get(key);
         }
 
+        /** The view is used without the lock, its guard keeps the value in place */
+        ValueView<V> get_view(const K key) {
+            std::scoped_lock lock(mutex_);
+            return volume.get_view(key);
+        }
+
+        /** The lock is taken once for the whole batch */
+        void write(const WriteBatch<K, V>& batch) {
+            uint64_t lsn;
+            {
+                std::scoped_lock lock(mutex_);
+                lsn = volume.write_deferred_and_log(batch);
+            }
+            volume.wait_durable(lsn);
+        }
+
         bool remove(const K key) {
+            std::pair<bool, uint64_t> res;
+            {
+                std::scoped_lock lock(mutex_);
+                res = volume.remove_and_log(key);
+            }
+            volume.wait_durable(res.second);
+            return res.first;
+        }
+
+        void checkpoint() {
+            std::scoped_lock lock(mutex_);
+            volume.checkpoint();
+        }
+
+        /** The counters are read without the lock */
+        WalStats wal_stats() const {
+            return volume.wal_stats();
+        }
+
+        EngineType engine() const {
+            return volume.engine();
+        }
+
+        FilterStats filter_stats() {
+            std::scoped_lock lock(mutex_);
+            return volume.filter_stats();
+        }
+
+        /** The cursor holds the lock, the other threads wait until it's destroyed */
+        CursorT cursor() {
+            std::unique_lock lock(mutex_);
+            return CursorT(volume.cursor(), std::move(lock));
+        }
+
+        template <typename Func>
+        int64_t scan(const K lo, const K hi, Func&& fn) {
+            std::scoped_lock lock(mutex_);
+            return volume.scan(lo, hi, std::forward<Func>(fn));
+        }
+
+        MultiGetResult<V> multi_get(const std::vector<K>& keys) {
+            std::scoped_lock lock(mutex_);
+            return volume.multi_get(keys);
+        }
+
+        std::vector<bool> multi_exist(const std::vector<K>& keys) {
             std::scoped_lock lock(mutex_);
-            return volume.remove(key);
+            return volume.multi_exist(keys);
+        }
+
+        void advise(const AccessPattern pattern) {
+            std::scoped_lock lock(mutex_);
+            volume.advise(pattern);
+        }
+
+        void prefetch(const std::vector<K>& keys) {
+            std::scoped_lock lock(mutex_);
+            volume.prefetch(keys);
+        }
+
+        /** The snapshot is read without the lock, the lock is taken to take and release it */
+        typename Volume<K, V>::SnapshotT snapshot() {
+            std::scoped_lock lock(mutex_);
+            return volume.make_snapshot([this, io = volume.io.get()](const uint64_t epoch) {
+                std::scoped_lock release_lock(mutex_);
+                io->release_snapshot(epoch);
+            });
+        }
+
+        /** The lock is taken per copied chunk, the other threads are served between the chunks */
+        int64_t compact(const int64_t max_bytes_per_second = 0) {
+            return volume.compact(max_bytes_per_second, [this]() { return std::unique_lock(mutex_); });
+        }
+
+        std::future<std::optional<V>> async_get(const K key) {
+            if constexpr (std::is_pointer_v<V>)
+                validate(!volume.io->has_transient_addresses(), error_msg::transient_blob_msg, volume.path);
+            return async_queue.post([this, key]() { return get(key); });
+        }
+
+        /** The value is copied, it may be destroyed when the call returns */
+        std::future<void> async_set(const K key, const ValueType value) {
+            static_assert(!std::is_pointer_v<V>, "The blobs are set with their size");
+            return async_queue.post([this, key, value = V(value)]() { set(key, value); });
+        }
+
+        std::future<void> async_set(const K key, const V& value, const int32_t size) {
+            auto* data = cast_to_const_uint8_t_data(value);
+            return async_queue.post([this, key, bytes = std::vector<uint8_t>(data, data + size), size]() {
+                set(key, reinterpret_cast<V>(bytes.data()), size);
+            });
+        }
+
+        std::future<bool> async_remove(const K key) {
+            return async_queue.post([this, key]() { return remove(key); });
+        }
+
+        /** Runs the compaction on a background thread, the volume must not be closed until it's finished */
+        std::future<int64_t> compact_async(const int64_t max_bytes_per_second = 0) {
+            return std::async(std::launch::async, [this, max_bytes_per_second]() { return compact(max_bytes_per_second); });
         }
     };
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+#include "btree_impl/btree.h"
+#include "utils/utils.h"
+
+namespace btree {
+    /**
+     * Sets and removes applied to a volume at once by Volume::write: the values are copied into the batch, so it may
+     * outlive them. The operations are applied in the key order, the last operation of a key wins. It's a deferred-write
+     * batch: the operations share the node writes, not the descents. Empty blob values are ignored as by Volume::set.
+     */
+    template <typename K, typename V>
+    class WriteBatch final {
+        using EntryT = typename BTree<K, V>::EntryT;
+
+        struct Op {
+            K key;
+            bool is_remove;
+            // The value in VALUES
+            size_t offset;
+            int32_t size;
+        };
+
+        std::vector<Op> ops;
+        std::vector<uint8_t> values;
+    public:
+        using ValueType = typename BTree<K, V>::ValueType;
+
+        void set(const K key, const ValueType value) {
+            static_assert(!std::is_pointer_v<V>, "The size of a blob value is needed");
+            add_set(EntryT{ key, value });
+        }
+
+        void set(const K key, const V& value, const int32_t size) {
+            if (size != 0)
+                add_set(EntryT{ key, value, size });
+        }
+
+        void remove(const K key) {
+            ops.push_back(Op{ key, true, values.size(), 0 });
+        }
+
+        size_t size() const {
+            return ops.size();
+        }
+
+        bool empty() const {
+            return ops.empty();
+        }
+
+        void clear() {
+            ops.clear();
+            values.clear();
+        }
+
+        /** Calls ON_SET(key, data, size) or ON_REMOVE(key) for the last operation of every key in the key order */
+        template <typename SetFunc, typename RemoveFunc>
+        void for_each(SetFunc&& on_set, RemoveFunc&& on_remove) const {
+            std::vector<size_t> order(ops.size());
+            std::iota(order.begin(), order.end(), 0);
+            // The operations of a key keep their order
+            std::stable_sort(order.begin(), order.end(), [this](const size_t a, const size_t b) {
+                return ops[a].key < ops[b].key;
+            });
+            for (size_t i = 0; i < order.size(); ++i) {
+                const auto& op = ops[order[i]];
+                if (i + 1 < order.size() && ops[order[i + 1]].key == op.key)
+                    continue;
+                if (op.is_remove)
+                    on_remove(op.key);
+                else
+                    on_set(op.key, values.data() + op.offset, op.size);
+            }
+        }
+
+    private:
+        void add_set(const EntryT& e) {
+            const uint8_t* data;
+            if constexpr (std::is_arithmetic_v<V>)
+                data = utils::cast_to_const_uint8_t_data(&e.data);
+            else
+                data = e.data;
+            ops.push_back(Op{ e.key, false, values.size(), e.size_in_bytes });
+            values.insert(values.end(), data, data + e.size_in_bytes);
+        }
+    };
+}
@@ -6,19 +6,28 @@
 #include <filesystem>
 
 #include "test_runner/test_runner.h"
+#include "bulk_load/bulk_loader.h"
 #include "utils/size_info.h"
 
 namespace tests::key_value_op_tests {
     constexpr std::string_view output_folder = "../../output_key_value_op_test/";
     constexpr int orders[] = { 2, 5, 13, 31, 50, 79, 100 };
+    constexpr btree::EngineType engines[] = { btree::BTREE, btree::BPLUS_TREE, btree::PACKED_BPLUS_TREE, btree::HASH };
+    enum Backend { MAPPING, BUFFER_POOL };
+    constexpr Backend backends[] = { MAPPING, BUFFER_POOL };
 
     namespace fs = std::filesystem;
     using namespace btree;
     using namespace test_utils;
 
 namespace details {
-    std::string db_name(const std::string& name, const int tree_order) {
-        return output_folder.data() + name + "_" + std::to_string(tree_order) + ".txt";
+    std::string db_name(const std::string& name, const int tree_order, const EngineType engine) {
+        return output_folder.data() + name + "_" + std::to_string(tree_order) + "_e" + std::to_string(engine) + ".txt";
+    }
+
+    MappingOptions mapping_options(const Backend backend) {
+        // The pool is small, its frames are smaller than the nodes of the large orders: they're evicted and overlapped
+        return backend == BUFFER_POOL ? MappingOptions::buffer_pool(256 * 1024, 4096) : MappingOptions();
     }
 
     template <typename VolumeT, typename K, typename V>
@@ -30,13 +39,22 @@ namespace details {
         }
     }
 
+    template <typename K, typename V>
+    void add(bulk::BulkLoader<K, V>& loader, const K key, const Data<V>& data) {
+        if constexpr(std::is_pointer_v<V>) {
+            loader.add(key, data.value, data.len);
+        } else {
+            loader.add(key, data.value);
+        }
+    }
+
 
     struct TestEmptyFile {
         template <typename K, typename V>
-        static bool run(std::string const& db_name, int const order) {
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
             {
                 Storage<K, V> s;
-                s.open_volume(db_name, order);
+                s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
             }
             bool success = fs::file_size(db_name) == 0;
             return success;
@@ -45,13 +63,21 @@ namespace details {
 
     struct TestFileSizeWithOneEntry {
         template <typename K, typename V>
-        static bool run(std::string const& db_name, int const order) {
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
             Storage<K, V> s;
             ValueGenerator<V> g;
 
             const K key = 0;
             Data<V> data = g.next_value(key);
-            uint32_t file_size = SizeInfo<K, V>::file_size_in_bytes(order, key, data.value, data.len);
+            // The layout of the file is checked once, then the size of the file is kept when it's reopened
+            {
+                auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
+                set(volume, key, data);
+                s.close_volume(volume);
+            }
+            auto file_size = static_cast<uint32_t>(fs::file_size(db_name));
+            if (!SizeInfo<K, V>::has_one_entry_layout(db_name, order, engine, data.len, file_size))
+                return false;
 
             auto on_exit = [&](const auto& volume, const uint32_t size_in_bytes) -> bool {
                 s.close_volume(volume);
@@ -60,17 +86,17 @@ namespace details {
 
             bool success = true;
             {
-                auto volume = s.open_volume(db_name, order);
+                auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
                 set(volume, key, data);
                 success &= on_exit(volume, file_size);
             }
             {
-                auto volume = s.open_volume(db_name, order);
+                auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
                 success &= g.check(key, volume);
                 success &= on_exit(volume, file_size);
             }
             {
-                auto volume = s.open_volume(db_name, order);
+                auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
                 success &= volume.remove(key);
                 success &= on_exit(volume, SizeInfo<K, V>::header_size_in_bytes());
             }
@@ -81,7 +107,7 @@ namespace details {
 
     struct TestSetGetOneKey {
         template <typename K, typename V>
-        static bool run(std::string const& db_name, int const order) {
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
             Storage<K, V> s;
             ValueGenerator<V> g;
 
@@ -90,13 +116,13 @@ namespace details {
 
             bool success = true;
             {
-                auto volume = s.open_volume(db_name, order);
+                auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
                 set(volume, key, data);
                 success &= g.check(key, volume);
                 s.close_volume(volume);
             }
             {
-                auto volume = s.open_volume(db_name, order);
+                auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
                 success &= g.check(key, volume);
                 s.close_volume(volume);
             }
@@ -107,7 +133,7 @@ namespace details {
 
     struct TestRemoveOneKey {
         template <typename K, typename V>
-        static bool run(std::string const& db_name, int const order) {
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
             Storage<K, V> s;
             ValueGenerator<V> g;
 
@@ -116,7 +142,7 @@ namespace details {
 
             bool success = true;
             {
-                auto volume = s.open_volume(db_name, order);
+                auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
                 set(volume, key, data);
                 success &= volume.remove(key);
                 if (success) {
@@ -126,7 +152,7 @@ namespace details {
             }
             success &= (fs::file_size(db_name) == SizeInfo<K, V>::header_size_in_bytes());
             {
-                auto volume = s.open_volume(db_name, order);
+                auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
                 success &= g.check(key, volume);
                 s.close_volume(volume);
             }
@@ -138,14 +164,14 @@ namespace details {
 
     struct TestRepeatableOperationsOnOneKey {
         template <typename K, typename V>
-        static bool run(std::string const& db_name, int const order) {
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
             Storage<K, V> s;
             ValueGenerator<V> g;
 
             const K key = 0;
             Data<V> data = g.next_value(key);
 
-            auto volume = s.open_volume(db_name, order);
+            auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
             bool success = true;
             for (int i = 0; i < 100; ++i) {
                 set(volume, key, data);
@@ -162,13 +188,13 @@ namespace details {
 
     struct TestMultipleSetOnTheSameKey {
         template <typename K, typename V>
-        static bool run(std::string const& db_name, int const order) {
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
             Storage<K, V> s;
             ValueGenerator<V> g;
 
             const K key = 0;
 
-            auto volume = s.open_volume(db_name, order);
+            auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
             bool success = true;
             for (int i = 0; i < 1000; ++i) {
                 Data<V> data = g.next_value(key);
@@ -181,36 +207,181 @@ namespace details {
         }
     };
 
+    struct TestCursor {
+        static constexpr int elements_count = 1000;
+        template <typename K, typename V>
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
+            Storage<K, V> s;
+            ValueGenerator<V> g;
+
+            // only even keys are present
+            auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
+            for (int i = elements_count - 1; i >= 0; --i)
+                set(volume, 2 * i, g.next_value(2 * i));
+
+            bool success = true;
+            {
+                auto cursor = volume.cursor();
+                int count = 0;
+                for (bool valid = cursor.seek_to_first(); valid; valid = cursor.next(), ++count)
+                    success &= (cursor.key() == 2 * count) && g.check_value(cursor.key(), cursor.value());
+                success &= (count == elements_count);
+
+                for (bool valid = cursor.seek_to_last(); valid; valid = cursor.prev())
+                    success &= (cursor.key() == 2 * --count);
+                success &= (count == 0);
+
+                // seek to an absent key stops at the next one, then go back and forth
+                success &= cursor.seek(101) && (cursor.key() == 102);
+                success &= cursor.prev() && (cursor.key() == 100);
+                success &= cursor.next() && cursor.next() && (cursor.key() == 104);
+                success &= !cursor.seek(2 * elements_count);
+            }
+
+            K lo = 10, hi = 1000;
+            K expected_key = lo;
+            auto visited = volume.scan(lo, hi, [&](const K key, const V& value) {
+                success &= (key == expected_key) && g.check_value(key, value);
+                expected_key += 2;
+            });
+            success &= (visited == (hi - lo) / 2) && (volume.scan(hi, lo, [](const K, const V&) {}) == 0);
+            s.close_volume(volume);
+            return success;
+        }
+    };
+
+    struct TestMultiGet {
+        static constexpr int elements_count = 1000;
+        template <typename K, typename V>
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
+            Storage<K, V> s;
+            ValueGenerator<V> g;
+
+            // only even keys are present
+            auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
+            for (int i = 0; i < elements_count; ++i)
+                set(volume, 2 * i, g.next_value(2 * i));
+
+            // unsorted batch with absent keys and duplicates
+            std::vector<K> keys;
+            for (int i = 2 * elements_count + 10; i >= -10; i -= 3)
+                keys.push_back(i);
+            keys.push_back(0);
+            keys.push_back(0);
+
+            auto values = volume.multi_get(keys);
+            auto exist = volume.multi_exist(keys);
+            bool success = (values.size() == keys.size()) && (exist.size() == keys.size());
+            for (size_t i = 0; i < keys.size(); ++i) {
+                K key = keys[i];
+                bool expected = (key >= 0) && (key < 2 * elements_count) && (key % 2 == 0);
+                success &= (values.has_value(i) == expected) && (exist[i] == expected);
+                if (expected)
+                    success &= g.check_value(key, values[i]);
+            }
+            s.close_volume(volume);
+            return success;
+        }
+    };
+
+    struct TestBulkLoad {
+        static constexpr int elements_count = 5000;
+        template <typename K, typename V>
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
+            ValueGenerator<V> g;
+
+            std::vector<K> keys(elements_count);
+            std::iota(keys.begin(), keys.end(), 0);
+            std::shuffle(keys.begin(), keys.end(), g.m_rand);
+
+            bool success = true;
+            {
+                // small memory budget -> the input is split into many sorted runs
+                bulk::BulkLoader<K, V> loader(db_name, order, engine, 64 * 1024, 2);
+                for (auto key: keys) {
+                    if (key % 3 == 0)
+                        add(loader, key, g.next_value(2 * elements_count + key));  // stale value, it's overwritten below
+                }
+                for (auto key: keys)
+                    add(loader, key, g.next_value(key));
+                success &= (loader.finish() == elements_count);
+            }
+
+            Storage<K, V> s;
+            auto volume = s.open_volume(db_name, order, engine, false, COARSE_LOCK, mapping);
+            for (int i = 0; i < elements_count; ++i)
+                success &= g.check(i, volume);
+
+            K expected_key = 0;
+            auto scanned = volume.scan(0, elements_count, [&](const K key, const V&) {
+                success &= (key == expected_key++);
+            });
+            success &= (scanned == elements_count);
+
+            // the loaded tree is a regular one: it supports removal and insertion
+            for (int i = 0; i < elements_count; i += 2) {
+                success &= volume.remove(i);
+                g.remove(i);
+            }
+            for (int i = elements_count; i < elements_count + 100; ++i)
+                set(volume, i, g.next_value(i));
+            for (int i = 0; i < elements_count + 100; ++i)
+                success &= g.check(i, volume);
+            s.close_volume(volume);
+            return success;
+        }
+    };
+
     struct TestRandomValues {
         static constexpr int elements_count = 10000;
         template <typename K, typename V>
-        static bool run(std::string const& db_name, int const order) {
-            return TestRunner<K, V>::run(db_name, order, elements_count);
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
+            return TestRunner<K, V>::run(db_name, order, engine, elements_count, mapping);
         };
     };
 
+    template <LockingMode locking>
     struct TestMultithreading {
         static constexpr int elements_count = 10000;
         static constexpr int workers_count = 10;
         template <typename K, typename V>
-        static bool run(std::string const& db_name, int const order) {
+        static bool run(std::string const& db_name, int const order, EngineType const engine, MappingOptions const& mapping) {
             ThreadPool pool(workers_count);
-            return TestRunnerMT<K, V>::run(pool, db_name, order, elements_count);
+            return TestRunnerMT<K, V>::run(pool, db_name, order, engine, elements_count, locking, mapping);
+        };
+    };
+
+    struct TestMultithreadingScaling {
+        static constexpr int elements_count = 100000;
+        static constexpr int order = 50;
+        static constexpr int ops_per_thread = 50000;
+        static constexpr int read_percent = 90;
+        static bool run(EngineType const engine) {
+            // The speedup is over 1 thread
+            const std::vector<int> threads = { 1, 2, 4, 8 };
+            bool success = true;
+            for (auto locking: { COARSE_LOCK, OPTIMISTIC_LOCK_COUPLING }) {
+                auto name = db_name("mt_scaling_" + std::to_string(locking), order, engine);
+                success &= TestRunnerMT<int32_t, int32_t>::run_scaling(name, order, engine, elements_count, locking, threads,
+                                                                       ops_per_thread, read_percent);
+            }
+            return success;
         };
     };
 }
     using namespace details;
     template <typename TestClass>
-    bool run(const std::string& name_part, const int order) {
-        auto name = name_part + "_st";
+    bool run(const std::string& name_part, const int order, const EngineType engine, const Backend backend = MAPPING) {
+        auto name = name_part + (backend == BUFFER_POOL ? "_bp" : "") + "_st";
+        auto mapping = mapping_options(backend);
         bool success = false;
-        success = TestClass::template run<int32_t, int32_t>(db_name(name + "_i32", order), order);
-        success &= TestClass::template run<int32_t, int64_t>(db_name(name + "_i64", order), order);
-        success &= TestClass::template run<int32_t, float>(db_name(name + "_f", order), order);
-        success &= TestClass::template run<int32_t, double>(db_name(name + "_d", order), order);
-        success &= TestClass::template run<int32_t, std::string>(db_name(name + "_str", order), order);
-        success &= TestClass::template run<int32_t, std::wstring>(db_name(name + "_wstr", order), order);
-        success &= TestClass::template run<int32_t, const char*>(db_name(name + "_blob", order), order);
+        success = TestClass::template run<int32_t, int32_t>(db_name(name + "_i32", order, engine), order, engine, mapping);
+        success &= TestClass::template run<int32_t, int64_t>(db_name(name + "_i64", order, engine), order, engine, mapping);
+        success &= TestClass::template run<int32_t, float>(db_name(name + "_f", order, engine), order, engine, mapping);
+        success &= TestClass::template run<int32_t, double>(db_name(name + "_d", order, engine), order, engine, mapping);
+        success &= TestClass::template run<int32_t, std::string>(db_name(name + "_str", order, engine), order, engine, mapping);
+        success &= TestClass::template run<int32_t, std::wstring>(db_name(name + "_wstr", order, engine), order, engine, mapping);
+        success &= TestClass::template run<int32_t, const char*>(db_name(name + "_blob", order, engine), order, engine, mapping);
         return success;
     }
 }
@@ -2,6 +2,9 @@
 
 #ifdef UNIT_TESTS
 
+#include <fstream>
+#include <optional>
+
 #include "io/mapped_file.h"
 
 namespace tests::mapped_file_test {
@@ -144,6 +147,248 @@ namespace details {
         return success;
     }
 
+    bool run_test_reserved_growth() {
+        using K = int32_t;
+        using V = int64_t;
+        bool success = true;
+        // the range fits the file / the file outgrows the range and is moved
+        for (int64_t reserved_size: { int64_t(1) << 30, int64_t(1) << 16 }) {
+            std::string path = details::get_absolute_file_name("reserved_" + std::to_string(reserved_size));
+            auto mapping = MappingOptions::reserved(4096);
+            mapping.reserved_size = reserved_size;
+            {
+                MappedFile<K, V> file(path, 0, mapping);
+                file.write_next_primitive(V(0));
+                auto* begin = file.address(0);
+                for (int i = 1; i < details::ITERATIONS; ++i) {
+                    file.write_next_primitive(V(i));
+                    if (file.get_pos() <= reserved_size)
+                        success &= (file.address(0) == begin);
+                }
+            }
+            success &= (fs::file_size(path) == sizeof(V) * details::ITERATIONS);
+            {
+                MappedFile<K, V> file(path, 0, mapping);
+                for (int i = 0; i < details::ITERATIONS; ++i)
+                    success &= (file.template read_next_primitive<V>() == V(i));
+                file.set_pos(sizeof(V));
+                file.shrink_to_fit();
+                file.set_pos(0);
+                success &= (file.template read_next_primitive<V>() == V(0));
+            }
+            success &= (fs::file_size(path) == sizeof(V));
+        }
+        return success;
+    }
+
+    bool run_test_windowed_mapping() {
+        using K = int32_t;
+        using V = std::string;
+        std::string path = details::get_absolute_file_name("windowed");
+        // the values straddle the windows, some of them are larger than a window
+        auto value_of = [](const int i) { return std::string((i % 10 == 0) ? 20000 : i % 100, static_cast<char>('a' + i % 26)); };
+        auto mapping = MappingOptions::windowed(16 * 1024, 64 * 1024);
+        bool success = true;
+        {
+            MappedFile<K, V> file(path, 0, mapping);
+            for (int i = 0; i < details::ITERATIONS; ++i) {
+                auto value = value_of(i);
+                file.write_next_data(cast_to_const_uint8_t_data(value.data()), static_cast<int32_t>(value.size()));
+            }
+        }
+        {
+            MappedFile<K, V> file(path, 0, mapping);
+            for (int i = 0; i < details::ITERATIONS; ++i) {
+                file.set_pos(file.get_pos());
+                auto [data, size] = file.template read_next_data<const uint8_t*>();
+                auto value = value_of(i);
+                success &= (size == static_cast<int32_t>(value.size())) && details::compare(value, data, size);
+            }
+        }
+        return success;
+    }
+
+    bool run_test_buffer_pool() {
+        using K = int32_t;
+        using V = std::string;
+        // the values straddle the frames, some of them are larger than the pool
+        auto value_of = [](const int i) { return std::string((i % 10 == 0) ? 20000 : i % 100, static_cast<char>('a' + i % 26)); };
+        bool success = true;
+        for (bool direct_io: { false, true }) {
+            std::string path = details::get_absolute_file_name("buffer_pool_" + std::to_string(direct_io));
+            {
+                MappedFile<K, V> file(path, 0, MappingOptions::buffer_pool(16 * 1024, 4096, direct_io));
+                for (int i = 0; i < details::ITERATIONS; ++i) {
+                    file.set_pos(file.get_pos());
+                    auto value = value_of(i);
+                    file.write_next_data(cast_to_const_uint8_t_data(value.data()), static_cast<int32_t>(value.size()));
+                }
+            }
+            // the evicted and the remaining frames are written back: the file is read by the mapping
+            MappedFile<K, V> file(path, 0);
+            for (int i = 0; i < details::ITERATIONS; ++i) {
+                auto [data, size] = file.template read_next_data<const uint8_t*>();
+                auto value = value_of(i);
+                success &= (size == static_cast<int32_t>(value.size())) && details::compare(value, data, size);
+            }
+        }
+        return success;
+    }
+
+    bool run_test_buffer_pool_straddling() {
+        const int64_t frame_size = 4096;
+        std::string path = details::get_absolute_file_name("buffer_pool_straddling");
+        {
+            std::ofstream file(path, std::ios::binary);
+            std::vector<char> zeros(4 * frame_size, 0);
+            file.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+        }
+        std::atomic<int32_t> value_pins = 0;
+        std::vector<uint8_t> node(64, 'n');
+        std::vector<uint8_t> entry(256, 'e');
+        // the node is in the first frame, the entry straddles the first and the second ones
+        const int64_t node_pos = frame_size - 1024;
+        const int64_t entry_pos = frame_size - 128;
+        bool success = true;
+        {
+            BufferPool pool(path, frame_size, 2 * frame_size, false, 0, value_pins);
+            auto* node_address = pool.address(node_pos, static_cast<int64_t>(node.size()), true);
+            // the first frame is dropped for the frame of both, the node is written through its old address
+            auto* entry_address = pool.address(entry_pos, static_cast<int64_t>(entry.size()), true);
+            std::copy(node.begin(), node.end(), node_address);
+            std::copy(entry.begin(), entry.end(), entry_address);
+            pool.release();
+
+            auto* node_data = pool.address(node_pos, static_cast<int64_t>(node.size()), false);
+            auto* entry_data = pool.address(entry_pos, static_cast<int64_t>(entry.size()), false);
+            success &= std::equal(node.begin(), node.end(), node_data);
+            success &= std::equal(entry.begin(), entry.end(), entry_data);
+            pool.release();
+        }
+        // both are written back
+        std::ifstream file(path, std::ios::binary);
+        std::vector<char> data(4 * frame_size);
+        file.read(data.data(), static_cast<std::streamsize>(data.size()));
+        success &= std::equal(node.begin(), node.end(), data.begin() + node_pos);
+        success &= std::equal(entry.begin(), entry.end(), data.begin() + entry_pos);
+        return success;
+    }
+
+    bool run_test_read_ring() {
+        static const int64_t page_size = ::sysconf(_SC_PAGESIZE);
+        std::string path = details::get_absolute_file_name("read_ring");
+        std::vector<uint8_t> data(3 * page_size);
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = static_cast<uint8_t>(i % 251);
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(data.data()),
+                                                    static_cast<std::streamsize>(data.size()));
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        bool success = true;
+        {
+            // the reads of a readable file complete into the buffers, the last one stops at the end of the file
+            ReadRing ring(fd, 2);
+            if (!ring.is_open()) {
+                ::close(fd);
+                return true;
+            }
+            std::vector<uint8_t> buffer(4 * page_size);
+            for (int64_t i = 0; i < 4; ++i)
+                ring.read(i * page_size, buffer.data() + i * page_size, page_size);
+            auto results = ring.wait();
+            success &= ring.is_open() && results == std::vector<int64_t>{ page_size, page_size, page_size, 0 };
+            success &= std::equal(data.begin(), data.end(), buffer.begin());
+        }
+        ::close(fd);
+
+        // a directory can't be read: the reads are failed and the ring is closed, the next reads aren't issued
+        int dir_fd = ::open(output_folder.data(), O_RDONLY);
+        {
+            ReadRing failing_ring(dir_fd, 2);
+            std::vector<uint8_t> buffer(page_size);
+            failing_ring.read(0, buffer.data(), page_size);
+            failing_ring.read(0, buffer.data(), page_size);
+            auto failed = failing_ring.wait();
+            success &= !failing_ring.is_open() && failed == std::vector<int64_t>(2, ReadRing::FAILED_READ);
+            failing_ring.read(0, buffer.data(), page_size);
+            success &= failing_ring.wait() == std::vector<int64_t>{ ReadRing::FAILED_READ };
+        }
+        ::close(dir_fd);
+        return success;
+    }
+
+    bool run_test_buffer_pool_read_ring() {
+        const int64_t frame_size = 4096;
+        std::string path = details::get_absolute_file_name("buffer_pool_read_ring");
+        std::vector<uint8_t> data(8 * frame_size + 100);
+        for (size_t i = 0; i < data.size(); ++i)
+            data[i] = static_cast<uint8_t>(i % 251);
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(data.data()),
+                                                    static_cast<std::streamsize>(data.size()));
+
+        std::atomic<int32_t> value_pins = 0;
+        bool success = true;
+        for (bool direct_io: { false, true }) {
+            BufferPool pool(path, frame_size, 16 * frame_size, direct_io, 4, value_pins);
+            if (!pool.has_read_ring())
+                return true;
+            // the frames of a level, a range straddling two frames, the tail of the file and a range read meanwhile
+            for (int64_t frame = 0; frame < 4; ++frame)
+                pool.prefetch(frame * frame_size + 16, 64);
+            pool.prefetch(5 * frame_size - 32, 64);
+            pool.prefetch(8 * frame_size, 100);
+            pool.prefetch(8 * frame_size + 50, 10);
+            auto* read_meanwhile = pool.address(2 * frame_size, 16, false);
+            success &= std::equal(read_meanwhile, read_meanwhile + 16, data.begin() + 2 * frame_size);
+            pool.complete_prefetch();
+            // every byte is cached once: the frame read meanwhile isn't cached again
+            success &= pool.get_cached_bytes() == 7 * frame_size;
+
+            for (auto [pos, size]: std::initializer_list<std::pair<int64_t, int64_t>> {
+                { 0, frame_size }, { 3 * frame_size + 10, 100 }, { 5 * frame_size - 32, 64 }, { 8 * frame_size, 100 } }) {
+                auto* address = pool.address(pos, size, false);
+                success &= std::equal(address, address + size, data.begin() + pos);
+            }
+            success &= pool.get_cached_bytes() == 7 * frame_size;
+            pool.release();
+        }
+        return success;
+    }
+
+    bool run_test_reader_epochs() {
+        ReaderEpochs epochs;
+        bool success = true;
+        // a reader which has entered before the retirement keeps the object, the readers entered after don't
+        std::optional<ReaderEpochs::Guard> old_reader(epochs.enter());
+        auto object = std::make_shared<int32_t>(1);
+        std::weak_ptr<int32_t> retired = object;
+        epochs.retire(std::move(object));
+        epochs.reclaim();
+        success &= !retired.expired() && epochs.retired_count() == 1;
+
+        std::optional<ReaderEpochs::Guard> new_reader(epochs.enter());
+        epochs.reclaim();
+        success &= !retired.expired();
+        old_reader.reset();
+        epochs.reclaim();
+        success &= retired.expired() && epochs.retired_count() == 0;
+
+        // the next generation waits for the readers of its epoch, it's freed right away if there are none
+        auto next_object = std::make_shared<int32_t>(2);
+        std::weak_ptr<int32_t> next_retired = next_object;
+        epochs.retire(std::move(next_object));
+        epochs.reclaim();
+        success &= !next_retired.expired();
+        new_reader.reset();
+        epochs.reclaim();
+        success &= next_retired.expired();
+
+        epochs.retire(std::make_shared<int32_t>(3));
+        epochs.reclaim();
+        success &= epochs.retired_count() == 0;
+        return success;
+    }
+
     bool run_arithmetic_test() {
         bool success = details::run_test_arithmetics<int32_t, int32_t>("_i32");
         success &= details::run_test_arithmetics<int32_t, uint32_t>("_ui32");
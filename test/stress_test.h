@@ -26,15 +26,17 @@ namespace details {
     using std::chrono::steady_clock;
 
     // see BTreeNode<K, V>::get_node_size_in_bytes
+    template <typename K>
     constexpr size_t node_size_for_t(const size_t t) {
-        return 3 + (4 * t - 1) * 8;
+        return 3 + (2 * t - 1) * (sizeof(K) + 8) + 2 * t * 8;
     }
 
+    template <typename K>
     constexpr int32_t get_optimal_tree_order(const size_t page_size) {
 #ifdef _MSC_VER
         return 128; // too big page size: 64 kB for x86|x64
 #else
-        return static_cast<int32_t>(((page_size - 3) / 8 + 1) / 4);
+        return static_cast<int32_t>((page_size - 3 + sizeof(K) + 8) / (2 * (sizeof(K) + 16)));
 #endif
     }
 
@@ -145,7 +147,7 @@ namespace details {
 }
     template <typename K, typename V>
     bool run(const std::string& type_name) {
-        const int32_t optimal_order = details::get_optimal_tree_order(m_boost::bip::mapped_region::get_page_size());
+        const int32_t optimal_order = details::get_optimal_tree_order<K>(m_boost::bip::mapped_region::get_page_size());
 
         const auto& path = details::get_file_name(type_name, optimal_order);
         btree::Storage<K, V> s;
@@ -166,8 +168,8 @@ namespace details {
         auto page_size = m_boost::bip::mapped_region::get_page_size();
         cout << "System page_size is: " << page_size << " bytes" << endl;
 
-        auto optimal_order = details::get_optimal_tree_order(page_size);
-        cout << "\toptimal node size: " << details::node_size_for_t(optimal_order) << " bytes, it fits to OS page_size" << endl;
+        auto optimal_order = details::get_optimal_tree_order<int32_t>(page_size);
+        cout << "\toptimal node size: " << details::node_size_for_t<int32_t>(optimal_order) << " bytes, it fits to OS page_size" << endl;
         cout << "\toptimal tree order: " << optimal_order << std::endl;
     }
 
@@ -12,6 +12,15 @@ BOOST_AUTO_TEST_SUITE(mapped_file_test, *CleanBeforeTest(output_folder.data()))
     BOOST_AUTO_TEST_CASE(test_strings_values) { BOOST_REQUIRE_MESSAGE(run_string_test(), "TEST_STRING"); }
     BOOST_AUTO_TEST_CASE(test_mody_and_save) { BOOST_REQUIRE_MESSAGE(run_test_modify_and_save(), "TEST_MODIFY_AND_SAVE"); }
     BOOST_AUTO_TEST_CASE(test_array) { BOOST_REQUIRE_MESSAGE(run_test_array(), "TEST_ARRAY"); }
+    BOOST_AUTO_TEST_CASE(test_reserved_growth) { BOOST_REQUIRE_MESSAGE(run_test_reserved_growth(), "TEST_RESERVED_GROWTH"); }
+    BOOST_AUTO_TEST_CASE(test_windowed_mapping) { BOOST_REQUIRE_MESSAGE(run_test_windowed_mapping(), "TEST_WINDOWED_MAPPING"); }
+    BOOST_AUTO_TEST_CASE(test_buffer_pool) { BOOST_REQUIRE_MESSAGE(run_test_buffer_pool(), "TEST_BUFFER_POOL"); }
+    BOOST_AUTO_TEST_CASE(test_buffer_pool_straddling) { BOOST_REQUIRE_MESSAGE(run_test_buffer_pool_straddling(), "TEST_BUFFER_POOL_STRADDLING"); }
+    BOOST_AUTO_TEST_CASE(test_read_ring) { BOOST_REQUIRE_MESSAGE(run_test_read_ring(), "TEST_READ_RING"); }
+    BOOST_AUTO_TEST_CASE(test_buffer_pool_read_ring) {
+        BOOST_REQUIRE_MESSAGE(run_test_buffer_pool_read_ring(), "TEST_BUFFER_POOL_READ_RING");
+    }
+    BOOST_AUTO_TEST_CASE(test_reader_epochs) { BOOST_REQUIRE_MESSAGE(run_test_reader_epochs(), "TEST_READER_EPOCHS"); }
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -20,6 +29,40 @@ BOOST_AUTO_TEST_SUITE(volume_test, *CleanBeforeTest(output_folder.data()))
     BOOST_AUTO_TEST_CASE(volume_order) { BOOST_REQUIRE_MESSAGE(test_volume_order(), "TEST_VOLUME_ORDER");}
     BOOST_AUTO_TEST_CASE(volume_key_size) { BOOST_REQUIRE_MESSAGE(test_volume_key_size(), "TEST_VOLUME_KEY_SIZE");}
     BOOST_AUTO_TEST_CASE(volume_value_type) { BOOST_REQUIRE_MESSAGE(test_volume_type(), "TEST_VOLUME_VALUE"); }
+    BOOST_AUTO_TEST_CASE(volume_engine) { BOOST_REQUIRE_MESSAGE(test_volume_engine(), "TEST_VOLUME_ENGINE"); }
+    BOOST_AUTO_TEST_CASE(volume_legacy_format) { BOOST_REQUIRE_MESSAGE(test_volume_legacy_format(), "TEST_VOLUME_LEGACY_FORMAT"); }
+    BOOST_AUTO_TEST_CASE(volume_wal_recovery) { BOOST_REQUIRE_MESSAGE(test_volume_wal_recovery(), "TEST_VOLUME_WAL_RECOVERY"); }
+    BOOST_AUTO_TEST_CASE(volume_wal_group_commit) { BOOST_REQUIRE_MESSAGE(test_volume_wal_group_commit(), "TEST_VOLUME_WAL_GROUP_COMMIT"); }
+    BOOST_AUTO_TEST_CASE(volume_wal_torn_pages) { BOOST_REQUIRE_MESSAGE(test_volume_wal_torn_pages(), "TEST_VOLUME_WAL_TORN_PAGES"); }
+    BOOST_AUTO_TEST_CASE(volume_wal_sync_count) { BOOST_REQUIRE_MESSAGE(test_volume_wal_sync_count(), "TEST_VOLUME_WAL_SYNC_COUNT"); }
+    BOOST_AUTO_TEST_CASE(volume_wal_recovery_without_wal) {
+        BOOST_REQUIRE_MESSAGE(test_volume_wal_recovery_without_wal(), "TEST_VOLUME_WAL_RECOVERY_WITHOUT_WAL");
+    }
+    BOOST_AUTO_TEST_CASE(volume_free_space_reuse) { BOOST_REQUIRE_MESSAGE(test_volume_free_space_reuse(), "TEST_VOLUME_FREE_SPACE_REUSE"); }
+    BOOST_AUTO_TEST_CASE(volume_compaction) { BOOST_REQUIRE_MESSAGE(test_volume_compaction(), "TEST_VOLUME_COMPACTION"); }
+    BOOST_AUTO_TEST_CASE(volume_compaction_mt) { BOOST_REQUIRE_MESSAGE(test_volume_compaction_mt(), "TEST_VOLUME_COMPACTION_MT"); }
+    BOOST_AUTO_TEST_CASE(volume_optimistic_reclamation) {
+        BOOST_REQUIRE_MESSAGE(test_volume_optimistic_reclamation(), "TEST_VOLUME_OPTIMISTIC_RECLAMATION");
+    }
+    BOOST_AUTO_TEST_CASE(volume_snapshot) { BOOST_REQUIRE_MESSAGE(test_volume_snapshot(), "TEST_VOLUME_SNAPSHOT"); }
+    BOOST_AUTO_TEST_CASE(volume_get_view) { BOOST_REQUIRE_MESSAGE(test_volume_get_view(), "TEST_VOLUME_GET_VIEW"); }
+    BOOST_AUTO_TEST_CASE(volume_windowed_mapping) { BOOST_REQUIRE_MESSAGE(test_volume_windowed_mapping(), "TEST_VOLUME_WINDOWED_MAPPING"); }
+    BOOST_AUTO_TEST_CASE(volume_buffer_pool) { BOOST_REQUIRE_MESSAGE(test_volume_buffer_pool(), "TEST_VOLUME_BUFFER_POOL"); }
+    BOOST_AUTO_TEST_CASE(volume_transient_blobs) { BOOST_REQUIRE_MESSAGE(test_volume_transient_blobs(), "TEST_VOLUME_TRANSIENT_BLOBS"); }
+    BOOST_AUTO_TEST_CASE(volume_io_uring) { BOOST_REQUIRE_MESSAGE(test_volume_io_uring(), "TEST_VOLUME_IO_URING"); }
+    BOOST_AUTO_TEST_CASE(volume_async_operations) { BOOST_REQUIRE_MESSAGE(test_volume_async_operations(), "TEST_VOLUME_ASYNC_OPERATIONS"); }
+    BOOST_AUTO_TEST_CASE(volume_write_batch) { BOOST_REQUIRE_MESSAGE(test_volume_write_batch(), "TEST_VOLUME_WRITE_BATCH"); }
+    BOOST_AUTO_TEST_CASE(volume_write_batch_rollback) { BOOST_REQUIRE_MESSAGE(test_volume_write_batch_rollback(), "TEST_VOLUME_WRITE_BATCH_ROLLBACK"); }
+    BOOST_AUTO_TEST_CASE(volume_access_hints) { BOOST_REQUIRE_MESSAGE(test_volume_access_hints(), "TEST_VOLUME_ACCESS_HINTS"); }
+    BOOST_AUTO_TEST_CASE(volume_node_alignment) { BOOST_REQUIRE_MESSAGE(test_volume_node_alignment(), "TEST_VOLUME_NODE_ALIGNMENT"); }
+    BOOST_AUTO_TEST_CASE(volume_packed_keys) { BOOST_REQUIRE_MESSAGE(test_volume_packed_keys(), "TEST_VOLUME_PACKED_KEYS"); }
+    BOOST_AUTO_TEST_CASE(volume_value_compression) {
+        BOOST_REQUIRE_MESSAGE(test_volume_value_compression(), "TEST_VOLUME_VALUE_COMPRESSION");
+    }
+    BOOST_AUTO_TEST_CASE(volume_inline_values) { BOOST_REQUIRE_MESSAGE(test_volume_inline_values(), "TEST_VOLUME_INLINE_VALUES"); }
+    BOOST_AUTO_TEST_CASE(volume_membership_filter) { BOOST_REQUIRE_MESSAGE(test_volume_membership_filter(), "TEST_VOLUME_MEMBERSHIP_FILTER"); }
+    BOOST_AUTO_TEST_CASE(volume_filter_reclamation) { BOOST_REQUIRE_MESSAGE(test_volume_filter_reclamation(), "TEST_VOLUME_FILTER_RECLAMATION"); }
+    BOOST_AUTO_TEST_CASE(volume_hash_engine) { BOOST_REQUIRE_MESSAGE(test_volume_hash_engine(), "TEST_VOLUME_HASH_ENGINE"); }
     BOOST_AUTO_TEST_CASE(volume_is_not_shared_between_storages) {
         BOOST_REQUIRE_MESSAGE(test_volume_is_not_shared(), "TEST_VOLUME_IS_NOT_SHARED_BETWEEN_STORAGES");
     }
@@ -27,29 +70,45 @@ BOOST_AUTO_TEST_SUITE_END()
 
 
 BOOST_AUTO_TEST_SUITE(key_value_op_tests, *CleanBeforeTest(output_folder.data()))
-    BOOST_DATA_TEST_CASE(test_empty_file, boost::make_iterator_range(orders), order) {
-        BOOST_REQUIRE_MESSAGE(run<TestEmptyFile>("empty", order), "TEST_EMPTY_FILE");
+    BOOST_DATA_TEST_CASE(test_empty_file, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestEmptyFile>("empty", order, engine, backend), "TEST_EMPTY_FILE");
     }
-    BOOST_DATA_TEST_CASE(file_size_after_set_one_element, boost::make_iterator_range(orders), order) {
-        BOOST_REQUIRE_MESSAGE(run<TestFileSizeWithOneEntry>("one_entry", order), "TEST_FILE_SIZE");
+    BOOST_DATA_TEST_CASE(file_size_after_set_one_element, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestFileSizeWithOneEntry>("one_entry", order, engine, backend), "TEST_FILE_SIZE");
     }
-    BOOST_DATA_TEST_CASE(set_get_one_element, boost::make_iterator_range(orders), order) {
-        BOOST_REQUIRE_MESSAGE(run<TestSetGetOneKey>("set_get_one_entry", order), "TEST_SET_GET_ONE_ELEMENT");
+    BOOST_DATA_TEST_CASE(set_get_one_element, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestSetGetOneKey>("set_get_one_entry", order, engine, backend), "TEST_SET_GET_ONE_ELEMENT");
     }
-    BOOST_DATA_TEST_CASE(remove_one_element, boost::make_iterator_range(orders), order) {
-        BOOST_REQUIRE_MESSAGE(run<TestRemoveOneKey>("remove_one", order), "TEST_REMOVE_ONE_ELEMENT");
+    BOOST_DATA_TEST_CASE(remove_one_element, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestRemoveOneKey>("remove_one", order, engine, backend), "TEST_REMOVE_ONE_ELEMENT");
     }
-    BOOST_DATA_TEST_CASE(repeatable_operations_on_a_unique_key, boost::make_iterator_range(orders), order) {
-        BOOST_REQUIRE_MESSAGE(run<TestRepeatableOperationsOnOneKey>("repeatable_ops", order), "TEST_REPEATABLE_OPERATIONS");
+    BOOST_DATA_TEST_CASE(repeatable_operations_on_a_unique_key, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestRepeatableOperationsOnOneKey>("repeatable_ops", order, engine, backend), "TEST_REPEATABLE_OPERATIONS");
     }
-    BOOST_DATA_TEST_CASE(multiple_set_on_the_same_key, boost::make_iterator_range(orders), order) {
-        BOOST_REQUIRE_MESSAGE(run<TestMultipleSetOnTheSameKey>("multiple_set", order), "TEST_SET_VARIOUS_VALUES");
+    BOOST_DATA_TEST_CASE(multiple_set_on_the_same_key, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestMultipleSetOnTheSameKey>("multiple_set", order, engine, backend), "TEST_SET_VARIOUS_VALUES");
     }
-    BOOST_DATA_TEST_CASE(test_on_random_values, boost::make_iterator_range(orders), order) {
-        BOOST_REQUIRE_MESSAGE(run<TestRandomValues>("random", order), "TEST_RANDOM_VALUES");
+    BOOST_DATA_TEST_CASE(cursor_and_scan, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestCursor>("cursor", order, engine, backend), "TEST_CURSOR_AND_SCAN");
     }
-    BOOST_DATA_TEST_CASE(multithreading_test, boost::make_iterator_range(orders), order) {
-        BOOST_REQUIRE_MESSAGE(run<TestMultithreading>("mt", order), "TEST_MULTITHREADING");
+    BOOST_DATA_TEST_CASE(multi_get, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestMultiGet>("multi_get", order, engine, backend), "TEST_MULTI_GET");
+    }
+    BOOST_DATA_TEST_CASE(bulk_load, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestBulkLoad>("bulk_load", order, engine, backend), "TEST_BULK_LOAD");
+    }
+    BOOST_DATA_TEST_CASE(test_on_random_values, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestRandomValues>("random", order, engine, backend), "TEST_RANDOM_VALUES");
+    }
+    BOOST_DATA_TEST_CASE(multithreading_test, boost::make_iterator_range(orders) * boost::make_iterator_range(engines) * boost::make_iterator_range(backends), order, engine, backend) {
+        BOOST_REQUIRE_MESSAGE(run<TestMultithreading<COARSE_LOCK>>("mt", order, engine, backend), "TEST_MULTITHREADING");
+    }
+    // The lock-free readers need the whole file mapped
+    BOOST_DATA_TEST_CASE(multithreading_olc_test, boost::make_iterator_range(orders) * boost::make_iterator_range(engines), order, engine) {
+        BOOST_REQUIRE_MESSAGE(run<TestMultithreading<OPTIMISTIC_LOCK_COUPLING>>("mt_olc", order, engine), "TEST_MULTITHREADING_OLC");
+    }
+    BOOST_DATA_TEST_CASE(multithreading_scaling, boost::make_iterator_range(engines), engine) {
+        BOOST_REQUIRE_MESSAGE(TestMultithreadingScaling::run(engine), "TEST_MULTITHREADING_SCALING");
     }
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -1,5 +1,12 @@
 #include <string>
 #include <map>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
 
 #include "utils/test_stat.h"
 #include "utils/thread_pool.h"
@@ -15,10 +22,15 @@ namespace tests {
         Storage<K,V> storage;
         ValueGenerator<V> g;
 
-        explicit TestRunner(int iterations) : stat(iterations) {}
+        const EngineType engine;
+        const MappingOptions mapping;
+
+        explicit TestRunner(int iterations, EngineType engine, const MappingOptions& mapping) :
+            stat(iterations), engine(engine), mapping(mapping) {}
     public:
-        static bool run(const std::string& db_name, const int order, const int n) {
-            TestRunner<K, V> runner {n};
+        static bool run(const std::string& db_name, const int order, const EngineType engine, const int n,
+                        const MappingOptions& mapping = MappingOptions()) {
+            TestRunner<K, V> runner {n, engine, mapping};
 
             std::tuple<int, int, int> keys_to_remove  = std::make_tuple(
                 runner.g.m_rand() % 7 + 1,
@@ -42,7 +54,7 @@ namespace tests {
         }
     private:
         bool test_set(const std::string& path, int order, int n) {
-            auto btree = storage.open_volume(path, order);
+            auto btree = storage.open_volume(path, order, engine, false, COARSE_LOCK, mapping);
 
             for (int i = 0; i < n; ++i) {
                 K key = i;
@@ -65,7 +77,7 @@ namespace tests {
         }
 
         bool test_get(const std::string& path, int order, int n) {
-            auto btree = storage.open_volume(path, order);
+            auto btree = storage.open_volume(path, order, engine, false, COARSE_LOCK, mapping);
 
             bool success = true;
             for (int i = 0; i < n; ++i) {
@@ -82,7 +94,7 @@ namespace tests {
         }
 
         bool test_remove(const std::string& path, int order, int n, std::tuple<int, int, int>& keys_to_remove) {
-            auto btree = storage.open_volume(path, order);
+            auto btree = storage.open_volume(path, order, engine, false, COARSE_LOCK, mapping);
 
             const auto& [r1, r2, r3] = keys_to_remove;
 
@@ -117,7 +129,7 @@ namespace tests {
         }
 
         bool test_after_remove(const std::string& path, int order, int n) {
-            auto btree = storage.open_volume(path, order);
+            auto btree = storage.open_volume(path, order, engine, false, COARSE_LOCK, mapping);
             bool success = true;
             for (int i = 0; i < n; ++i) {
                 auto actual_value = btree.get(i);
@@ -139,13 +151,15 @@ namespace tests {
 
         explicit TestRunnerMT() {}
     public:
-        static bool run(ThreadPool& pool, const std::string& db_name, const int order, const int n) {
+        static bool run(ThreadPool& pool, const std::string& db_name, const int order, const EngineType engine, const int n,
+                        const LockingMode locking = COARSE_LOCK, const MappingOptions& mapping = MappingOptions()) {
             TestRunnerMT runner;
-            auto volume = runner.storage.open_volume(db_name, order);
+            auto volume = runner.storage.open_volume(db_name, order, engine, false, locking, mapping);
             bool success = true;
 
             runner.fill_map_with_random_values(n);
             success &= runner.test_set(pool, volume, n);
+            success &= runner.test_get_while_set(pool, volume, n);
             success &= runner.test_remove(pool, volume, n / 2);
 #ifdef DEBUG
             cout << "\t Passed for " + db_name << endl;
@@ -153,7 +167,67 @@ namespace tests {
             return success;
         }
 
+        /**
+         * Runs the mixed workload (READ_PERCENT of gets, the rest are sets of the same values) on every number of
+         * THREADS and prints the throughput and the speedup over the first number for each one. The numbers are fixed,
+         * not taken from the host: the results of the hosts are comparable, the oversubscribed ones show the contention
+         */
+        static bool run_scaling(const std::string& db_name, const int order, const EngineType engine, const int n,
+                                const LockingMode locking, const std::vector<int>& threads, const int ops_per_thread,
+                                const int read_percent) {
+            TestRunnerMT runner;
+            auto volume = runner.storage.open_volume(db_name, order, engine, false, locking);
+            runner.fill_map_with_random_values(n);
+            test_set_keys(volume, runner.g.map(), 0, n);
+
+            bool success = true;
+            std::cout << "\t" << db_name << (locking == COARSE_LOCK ? " (coarse lock):" : " (optimistic lock coupling):");
+            double base_ops_per_second = 0;
+            for (auto threads_count: threads) {
+                std::vector<std::future<bool>> workers;
+                auto start = std::chrono::steady_clock::now();
+                for (int t = 0; t < threads_count; ++t) {
+                    workers.push_back(std::async(std::launch::async, [&, t]() {
+                        return runner.run_mixed_workload(volume, n, ops_per_thread, read_percent, t);
+                    }));
+                }
+                for (auto& worker: workers)
+                    success &= worker.get();
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+                auto ops_per_second = threads_count * ops_per_thread / elapsed.count();
+                if (base_ops_per_second == 0)
+                    base_ops_per_second = ops_per_second;
+                // The format of the speedup isn't left in std::cout
+                std::ostringstream speedup;
+                speedup << std::fixed << std::setprecision(2) << ops_per_second / base_ops_per_second;
+                std::cout << " " << threads_count << " threads -> " << static_cast<int64_t>(ops_per_second) << " ops/s"
+                          << " (x" << speedup.str() << ");";
+            }
+            std::cout << std::endl;
+            return success;
+        }
+
     private:
+        template <typename VolumeT>
+        bool run_mixed_workload(VolumeT& volume, const int n, const int ops_count, const int read_percent, const int seed) {
+            std::mt19937 rand(seed);
+            bool success = true;
+            for (int i = 0; i < ops_count; ++i) {
+                K key = static_cast<K>(rand() % n);
+                if (static_cast<int>(rand() % 100) < read_percent) {
+                    success &= g.check_value(key, volume.get(key));
+                } else {
+                    const auto& data = g.map().find(key)->second;
+                    if constexpr(std::is_pointer_v<V>)
+                        volume.set(key, data.value, data.len);
+                    else
+                        volume.set(key, data.value);
+                }
+            }
+            return success;
+        }
+
         void fill_map_with_random_values(int n) {
             for (int i = 0; i < n; ++i)
                 g.next_value(i);
@@ -168,6 +242,22 @@ namespace tests {
             return (get_stat.total_found == n);
         }
 
+        /** The readers check the values while the writer sets the same values again (the nodes and entries are rewritten) */
+        template <typename VolumeT>
+        bool test_get_while_set(ThreadPool& pool, VolumeT& volume, const int n) {
+            const int readers_count = 3;
+            auto writer = pool.submit([&]() -> TestStat { return test_set_keys(volume, g.map(), 0, n); });
+            std::vector<std::future<TestStat>> readers;
+            for (int i = 0; i < readers_count; ++i)
+                readers.push_back(pool.submit([&]() -> TestStat { return test_get_keys(volume, 0, n); }));
+
+            bool success = true;
+            writer.get();
+            for (auto& reader: readers)
+                success &= (reader.get().total_found == n);
+            return success;
+        }
+
         template <typename VolumeT>
         bool test_remove(ThreadPool& pool, VolumeT& volume, const int n) {
             auto half = n / 2;
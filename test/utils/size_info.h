@@ -1,5 +1,7 @@
 #pragma once
 
+#include <fstream>
+
 #include "btree_impl/btree_node.h"
 #include "io/io_manager.h"
 #include "utils/utils.h"
@@ -13,22 +15,44 @@ namespace tests {
             return btree::IOManager<K,V>::INITIAL_ROOT_POS_IN_HEADER;
         }
 
-        static constexpr int32_t file_size_in_bytes(const int t, const K key, const V& val, const int32_t value_size) {
-            return header_size_in_bytes() + node_size(t) + full_entry_size_in_bytes(key, val, value_size);
+        /**
+         * The file of one entry: the root takes the first node slot after the header and doesn't straddle the pages
+         * (the hash takes a slot for its directory page and two slots for its bucket), the file ends after the slots,
+         * the entry and the free space map of one node slot and one extent at most
+         */
+        static bool has_one_entry_layout(const std::string& path, const int t, const btree::EngineType engine,
+                                         const int32_t value_size, const uint32_t file_size) {
+            int64_t root_pos = btree::IOManager<K,V>::INVALID_POS;
+            std::ifstream file(path, std::ios::binary);
+            // ROOT POS follows T, KEY_SIZE, VALUE_TYPE and ELEMENT_SIZE
+            file.seekg(sizeof(int16_t) + 3);
+            file.read(reinterpret_cast<char*>(&root_pos), sizeof(root_pos));
+
+            const int64_t page_size = m_boost::bip::mapped_region::get_page_size();
+            const int64_t slot_size = btree::IOManager<K,V>::get_node_slot_size(t);
+            const int64_t node_size = btree::BTreeNode<K,V>::get_node_size_in_bytes(t);
+            auto alignment = std::min(slot_size, page_size);
+            bool success = (root_pos % alignment == 0) && (root_pos >= header_size_in_bytes()) &&
+                           (root_pos < header_size_in_bytes() + alignment);
+            success &= (node_size > page_size) || (root_pos / page_size == (root_pos + node_size - 1) / page_size);
+
+            auto slots = (engine == btree::HASH) ? 3 : 1;
+            // NODES_COUNT, EXTENTS_COUNT, a node slot and an extent: POS + SIZE
+            auto free_map_size = 4 * sizeof(int64_t) + sizeof(int32_t);
+            auto max_size = root_pos + slots * slot_size + entry_size_in_bytes(value_size) + free_map_size;
+            return success && (root_pos + node_size <= file_size) && (file_size <= max_size);
         }
 
     private:
-        static constexpr int32_t node_size(const int t) {
-            return btree::BTreeNode<K,V>::get_node_size_in_bytes(t);
-        }
 
-        static constexpr int32_t full_entry_size_in_bytes(const K key, const V& val, const int32_t value_size) {
+        /** The arithmetic values are kept in the nodes */
+        static constexpr int32_t entry_size_in_bytes(const int32_t value_size) {
             int32_t key_size = sizeof(K);
             if constexpr (std::is_pointer_v<V> || is_string_v<V>) {
                 int32_t value_len = 4; // sizeof(int32_t) for storing the length of value
                 return key_size + value_len + value_size;
             } else {
-                return key_size + value_size;
+                return 0;
             }
         }
     };
@@ -2,6 +2,14 @@
 
 #ifdef UNIT_TESTS
 
+#include <thread>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <algorithm>
+#include <map>
+#include <limits>
+
 #include "storage.h"
 #include "utils/error.h"
 
@@ -29,6 +37,40 @@ namespace details {
     }
 
     using StorageT = btree::Storage<int, int>;
+
+    /** The mappings of the file at PATH in the process, a replaced file is listed by its path too */
+    int count_mappings(const std::string& path) {
+        auto file_path = fs::weakly_canonical(path).string();
+        std::ifstream maps("/proc/self/maps");
+        int count = 0;
+        for (std::string line; std::getline(maps, line);)
+            count += (line.find(file_path) != std::string::npos);
+        return count;
+    }
+
+    /** Writes a volume with one entry in the legacy (v1) format: no FORMAT_VERSION and no inline keys in nodes */
+    void write_legacy_volume(const std::string& path) {
+        constexpr int64_t header_size = 13;
+        constexpr int64_t node_size = 3 + (2 * order - 1) * 8 + 2 * order * 8;
+
+        btree::MappedFile<int, int> file(path, 0);
+        file.write_next_primitive<int16_t>(order);
+        file.write_next_primitive<uint8_t>(sizeof(int));
+        file.write_next_primitive<uint8_t>(utils::get_value_type_code<int>());
+        file.write_next_primitive<uint8_t>(utils::get_element_size<int>());
+        file.write_next_primitive<int64_t>(header_size);
+
+        std::vector<int64_t> key_pos(2 * order - 1, -1);
+        std::vector<int64_t> child_pos(2 * order, -1);
+        key_pos[0] = header_size + node_size;
+        file.write_next_primitive<uint8_t>(true);
+        file.write_next_primitive<int16_t>(1);
+        file.write_node_vector(key_pos);
+        file.write_node_vector(child_pos);
+
+        file.write_next_primitive(key);
+        file.write_next_primitive(value);
+    }
 }
 
     bool test_volume_open_close() {
@@ -95,6 +137,991 @@ namespace details {
         return success && elem_size_differs;
     }
 
+    bool test_volume_engine() {
+        const auto& path = details::get_file_name("volume_engine_validation");
+        bool success = false;
+        {
+            details::StorageT s;
+            auto v = s.open_volume(path, order, btree::BPLUS_TREE);
+            v.set(key, value);
+            success = (v.engine() == btree::BPLUS_TREE);
+            s.close_volume(v);
+            try {
+                s.open_volume(path, order, btree::BTREE);
+                success = false;
+            } catch (const std::logic_error& e) {
+                std::string_view err_msg = e.what();
+                success &= err_msg.find(error_msg::wrong_engine_msg) != std::string_view::npos;
+            }
+        }
+        details::StorageT s;
+        auto v = s.open_volume(path, order, btree::BPLUS_TREE);
+        return success && (v.get(key) == value);
+    }
+
+    bool test_volume_legacy_format() {
+        const auto& path = details::get_file_name("volume_legacy_format");
+        details::write_legacy_volume(path);
+
+        const int n = 100;
+        bool success = true;
+        {
+            details::StorageT s;
+            auto v = s.open_volume(path, order);
+            success &= (v.get(key) == value);
+            for (int i = 1; i < n; ++i)
+                v.set(i, -i);
+        }
+        {
+            details::StorageT s;
+            auto v = s.open_volume(path, order);
+            success &= (v.get(key) == value);
+            for (int i = 1; i < n; ++i)
+                success &= (v.get(i) == -i);
+            for (int i = 0; i < n; ++i)
+                success &= v.remove(i);
+        }
+        // the empty volume is rewritten in the current format
+        return success && (fs::file_size(path) == btree::IOManager<int, int>::INITIAL_ROOT_POS_IN_HEADER);
+    }
+
+    bool test_volume_wal_recovery() {
+        const int n = 200;
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_wal_" + std::to_string(engine));
+            const auto& crashed_path = details::get_file_name("volume_wal_crashed_" + std::to_string(engine));
+            {
+                btree::Storage<int, std::string> s;
+                auto v = s.open_volume(path, order, engine, true);
+                for (int i = 0; i < n / 2; ++i)
+                    v.set(i, std::to_string(i));
+                v.checkpoint();
+                // the volume file on disk before the crash: the next operations are only in the log
+                fs::copy_file(path, crashed_path);
+
+                for (int i = n / 2; i < n; ++i)
+                    v.set(i, std::to_string(i));
+                for (int i = 0; i < n / 4; ++i)
+                    v.remove(i);
+                success &= (fs::file_size(path + ".wal") > 0);
+
+                // the last record is torn by the crash
+                fs::copy_file(path + ".wal", crashed_path + ".wal");
+                std::ofstream(crashed_path + ".wal", std::ios::app | std::ios::binary) << "torn record";
+            }
+            // the log is truncated on close
+            success &= (fs::file_size(path + ".wal") == 0);
+            {
+                btree::Storage<int, std::string> s;
+                auto v = s.open_volume(crashed_path, order, engine, true);
+                for (int i = 0; i < n; ++i) {
+                    auto expected = (i < n / 4) ? std::nullopt : std::optional(std::to_string(i));
+                    success &= (v.get(i) == expected);
+                }
+            }
+            success &= (fs::file_size(crashed_path + ".wal") == 0);
+        }
+        return success;
+    }
+
+    bool test_volume_wal_group_commit() {
+        const auto& path = details::get_file_name("volume_wal_group_commit");
+        const int threads_count = 8;
+        const int n = 200;
+        {
+            btree::StorageMT<int, int> s;
+            auto v = s.open_volume(path, order, btree::BTREE, true);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < threads_count; ++t) {
+                threads.emplace_back([&v, t]() {
+                    for (int i = t * n; i < (t + 1) * n; ++i)
+                        v.set(i, -i);
+                    for (int i = t * n; i < (t + 1) * n; i += 2)
+                        v.remove(i);
+                });
+            }
+            for (auto& thread: threads)
+                thread.join();
+        }
+        bool success = true;
+        details::StorageT s;
+        auto v = s.open_volume(path, order);
+        for (int i = 0; i < threads_count * n; ++i)
+            success &= (v.get(i) == ((i % 2) ? std::optional(-i) : std::nullopt));
+        return success;
+    }
+
+    bool test_volume_wal_torn_pages() {
+        const int n = 1000;
+        const int64_t page_size = 4096;
+        const std::vector<std::pair<std::string, btree::MappingOptions>> mappings = {
+            { "", btree::MappingOptions() },
+            { "_windowed", btree::MappingOptions::windowed(64 * 1024, 256 * 1024) },
+            { "_buffer_pool", btree::MappingOptions::buffer_pool(128 * 1024, 4096) }
+        };
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            for (const auto& [name, mapping]: mappings) {
+                auto suffix = std::to_string(engine) + name;
+                const auto& path = details::get_file_name("volume_wal_torn_" + suffix);
+                const auto& crashed_path = details::get_file_name("volume_wal_torn_crashed_" + suffix);
+                std::string checkpoint_image;
+                std::string last_image;
+                auto read_file = [](const std::string& file_path) {
+                    std::ifstream in(file_path, std::ios::binary);
+                    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                };
+                {
+                    btree::Storage<int, std::string> s;
+                    auto v = s.open_volume(path, order, engine, true, btree::COARSE_LOCK, mapping);
+                    for (int i = 0; i < n; ++i)
+                        v.set(i, std::to_string(i));
+                    v.checkpoint();
+                    checkpoint_image = read_file(path);
+
+                    // the nodes and the values of the checkpoint are modified in place, new ones are added
+                    for (int i = 0; i < n; i += 3)
+                        v.remove(i);
+                    for (int i = 1; i < n; i += 3)
+                        v.set(i, std::string(20, 'x'));
+                    for (int i = n; i < 2 * n; ++i)
+                        v.set(i, std::to_string(i));
+                    last_image = read_file(path);
+                    fs::copy_file(path + ".wal", crashed_path + ".wal", fs::copy_options::overwrite_existing);
+                }
+                // the kernel wrote back some of the modified pages before the crash
+                std::mt19937 gen(engine);
+                std::string crashed_image = last_image;
+                for (int64_t pos = 0; pos < static_cast<int64_t>(checkpoint_image.size()); pos += page_size) {
+                    if (gen() % 2)
+                        crashed_image.replace(pos, page_size, checkpoint_image, pos, page_size);
+                }
+                std::ofstream(crashed_path, std::ios::binary | std::ios::trunc) << crashed_image;
+                {
+                    btree::Storage<int, std::string> s;
+                    auto v = s.open_volume(crashed_path, order, engine, true, btree::COARSE_LOCK, mapping);
+                    for (int i = 0; i < 2 * n; ++i) {
+                        auto expected = (i < n && i % 3 == 0) ? std::nullopt
+                                : std::optional((i < n && i % 3 == 1) ? std::string(20, 'x') : std::to_string(i));
+                        success &= (v.get(i) == expected);
+                    }
+                }
+                // the log is emptied on close
+                success &= (fs::file_size(crashed_path + ".wal") == 0);
+            }
+        }
+        return success;
+    }
+
+    bool test_volume_wal_sync_count() {
+        const auto& path = details::get_file_name("volume_wal_sync_count");
+        const int threads_count = 8;
+        const int n = 1000;
+        std::vector<int> keys(n);
+        std::iota(keys.begin(), keys.end(), 0);
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(n));
+        bool success = true;
+        {
+            btree::Storage<int, int> s;
+            auto v = s.open_volume(path, order, btree::BTREE, true);
+            for (int i = 0; i < n; ++i)
+                v.set(i, i);
+            v.checkpoint();
+
+            // the random overwrites modify the pages of the checkpoint one after another
+            auto before = v.wal_stats();
+            for (auto key: keys)
+                v.set(key, -key);
+            auto stats = v.wal_stats();
+            success &= (stats.saved_pages > before.saved_pages);
+            // the page images are synced along with the records: one sync per operation
+            success &= (stats.records - before.records == n) && (stats.syncs - before.syncs == n);
+        }
+        {
+            btree::StorageMT<int, int> s;
+            auto v = s.open_volume(path, order, btree::BTREE, true);
+            std::vector<std::thread> threads;
+            for (int t = 0; t < threads_count; ++t) {
+                threads.emplace_back([&v, &keys, t]() {
+                    for (size_t i = t; i < keys.size(); i += threads_count)
+                        v.set(keys[i], keys[i]);
+                });
+            }
+            for (auto& thread: threads)
+                thread.join();
+            // the concurrent writers share the syncs
+            auto stats = v.wal_stats();
+            success &= (stats.records == n) && (stats.saved_pages > 0) && (stats.syncs < stats.records);
+        }
+        return success;
+    }
+
+    bool test_volume_wal_recovery_without_wal() {
+        const auto& path = details::get_file_name("volume_wal_without_wal");
+        const auto& crashed_path = details::get_file_name("volume_wal_without_wal_crashed");
+        const int n = 200;
+        {
+            btree::Storage<int, int> s;
+            auto v = s.open_volume(path, order, btree::BTREE, true);
+            for (int i = 0; i < n / 2; ++i)
+                v.set(i, i);
+            v.checkpoint();
+            fs::copy_file(path, crashed_path);
+            for (int i = n / 2; i < n; ++i)
+                v.set(i, i);
+            fs::copy_file(path + ".wal", crashed_path + ".wal");
+        }
+        bool success = true;
+        {
+            // the log left by the crash is replayed, then it's removed
+            btree::Storage<int, int> s;
+            auto v = s.open_volume(crashed_path, order);
+            for (int i = 0; i < n; ++i)
+                success &= (v.get(i) == std::optional(i));
+            v.set(n, n);
+            success &= !fs::exists(crashed_path + ".wal");
+        }
+        {
+            btree::Storage<int, int> s;
+            auto v = s.open_volume(crashed_path, order, btree::BTREE, true);
+            for (int i = 0; i <= n; ++i)
+                success &= (v.get(i) == std::optional(i));
+        }
+        return success;
+    }
+
+    bool test_volume_free_space_reuse() {
+        const int n = 1000;
+        const std::string::size_type value_size = 10;
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_free_space_" + std::to_string(engine));
+            btree::Storage<int, std::string> s;
+            auto reopen = [&](auto&& fn) {
+                auto v = s.open_volume(path, order, engine);
+                fn(v);
+                s.close_volume(v);
+                return fs::file_size(path);
+            };
+
+            auto initial_size = reopen([&](auto& v) {
+                for (int i = 0; i < n; ++i)
+                    v.set(i, std::string(value_size, 'a'));
+            });
+            // the overwritten entry is replaced by the new one of the same size
+            auto size = reopen([&](auto& v) {
+                for (char c = 'b'; c < 'g'; ++c)
+                    for (int i = 0; i < n; ++i)
+                        v.set(i, std::string(value_size, c));
+            });
+            success &= (size == initial_size);
+
+            // the free space map of the removed entries and merged nodes is kept till the next open
+            auto size_with_free_space_map = reopen([&](auto& v) {
+                for (int i = 0; i < n / 2; ++i)
+                    v.remove(i);
+            });
+            size = reopen([&](auto& v) {
+                for (int i = 0; i < n / 2; ++i)
+                    success &= !v.get(i).has_value();
+                for (int i = 0; i < n / 2; ++i)
+                    v.set(i, std::string(value_size, 'x'));
+            });
+            const auto entries_size = (n / 2) * (sizeof(int) + sizeof(int32_t) + value_size);
+            success &= (size < size_with_free_space_map) && (size - initial_size < entries_size / 10);
+
+            reopen([&](auto& v) {
+                for (int i = 0; i < n; ++i)
+                    success &= (v.get(i) == std::string(value_size, (i < n / 2) ? 'x' : 'f'));
+            });
+        }
+        return success;
+    }
+
+    bool test_volume_compaction() {
+        const int n = 2000;
+        auto value_of = [](const int i) { return std::string(i % 7 + 1, static_cast<char>('a' + i % 26)); };
+        bool success = true;
+        for (auto use_wal: { false, true }) {
+            for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+                const auto& path = details::get_file_name("volume_compaction_" + std::to_string(engine) +
+                                                          (use_wal ? "_wal" : ""));
+                btree::Storage<int, std::string> s;
+                auto reopen = [&](auto&& fn) {
+                    auto v = s.open_volume(path, order, engine, use_wal);
+                    fn(v);
+                    s.close_volume(v);
+                    return fs::file_size(path);
+                };
+                auto check = [&](auto& v) {
+                    for (int i = 0; i < n; ++i)
+                        success &= (v.get(i) == ((i % 3 == 0) ? std::optional(value_of(i)) : std::nullopt));
+                };
+
+                auto fragmented_size = reopen([&](auto& v) {
+                    for (int i = n - 1; i >= 0; --i)
+                        v.set(i, value_of(i));
+                    for (int i = 0; i < n; ++i)
+                        if (i % 3 != 0)
+                            v.remove(i);
+                });
+                auto compacted_size = reopen([&](auto& v) {
+                    success &= (v.compact() > 0);
+                    check(v);
+                    // the compacted volume is modified as usual
+                    v.set(n, value_of(n));
+                    success &= v.remove(n);
+                });
+                success &= (compacted_size < fragmented_size);
+                reopen(check);
+            }
+        }
+        return success;
+    }
+
+    bool test_volume_compaction_mt() {
+        const auto& path = details::get_file_name("volume_compaction_mt");
+        const int threads_count = 4;
+        const int n = 2000;
+        bool success = true;
+        {
+            btree::StorageMT<int, int> s;
+            auto v = s.open_volume(path, order, btree::BPLUS_TREE, true);
+            for (int i = 0; i < threads_count * n; ++i)
+                v.set(i, i);
+
+            // the compaction copies the volume slowly while the writers modify it
+            auto reclaimed = v.compact_async(threads_count * n * 2 * sizeof(int));
+            std::vector<std::thread> threads;
+            for (int t = 0; t < threads_count; ++t) {
+                threads.emplace_back([&v, t]() {
+                    for (int i = t * n; i < (t + 1) * n; ++i)
+                        v.set(i, -i);
+                    for (int i = t * n; i < (t + 1) * n; i += 2)
+                        v.remove(i);
+                });
+            }
+            for (auto& thread: threads)
+                thread.join();
+            reclaimed.get();
+
+            for (int i = 0; i < threads_count * n; ++i)
+                success &= (v.get(i) == ((i % 2) ? std::optional(-i) : std::nullopt));
+        }
+        btree::Storage<int, int> s;
+        auto v = s.open_volume(path, order, btree::BPLUS_TREE);
+        for (int i = 0; i < threads_count * n; ++i)
+            success &= (v.get(i) == ((i % 2) ? std::optional(-i) : std::nullopt));
+        return success;
+    }
+
+    bool test_volume_optimistic_reclamation() {
+        const auto& path = details::get_file_name("volume_optimistic_reclamation");
+        const int readers_count = 3;
+        const int n = 20000;
+        bool success = true;
+        btree::StorageMT<int, int> s;
+        auto v = s.open_volume(path, order, btree::BPLUS_TREE, false, btree::OPTIMISTIC_LOCK_COUPLING);
+        std::atomic<bool> is_writing = true;
+        std::vector<std::thread> readers;
+        for (int t = 0; t < readers_count; ++t) {
+            readers.emplace_back([&]() {
+                for (int i = 0; is_writing; i = (i + 1) % n)
+                    v.get(i);
+            });
+        }
+        // the file is remapped on every growth, then it's replaced by the compaction
+        for (int i = 0; i < n; ++i)
+            v.set(i, i);
+        for (int i = 0; i < n; i += 2)
+            v.remove(i);
+        success &= (v.compact() > 0);
+        is_writing = false;
+        for (auto& reader: readers)
+            reader.join();
+
+        // the readers have left: the next writes free the replaced mappings and files
+        v.set(0, 0);
+        v.set(1, 1);
+        if (fs::exists("/proc/self/maps"))
+            success &= (details::count_mappings(path) == 1);
+        for (int i = 1; i < n; i += 2)
+            success &= (v.get(i) == i);
+        return success;
+    }
+
+    bool test_volume_snapshot() {
+        const int n = 2000;
+        auto value_of = [](const int i) { return std::string(i % 7 + 1, static_cast<char>('a' + i % 26)); };
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_snapshot_" + std::to_string(engine));
+            btree::Storage<int, std::string> s;
+            auto v = s.open_volume(path, order, engine);
+            for (int i = 0; i < n; ++i)
+                v.set(i, value_of(i));
+            int64_t size_with_snapshot = 0;
+            {
+                auto snapshot = v.snapshot();
+                // the splits, merges and the empty tree don't change the snapshot
+                for (int i = 0; i < n; ++i)
+                    v.set(i, value_of(i + 1));
+                for (int i = 0; i < n; ++i)
+                    v.remove(i);
+                success &= !v.exist(0);
+                for (int i = n; i < 2 * n; ++i)
+                    v.set(i, value_of(i));
+
+                for (int i = 0; i < 2 * n; ++i)
+                    success &= (snapshot.get(i) == ((i < n) ? std::optional(value_of(i)) : std::nullopt));
+                int expected_key = n / 2;
+                auto count = snapshot.scan(n / 2, 3 * n / 2, [&](const int key, const std::string& val) {
+                    success &= (key == expected_key && val == value_of(key));
+                    ++expected_key;
+                });
+                success &= (count == n / 2);
+                size_with_snapshot = fs::file_size(path);
+            }
+            // the space kept for the released snapshot is reused
+            for (int i = n; i < 2 * n; ++i)
+                v.set(i, value_of(i + 1));
+            for (int i = n; i < 2 * n; ++i)
+                success &= (v.get(i) == value_of(i + 1));
+            success &= (static_cast<int64_t>(fs::file_size(path)) <= size_with_snapshot);
+        }
+        return success;
+    }
+
+    bool test_volume_get_view() {
+        const int n = 1000;
+        auto value_of = [](const int i) { return std::string(i % 7 + 1, static_cast<char>('a' + i % 26)); };
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_get_view_" + std::to_string(engine));
+            btree::Storage<int, std::string> s;
+            auto v = s.open_volume(path, order, engine);
+            for (int i = 0; i < n; ++i)
+                v.set(i, value_of(i));
+            success &= !v.get_view(n).has_value();
+
+            std::vector<btree::ValueView<std::string>> views;
+            for (int i = 0; i < n; ++i)
+                views.push_back(v.get_view(i));
+            // the file is remapped and the freed entries aren't reused while the views are alive
+            for (int i = 0; i < n; ++i)
+                v.remove(i);
+            for (int i = 0; i < 10 * n; ++i)
+                v.set(i, value_of(i + 1));
+            for (int i = 0; i < n; ++i)
+                success &= (views[i].value() == value_of(i));
+
+            views.clear();
+            auto size = fs::file_size(path);
+            for (int i = 0; i < 10 * n; ++i)
+                v.set(i, value_of(i));
+            for (int i = 0; i < 10 * n; ++i)
+                success &= (v.get_view(i).value() == value_of(i));
+            success &= (fs::file_size(path) == size);
+        }
+        return success;
+    }
+
+    bool test_volume_windowed_mapping() {
+        const int n = 5000;
+        auto value_of = [](const int i) { return std::string(i % 50 + 1, static_cast<char>('a' + i % 26)); };
+        auto mapping = btree::MappingOptions::windowed(64 * 1024, 256 * 1024);
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_windowed_mapping_" + std::to_string(engine));
+            btree::Storage<int, std::string> s;
+            auto reopen = [&](auto&& fn) {
+                auto v = s.open_volume(path, order, engine, false, btree::COARSE_LOCK, mapping);
+                fn(v);
+                s.close_volume(v);
+            };
+            auto check = [&](auto& v) {
+                for (int i = 0; i < n; ++i)
+                    success &= (v.get(i) == ((i % 2) ? std::optional(value_of(i)) : std::nullopt));
+                int expected_key = 1;
+                v.scan(0, n, [&](const int key, const std::string& value) {
+                    success &= (key == expected_key && value == value_of(key));
+                    expected_key += 2;
+                });
+                success &= (expected_key == n + 1);
+            };
+
+            reopen([&](auto& v) {
+                for (int i = n - 1; i >= 0; --i)
+                    v.set(i, value_of(i));
+                for (int i = 0; i < n; i += 2)
+                    v.remove(i);
+                check(v);
+                auto view = v.get_view(1);
+                for (int i = n; i < 2 * n; ++i)
+                    v.set(i, value_of(i));
+                success &= (view.value() == value_of(1));
+                for (int i = n; i < 2 * n; ++i)
+                    v.remove(i);
+                // the snapshots read the whole mapping without the lock
+                try {
+                    v.snapshot();
+                    success = false;
+                } catch (const std::logic_error&) {}
+            });
+            reopen([&](auto& v) {
+                success &= (v.compact() > 0);
+                check(v);
+            });
+            reopen(check);
+        }
+        return success;
+    }
+
+    bool test_volume_buffer_pool() {
+        const int n = 5000;
+        auto value_of = [](const int i) { return std::string(i % 50 + 1, static_cast<char>('a' + i % 26)); };
+        auto mapping = btree::MappingOptions::buffer_pool(128 * 1024, 4096, true);
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_buffer_pool_" + std::to_string(engine));
+            btree::StorageMT<int, std::string> s;
+            auto check = [&](auto& v) {
+                for (int i = 0; i < n; ++i)
+                    success &= (v.get(i) == ((i % 2) ? std::optional(value_of(i)) : std::nullopt));
+            };
+            {
+                auto v = s.open_volume(path, order, engine, false, btree::COARSE_LOCK, mapping);
+                for (int i = n - 1; i >= 0; --i)
+                    v.set(i, value_of(i));
+                for (int i = 0; i < n; i += 2)
+                    v.remove(i);
+                check(v);
+                // the pinned value isn't evicted while the frames over the budget are
+                auto view = v.get_view(1);
+                for (int i = n; i < 2 * n; ++i)
+                    v.set(i, value_of(i));
+                success &= (view.value() == value_of(1));
+                view = {};
+                for (int i = n; i < 2 * n; ++i)
+                    v.remove(i);
+                v.checkpoint();
+                s.close_volume(v);
+            }
+            {
+                // the file written by the pool is read by the mapping
+                auto v = s.open_volume(path, order, engine);
+                check(v);
+                s.close_volume(v);
+            }
+            // the lock-free readers read the whole mapping
+            try {
+                s.open_volume(path, order, engine, false, btree::OPTIMISTIC_LOCK_COUPLING, mapping);
+                success = false;
+            } catch (const std::logic_error&) {}
+        }
+        return success;
+    }
+
+    bool test_volume_transient_blobs() {
+        const int n = 2000;
+        const int32_t size = 512;
+        auto blob_of = [size](const int i) { return std::vector<char>(size, static_cast<char>('a' + i % 26)); };
+        bool success = true;
+        for (const auto& [suffix, mapping]: std::initializer_list<std::pair<std::string, btree::MappingOptions>> {
+            { "_windowed", btree::MappingOptions::windowed(64 * 1024, 256 * 1024) },
+            { "_buffer_pool", btree::MappingOptions::buffer_pool(128 * 1024, 4096) } }) {
+            const auto& path = details::get_file_name("volume_transient_blobs" + suffix);
+            btree::StorageMT<int, const char*> s;
+            auto v = s.open_volume(path, order, btree::BTREE, false, btree::COARSE_LOCK, mapping);
+            for (int i = 0; i < n; ++i)
+                v.set(i, blob_of(i).data(), size);
+            // the blob outlives the windows or the frames it's read from: the written blobs exceed the budget
+            for (int i = 0; i < n; i += 400) {
+                auto blob = v.get(i);
+                for (int j = n; j < 2 * n; ++j)
+                    v.set(j, blob_of(j).data(), size);
+                success &= blob.has_value() && (std::memcmp(*blob, blob_of(i).data(), size) == 0);
+            }
+            try {
+                v.async_get(0);
+                success = false;
+            } catch (const std::logic_error&) {}
+            s.close_volume(v);
+        }
+        return success;
+    }
+
+    bool test_volume_io_uring() {
+        const int n = 5000;
+        auto value_of = [](const int i) { return std::string((i % 100 == 0) ? 10000 : i % 50 + 1, static_cast<char>('a' + i % 26)); };
+        auto with_io_uring = [](btree::MappingOptions mapping) {
+            // the small queue is submitted many times by a batch
+            mapping.io_uring_depth = 4;
+            return mapping;
+        };
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            for (const auto& mapping: { with_io_uring(btree::MappingOptions::buffer_pool(256 * 1024, 4096)),
+                                        with_io_uring(btree::MappingOptions::buffer_pool(256 * 1024, 4096, true)) }) {
+                const auto& path = details::get_file_name("volume_io_uring_" + std::to_string(engine));
+                btree::StorageMT<int, std::string> s;
+                auto v = s.open_volume(path, order, engine, false, btree::COARSE_LOCK, mapping);
+                for (int i = 0; i < n; ++i)
+                    v.set(i, value_of(i));
+                for (int i = 0; i < n; i += 2)
+                    v.remove(i);
+
+                auto check = [&]() {
+                    // unsorted batch with absent keys and duplicates
+                    std::vector<int> keys;
+                    for (int i = 2 * n; i >= -10; i -= 3)
+                        keys.push_back(i);
+                    keys.push_back(1);
+                    keys.push_back(1);
+                    v.prefetch(keys);
+                    auto values = v.multi_get(keys);
+                    auto exist = v.multi_exist(keys);
+                    for (size_t i = 0; i < keys.size(); ++i) {
+                        bool expected = keys[i] > 0 && keys[i] < n && keys[i] % 2;
+                        success &= (values.has_value(i) == expected) && (exist[i] == expected);
+                        if (expected)
+                            success &= (values[i] == value_of(keys[i]));
+                    }
+                };
+                check();
+                // the compacted file is read by its own ring
+                success &= (v.compact() > 0);
+                check();
+                s.close_volume(v);
+                std::filesystem::remove(path);
+            }
+        }
+        return success;
+    }
+
+    bool test_volume_async_operations() {
+        const int n = 2000;
+        auto value_of = [](const int i, const int version) { return std::to_string(i) + "_" + std::to_string(version); };
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_async_operations_" + std::to_string(engine));
+            const auto& blob_path = details::get_file_name("volume_async_operations_blob_" + std::to_string(engine));
+            btree::StorageMT<int, std::string> s;
+            btree::StorageMT<int, const char*> blob_s;
+            auto v = s.open_volume(path, order, engine);
+            auto blob_v = blob_s.open_volume(blob_path, order, engine);
+
+            // the operations of a volume are run in order: every get sees the set issued before it
+            std::vector<std::future<std::optional<std::string>>> gets;
+            std::vector<std::future<bool>> removes;
+            for (int i = 0; i < n; ++i) {
+                for (int version = 0; version < 3; ++version) {
+                    v.async_set(i, value_of(i, version));
+                    gets.push_back(v.async_get(i));
+                }
+                if (i % 3 == 0)
+                    removes.push_back(v.async_remove(i));
+                // the blob is copied, the source is destroyed before the set is run
+                auto blob = value_of(i, 0);
+                blob_v.async_set(i, blob.data(), static_cast<int32_t>(blob.size()));
+            }
+            for (int i = 0; i < n; ++i)
+                for (int version = 0; version < 3; ++version)
+                    success &= (gets[3 * i + version].get() == value_of(i, version));
+            for (auto& removed: removes)
+                success &= removed.get();
+            success &= (v.async_get(0).get() == std::nullopt) && !v.async_remove(0).get();
+            for (int i = 0; i < n; ++i)
+                success &= (v.get(i) == ((i % 3) ? std::optional(value_of(i, 2)) : std::nullopt));
+
+            // the queued operations are finished when the volume is closed
+            for (int i = 0; i < n; ++i)
+                v.async_set(n + i, value_of(i, 3));
+            s.close_volume(v);
+            blob_s.close_volume(blob_v);
+            auto reopened = s.open_volume(path, order, engine);
+            auto reopened_blob = blob_s.open_volume(blob_path, order, engine);
+            for (int i = 0; i < n; ++i) {
+                success &= (reopened.get(n + i) == value_of(i, 3));
+                auto blob = reopened_blob.get_view(i);
+                success &= blob.has_value() && (std::string(blob.value()) == value_of(i, 0));
+            }
+        }
+        return success;
+    }
+
+    bool test_volume_write_batch() {
+        const int n = 3000;
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            for (const auto& mapping: { btree::MappingOptions(), btree::MappingOptions::buffer_pool(256 * 1024, 4096) }) {
+                const auto& path = details::get_file_name("volume_write_batch_" + std::to_string(engine));
+                const auto& crashed_path = details::get_file_name("volume_write_batch_crashed_" + std::to_string(engine));
+                std::map<int, std::string> expected;
+                {
+                    btree::StorageMT<int, std::string> s;
+                    auto v = s.open_volume(path, order, engine, true, btree::COARSE_LOCK, mapping);
+                    // the keys aren't sorted, the last operation of a key wins
+                    btree::WriteBatch<int, std::string> batch;
+                    for (int i = 0; i < n; ++i) {
+                        auto k = (i * 7919) % n;
+                        batch.set(k, "old");
+                        batch.set(k, std::to_string(k));
+                        expected[k] = std::to_string(k);
+                    }
+                    v.write(batch);
+                    v.checkpoint();
+                    fs::copy_file(path, crashed_path, fs::copy_options::overwrite_existing);
+
+                    batch.clear();
+                    for (int i = 0; i < n; i += 2) {
+                        batch.remove(i);
+                        expected.erase(i);
+                    }
+                    for (int i = n; i < n + n / 2; ++i) {
+                        batch.set(i, std::to_string(i));
+                        expected[i] = std::to_string(i);
+                    }
+                    batch.remove(-1);
+                    v.write(batch);
+                    for (int i = -1; i < n + n / 2; ++i)
+                        success &= (v.get(i) == (expected.count(i) ? std::optional(expected[i]) : std::nullopt));
+
+                    // the batch is one record in the log: it's torn as a whole
+                    auto wal_size = fs::file_size(path + ".wal");
+                    fs::copy_file(path + ".wal", crashed_path + ".wal", fs::copy_options::overwrite_existing);
+                    fs::resize_file(crashed_path + ".wal", wal_size - 1);
+                }
+                {
+                    btree::Storage<int, std::string> s;
+                    auto v = s.open_volume(crashed_path, order, engine, true, btree::COARSE_LOCK, mapping);
+                    for (int i = 0; i < n + n / 2; ++i)
+                        success &= (v.get(i) == ((i < n) ? std::optional(std::to_string(i)) : std::nullopt));
+                }
+                {
+                    btree::Storage<int, std::string> s;
+                    auto v = s.open_volume(path, order, engine, true, btree::COARSE_LOCK, mapping);
+                    for (int i = 0; i < n + n / 2; ++i)
+                        success &= (v.get(i) == (expected.count(i) ? std::optional(expected[i]) : std::nullopt));
+
+                    // the deferred nodes are dropped with the emptied tree
+                    btree::WriteBatch<int, std::string> batch;
+                    for (const auto& [k, value]: expected)
+                        batch.remove(k);
+                    batch.set(0, "0");
+                    v.write(batch);
+                    success &= (v.get(0) == "0") && (v.get(1) == std::nullopt);
+                }
+            }
+        }
+
+        // the keys of the legacy nodes are read from the entries
+        const auto& legacy_path = details::get_file_name("volume_write_batch_legacy");
+        details::write_legacy_volume(legacy_path);
+        details::StorageT s;
+        auto v = s.open_volume(legacy_path, order);
+        btree::WriteBatch<int, int> batch;
+        for (int i = 1; i < 100; ++i)
+            batch.set(i, -i);
+        v.write(batch);
+        success &= (v.get(key) == value);
+        for (int i = 1; i < 100; ++i)
+            success &= (v.get(i) == -i);
+        return success;
+    }
+
+    bool test_volume_write_batch_rollback() {
+        const int n = 2000;
+        const int modified = 400;
+        auto value_of = [](const int i, const int version) { return std::to_string(i) + "_" + std::to_string(version); };
+        bool success = true;
+        for (bool use_wal: { false, true }) {
+            const auto& path = details::get_file_name("volume_write_batch_rollback_" + std::to_string(use_wal));
+            auto open = [&](btree::Storage<int, std::string>& s) {
+                return s.open_volume(path, order, btree::PACKED_BPLUS_TREE, use_wal, btree::COARSE_LOCK,
+                                     btree::MappingOptions(), btree::NO_COMPRESSION, true);
+            };
+            {
+                btree::Storage<int, std::string> s;
+                auto v = open(s);
+                for (int i = 0; i < n; i += 2)
+                    v.set(i, value_of(i, 0));
+            }
+            // the width of the deltas of the last leaf follows FLAG, USED_KEYS, PREV, NEXT and BASE_KEY
+            int64_t width_pos;
+            {
+                btree::IOManager<int, std::string> io(path, order, btree::PACKED_BPLUS_TREE);
+                auto pos = io.read_header();
+                for (auto node = io.read_bplus_node(pos); !node.is_leaf; node = io.read_bplus_node(pos))
+                    pos = node.child_pos[node.used_keys];
+                width_pos = pos + 1 + sizeof(int16_t) + 2 * sizeof(int64_t) + sizeof(int);
+            }
+            auto write_width = [&](const char width) {
+                std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+                file.seekp(width_pos);
+                file.write(&width, 1);
+            };
+
+            btree::Storage<int, std::string> s;
+            auto v = open(s);
+            char width;
+            {
+                std::ifstream file(path, std::ios::binary);
+                file.seekg(width_pos);
+                file.read(&width, 1);
+            }
+            // the file is mapped: the corrupted leaf is read by the volume
+            write_width(0);
+
+            // the nodes are split, the entries are written and freed before the batch reaches the last leaf
+            btree::WriteBatch<int, std::string> batch;
+            for (int i = 0; i < modified; ++i) {
+                if (i % 4 == 0)
+                    batch.remove(i);
+                else
+                    batch.set(i, value_of(i, 1));
+            }
+            batch.set(n + 1, value_of(n + 1, 1));
+            try {
+                v.write(batch);
+                success = false;
+            } catch (const std::logic_error& e) {
+                std::string_view err_msg = e.what();
+                success &= err_msg.find(error_msg::wrong_node_msg) != std::string_view::npos;
+            }
+            // nothing of the batch is applied, the removed keys are in the filter again
+            for (int i = 0; i < modified; ++i)
+                success &= (v.get(i) == ((i % 2 == 0) ? std::optional(value_of(i, 0)) : std::nullopt));
+
+            // the restored free space and tree are written by the next batch
+            batch.clear();
+            for (int i = 1; i < modified; i += 2)
+                batch.set(i, value_of(i, 2));
+            v.write(batch);
+            for (int i = 0; i < modified; ++i)
+                success &= (v.get(i) == value_of(i, (i % 2 == 0) ? 0 : 2));
+            write_width(width);
+            s.close_volume(v);
+
+            auto reopened = open(s);
+            for (int i = 0; i < n; ++i) {
+                auto expected = (i % 2 == 0) ? std::optional(value_of(i, 0)) : std::nullopt;
+                if (i < modified && i % 2 == 1)
+                    expected = value_of(i, 2);
+                success &= (reopened.get(i) == expected);
+            }
+            success &= (reopened.get(n + 1) == std::nullopt);
+        }
+        return success;
+    }
+
+    bool test_volume_access_hints() {
+        const int n = 5000;
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            for (const auto& mapping: { btree::MappingOptions(), btree::MappingOptions::reserved(),
+                                        btree::MappingOptions::windowed(64 * 1024, 256 * 1024),
+                                        btree::MappingOptions::buffer_pool(256 * 1024, 4096) }) {
+                const auto& path = details::get_file_name("volume_access_hints_" + std::to_string(engine));
+                btree::StorageMT<int, int64_t> s;
+                auto v = s.open_volume(path, order, engine, false, btree::COARSE_LOCK, mapping);
+                v.advise(btree::RANDOM);
+                for (int i = 0; i < n; ++i)
+                    v.set(i, 3 * i);
+                for (int i = 0; i < n; i += 2)
+                    v.remove(i);
+
+                // unsorted batch with absent keys and duplicates
+                std::vector<int> keys;
+                for (int i = 2 * n; i >= -10; i -= 7)
+                    keys.push_back(i);
+                keys.push_back(1);
+                keys.push_back(1);
+                v.prefetch(keys);
+                v.prefetch({});
+                for (auto key: keys) {
+                    bool expected = key > 0 && key < n && key % 2;
+                    success &= (v.get(key) == (expected ? std::optional<int64_t>(3 * key) : std::nullopt));
+                }
+
+                v.advise(btree::SEQUENTIAL);
+                int64_t expected_key = 1;
+                v.scan(0, n, [&](const int key, const int64_t value) {
+                    success &= (key == expected_key && value == 3 * key);
+                    expected_key += 2;
+                });
+                success &= (expected_key == n + 1);
+
+                // the pattern is kept for the compacted file
+                v.advise(btree::WILLNEED);
+                success &= (v.compact() > 0);
+                for (int i = 0; i < n; ++i)
+                    success &= (v.get(i) == ((i % 2) ? std::optional<int64_t>(3 * i) : std::nullopt));
+                s.close_volume(v);
+                std::filesystem::remove(path);
+            }
+        }
+        return success;
+    }
+
+    bool test_volume_node_alignment() {
+        const int n = 20000;
+        const int64_t page_size = m_boost::bip::mapped_region::get_page_size();
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+            for (int16_t node_order: { int16_t(2), int16_t(50), int16_t(100) }) {
+                const auto& path = details::get_file_name("volume_node_alignment_" + std::to_string(engine));
+                const auto& loaded_path = path + ".loaded";
+                {
+                    btree::Storage<int, int> s;
+                    auto v = s.open_volume(path, node_order, engine);
+                    for (int i = 0; i < n; ++i)
+                        v.set((i * 7919) % n, i);
+                    for (int i = 0; i < n; i += 3)
+                        v.remove(i);
+                }
+                {
+                    btree::bulk::BulkLoader<int, int> loader(loaded_path, node_order, engine);
+                    for (int i = 0; i < n; ++i)
+                        loader.add(i, i);
+                    loader.finish();
+                }
+
+                // every node is in its own slot and doesn't straddle the pages
+                auto node_size = btree::BTreeNode<int, int>::get_node_size_in_bytes(node_order);
+                auto slot_size = btree::IOManager<int, int>::get_node_slot_size(node_order);
+                auto is_aligned = [&](const int64_t pos) {
+                    return (pos % std::min<int64_t>(slot_size, page_size) == 0) &&
+                           (node_size > page_size || pos / page_size == (pos + node_size - 1) / page_size);
+                };
+                for (const auto& file: { path, loaded_path }) {
+                    btree::IOManager<int, int> io(file, node_order, engine);
+                    std::vector<int64_t> nodes{ io.read_header() };
+                    int64_t visited = 0;
+                    while (!nodes.empty()) {
+                        auto pos = nodes.back();
+                        nodes.pop_back();
+                        success &= is_aligned(pos);
+                        ++visited;
+                        auto push_children = [&nodes](const auto& node) {
+                            for (int i = 0; !node.is_leaf && i <= node.used_keys; ++i)
+                                nodes.push_back(node.child_pos[i]);
+                        };
+                        if (engine == btree::BPLUS_TREE)
+                            push_children(io.read_bplus_node(pos));
+                        else
+                            push_children(io.read_node(pos));
+                    }
+                    success &= (visited > 1);
+                }
+                fs::remove(path);
+                fs::remove(loaded_path);
+            }
+        }
+        return success;
+    }
+
     bool test_volume_is_not_shared() {
         const auto& path = details::get_file_name("volume_is_not_shared");
         bool success = false;
@@ -117,5 +1144,477 @@ namespace details {
         return success;
     }
 
+
+    bool test_volume_packed_keys() {
+        const int64_t n = 20000;
+        const int packed_order = 50;
+        // the keys are spread, but the keys of a node are close to each other, the extreme keys are far from all
+        auto key_of = [](const int64_t i) { return i * 1000 + i % 7; };
+        const int64_t extreme_keys[] = { std::numeric_limits<int64_t>::min(), -1, std::numeric_limits<int64_t>::max() };
+        bool success = true;
+        std::map<btree::EngineType, uintmax_t> compacted_sizes;
+        for (auto engine: { btree::BPLUS_TREE, btree::PACKED_BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_packed_keys_" + std::to_string(engine));
+            std::map<int64_t, int64_t> expected;
+            btree::Storage<int64_t, int64_t> s;
+            {
+                auto v = s.open_volume(path, packed_order, engine);
+                for (int64_t i = 0; i < n; ++i) {
+                    auto k = key_of((i * 7919) % n);
+                    v.set(k, -k);
+                    expected[k] = -k;
+                }
+                for (auto k: extreme_keys) {
+                    v.set(k, k / 2);
+                    expected[k] = k / 2;
+                }
+                for (int64_t i = 0; i < n; i += 3) {
+                    success &= v.remove(key_of(i));
+                    expected.erase(key_of(i));
+                }
+                success &= !v.remove(key_of(0));
+
+                {
+                    auto snapshot = v.snapshot();
+                    v.set(key_of(0), 0);
+                    success &= (snapshot.get(key_of(0)) == std::nullopt) && (v.get(key_of(0)) == 0);
+                    success &= v.remove(key_of(0));
+                }
+                success &= (v.compact() > 0);
+                s.close_volume(v);
+                compacted_sizes[engine] = fs::file_size(path);
+            }
+
+            auto v = s.open_volume(path, packed_order, engine);
+            for (int64_t i = -1; i <= n; ++i)
+                success &= (v.get(key_of(i)) == (expected.count(key_of(i)) ? std::optional(expected[key_of(i)]) : std::nullopt));
+            for (auto k: extreme_keys)
+                success &= (v.get(k) == k / 2) && !v.exist(k + (k < 0 ? 1 : -1));
+
+            // the keys are read in order, the searches land between the keys of a node
+            auto c = v.cursor();
+            auto it = expected.begin();
+            for (bool valid = c.seek_to_first(); valid && it != expected.end(); valid = c.next(), ++it)
+                success &= (c.key() == it->first);
+            success &= (it == expected.end()) && !c.next();
+            success &= c.seek(key_of(n / 2) + 1) && (c.key() == expected.upper_bound(key_of(n / 2))->first);
+
+            std::vector<int64_t> keys;
+            for (int64_t i = 0; i < 1000; ++i)
+                keys.push_back(key_of(i) + i % 2);
+            auto found = v.multi_get(keys);
+            for (size_t i = 0; i < keys.size(); ++i)
+                success &= (found.has_value(i) == (expected.count(keys[i]) > 0));
+
+            for (const auto& [k, value]: expected)
+                success &= v.remove(k);
+            success &= (v.get(key_of(1)) == std::nullopt);
+        }
+        success &= (compacted_sizes[btree::PACKED_BPLUS_TREE] < compacted_sizes[btree::BPLUS_TREE]);
+
+        // the deltas of a node cross the bytes at every width, the widest ones are written in 64 bits
+        {
+            const auto& path = details::get_file_name("volume_packed_bits");
+            btree::Storage<int64_t, int64_t> s;
+            auto v = s.open_volume(path, packed_order, btree::PACKED_BPLUS_TREE);
+            std::map<int64_t, int64_t> expected;
+            for (int shift: { 0, 3, 9, 25, 50, 51, 56 }) {
+                for (int64_t j = 0; j < 128; ++j) {
+                    auto k = (j << shift) + shift;
+                    v.set(k, j);
+                    expected[k] = j;
+                }
+            }
+            for (const auto& [k, value]: expected)
+                success &= (v.get(k) == value) && !v.exist(k + 1000003);
+            success &= (v.compact() > 0);
+            auto c = v.cursor();
+            auto it = expected.begin();
+            for (bool valid = c.seek_to_first(); valid && it != expected.end(); valid = c.next(), ++it)
+                success &= (c.key() == it->first) && (c.value() == it->second);
+            success &= (it == expected.end());
+        }
+
+        // the packed nodes aren't read by the plain engine
+        const auto& path = details::get_file_name("volume_packed_keys_" + std::to_string(btree::PACKED_BPLUS_TREE));
+        {
+            btree::Storage<int64_t, int64_t> s;
+            auto v = s.open_volume(path, packed_order, btree::PACKED_BPLUS_TREE);
+            v.set(key, value);
+        }
+        try {
+            btree::Storage<int64_t, int64_t> s;
+            s.open_volume(path, packed_order, btree::BPLUS_TREE);
+            success = false;
+        } catch (const std::logic_error& e) {
+            std::string_view err_msg = e.what();
+            success &= err_msg.find(error_msg::wrong_engine_msg) != std::string_view::npos;
+        }
+        return success;
+    }
+
+    bool test_volume_value_compression() {
+        const int n = 3000;
+        // JSON-like values compress well, the short ones are below the compression threshold
+        auto value_of = [](const int i) {
+            if (i % 5 == 0)
+                return std::string(i % 40 + 1, static_cast<char>('a' + i % 26));
+            std::string value = "{\"id\": " + std::to_string(i) + ", \"items\": [";
+            for (int j = 0; j < i % 20 + 2; ++j)
+                value += "{\"name\": \"item_" + std::to_string(j) + "\", \"state\": \"active\"},";
+            return value + "]}";
+        };
+        bool success = true;
+        std::map<btree::Compression, uintmax_t> sizes;
+        for (auto compression: { btree::NO_COMPRESSION, btree::ZLIB_COMPRESSION, btree::LZ_COMPRESSION }) {
+            for (auto engine: { btree::BTREE, btree::BPLUS_TREE }) {
+                const auto& path = details::get_file_name("volume_value_compression_" + std::to_string(compression) +
+                                                          "_" + std::to_string(engine));
+                btree::Storage<int, std::string> s;
+                {
+                    auto v = s.open_volume(path, order, engine, false, btree::COARSE_LOCK, btree::MappingOptions(),
+                                           compression);
+                    for (int i = 0; i < n; ++i)
+                        v.set(i, value_of(i));
+                    // the compressed entries are freed and reused
+                    for (int i = 0; i < n; i += 2)
+                        success &= v.remove(i);
+                    for (int i = 0; i < n; i += 4)
+                        v.set(i, value_of(i + 1));
+
+                    {
+                        auto snapshot = v.snapshot();
+                        v.set(1, value_of(2));
+                        success &= (snapshot.get(1) == value_of(1)) && (v.get(1) == value_of(2));
+                        v.set(1, value_of(1));
+                    }
+                    success &= (v.compact() > 0);
+                    s.close_volume(v);
+                    sizes[compression] = fs::file_size(path);
+                }
+
+                auto v = s.open_volume(path, order, engine, false, btree::COARSE_LOCK, btree::MappingOptions(),
+                                       compression);
+                auto expected = [&](const int i) {
+                    return i % 4 == 0 ? std::optional(value_of(i + 1)) : i % 2 == 0 ? std::nullopt : std::optional(value_of(i));
+                };
+                for (int i = 0; i < n; ++i) {
+                    auto view = v.get_view(i);
+                    success &= (v.get(i) == expected(i)) && (view.has_value() == expected(i).has_value());
+                    success &= !view.has_value() || (view.value() == *expected(i));
+                }
+
+                std::vector<int> keys(n);
+                std::iota(keys.begin(), keys.end(), 0);
+                auto found = v.multi_get(keys);
+                for (int i = 0; i < n; ++i)
+                    success &= (found.has_value(i) ? std::optional(std::string(found[i])) : std::nullopt) == expected(i);
+
+                auto c = v.cursor();
+                int count = 0;
+                for (bool valid = c.seek_to_first(); valid; valid = c.next(), ++count)
+                    success &= (c.value() == expected(c.key()));
+                success &= (count == n - n / 4);
+            }
+        }
+        success &= (sizes[btree::ZLIB_COMPRESSION] < sizes[btree::NO_COMPRESSION] / 2);
+        success &= (sizes[btree::LZ_COMPRESSION] < sizes[btree::NO_COMPRESSION] / 2);
+
+        const auto& path = details::get_file_name("volume_value_compression_wstring");
+        {
+            btree::Storage<int, std::wstring> s;
+            auto v = s.open_volume(path, order, btree::BTREE, false, btree::COARSE_LOCK, btree::MappingOptions(),
+                                   btree::LZ_COMPRESSION);
+            for (int i = 0; i < n; ++i)
+                v.set(i, std::wstring(i % 100 + 1, L'x') + std::to_wstring(i));
+            for (int i = 0; i < n; ++i)
+                success &= (v.get(i) == std::wstring(i % 100 + 1, L'x') + std::to_wstring(i));
+        }
+        // the codec is recorded in the header
+        try {
+            btree::Storage<int, std::wstring> s;
+            s.open_volume(path, order, btree::BTREE, false, btree::COARSE_LOCK, btree::MappingOptions(),
+                          btree::ZLIB_COMPRESSION);
+            success = false;
+        } catch (const std::logic_error& e) {
+            std::string_view err_msg = e.what();
+            success &= err_msg.find(error_msg::wrong_compression_msg) != std::string_view::npos;
+        }
+        // the values of the other types aren't compressed
+        try {
+            btree::Storage<int, int> s;
+            s.open_volume(details::get_file_name("volume_value_compression_int"), order, btree::BTREE, false,
+                          btree::COARSE_LOCK, btree::MappingOptions(), btree::ZLIB_COMPRESSION);
+            success = false;
+        } catch (const std::logic_error& e) {
+            std::string_view err_msg = e.what();
+            success &= err_msg.find(error_msg::compressed_values_msg) != std::string_view::npos;
+        }
+        return success;
+    }
+
+    bool test_volume_inline_values() {
+        const int n = 5000;
+        // -1 is the invalid position, but an inline value takes any bits
+        auto value_of = [](const int i) { return i % 3 == 0 ? int64_t(-1) : std::numeric_limits<int64_t>::min() + i; };
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE, btree::PACKED_BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_inline_values_" + std::to_string(engine));
+            {
+                btree::StorageMT<int, int64_t> s;
+                auto v = s.open_volume(path, order, engine, false, btree::OPTIMISTIC_LOCK_COUPLING);
+                for (int i = 0; i < n; ++i)
+                    v.set(i, value_of(i));
+                success &= v.exist(0) && (v.get(0) == -1) && !v.exist(n) && (v.get(n) == std::nullopt);
+
+                // the values are updated in their nodes, nothing is allocated
+                auto size = fs::file_size(path);
+                for (int i = 0; i < n; ++i)
+                    v.set(i, value_of(i) + 1);
+                success &= (fs::file_size(path) == size);
+
+                {
+                    auto snapshot = v.snapshot();
+                    for (int i = 0; i < n; i += 2)
+                        success &= v.remove(i);
+                    for (int i = 0; i < n; ++i)
+                        success &= (snapshot.get(i) == value_of(i) + 1);
+                }
+                success &= (v.compact() > 0);
+            }
+
+            btree::Storage<int, int64_t> s;
+            auto v = s.open_volume(path, order, engine);
+            auto expected = [&](const int i) { return i % 2 == 0 ? std::nullopt : std::optional(value_of(i) + 1); };
+            for (int i = 0; i < n; ++i)
+                success &= (v.get(i) == expected(i)) && (v.exist(i) == expected(i).has_value());
+
+            std::vector<int> keys(n);
+            std::iota(keys.begin(), keys.end(), 0);
+            auto found = v.multi_get(keys);
+            for (int i = 0; i < n; ++i)
+                success &= (found.has_value(i) ? std::optional(found[i]) : std::nullopt) == expected(i);
+
+            auto c = v.cursor();
+            int count = 0;
+            for (bool valid = c.seek_to_first(); valid; valid = c.next(), ++count)
+                success &= (c.value() == expected(c.key()));
+            success &= (count == n / 2);
+        }
+        return success;
+    }
+
+    bool test_volume_membership_filter() {
+        // more keys than the first table of the filter holds
+        const int n = 10000;
+        bool success = true;
+        for (auto engine: { btree::BTREE, btree::BPLUS_TREE, btree::PACKED_BPLUS_TREE }) {
+            const auto& path = details::get_file_name("volume_filter_" + std::to_string(engine));
+            {
+                btree::StorageMT<int, int> s;
+                auto v = s.open_volume(path, order, engine, true, btree::OPTIMISTIC_LOCK_COUPLING, btree::MappingOptions(),
+                                       btree::NO_COMPRESSION, true);
+                for (int i = 0; i < n; ++i)
+                    v.set(2 * i, i);
+                for (int i = 0; i < n; ++i)
+                    success &= v.exist(2 * i) && !v.exist(2 * i + 1) && (v.get(2 * i + 1) == std::nullopt);
+                auto stats = v.filter_stats();
+                success &= (stats.keys == n) && (stats.rejected + stats.false_positives == 2 * n);
+                success &= (stats.false_positive_rate() < 0.01);
+
+                for (int i = 0; i < n; i += 2)
+                    success &= v.remove(2 * i);
+                btree::WriteBatch<int, int> batch;
+                batch.remove(2);
+                batch.set(1, 1);
+                v.write(batch);
+                success &= (v.filter_stats().keys == n / 2) && !v.exist(0) && !v.exist(2) && v.exist(1);
+
+                std::vector<int> keys(2 * n);
+                std::iota(keys.begin(), keys.end(), 0);
+                auto found = v.multi_get(keys);
+                for (int i = 0; i < 2 * n; ++i)
+                    success &= (found.has_value(i) == v.exist(i));
+                // the file of the filter is written on close
+                success &= !fs::exists(path + ".filter");
+            }
+            success &= fs::exists(path + ".filter");
+
+            auto expected = [](const int i) { return i == 1 || (i % 4 == 2 && i != 2); };
+            {
+                // the saved filter is loaded, the misses are rejected without the tree
+                btree::Storage<int, int> s;
+                auto v = s.open_volume(path, order, engine, false, btree::COARSE_LOCK, btree::MappingOptions(),
+                                       btree::NO_COMPRESSION, true);
+                success &= !fs::exists(path + ".filter") && (v.filter_stats().keys == n / 2);
+                for (int i = 0; i < 2 * n; ++i)
+                    success &= (v.exist(i) == expected(i));
+                success &= (v.filter_stats().rejected > 0);
+            }
+            {
+                // the volume is changed without the filter, its file is stale
+                btree::Storage<int, int> s;
+                auto v = s.open_volume(path, order, engine);
+                v.set(3, 3);
+                success &= (v.filter_stats().keys == 0) && !fs::exists(path + ".filter");
+            }
+            btree::Storage<int, int> s;
+            auto v = s.open_volume(path, order, engine, false, btree::COARSE_LOCK, btree::MappingOptions(),
+                                   btree::NO_COMPRESSION, true);
+            success &= v.exist(3) && (v.filter_stats().keys == n / 2 + 1);
+            for (int i = 0; i < 2 * n; ++i)
+                success &= (v.exist(i) == (expected(i) || i == 3));
+        }
+        return success;
+    }
+
+    bool test_volume_filter_reclamation() {
+        const int n = 2000;
+        btree::CuckooFilter<int> filter(16);
+        std::vector<int> keys(n);
+        std::iota(keys.begin(), keys.end(), 0);
+        std::atomic<bool> is_rebuilding = true;
+        std::atomic<bool> success = true;
+        // the readers look up the keys kept by every rebuild while their tables are replaced, no key is missed
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 2; ++t) {
+            readers.emplace_back([&]() {
+                while (is_rebuilding)
+                    for (int i = 0; i < n / 2; i += 7)
+                        if (!filter.may_contain(i))
+                            success = false;
+            });
+        }
+        for (int i = 0; i < 200; ++i) {
+            filter.rebuild(std::vector<int>(keys.begin(), keys.begin() + n / 2 + i));
+            filter.rebuild(keys);
+        }
+        is_rebuilding = false;
+        for (auto& reader: readers)
+            reader.join();
+
+        // the readers have left: the next write frees the replaced tables
+        filter.insert(n);
+        bool freed = (filter.retired_tables() == 0);
+        return success && freed && filter.may_contain(n) && filter.stats().keys == n + 1;
+    }
+
+    bool test_volume_hash_engine() {
+        // the small buckets are split many times: the directory is doubled, then halved back by the removals
+        const int n = 20000;
+        const auto& path = details::get_file_name("volume_hash");
+        auto value_of = [](const int i) { return std::string(i % 100 + 1, 'a' + i % 26); };
+        std::map<int, std::string> expected;
+        bool success = true;
+        {
+            btree::Storage<int, std::string> s;
+            auto v = s.open_volume(path, order, btree::HASH, true);
+            for (int i = 0; i < n; ++i) {
+                auto k = (i * 7919) % n - n / 2;
+                v.set(k, value_of(i));
+                expected[k] = value_of(i);
+            }
+            for (int i = 0; i < n; i += 3) {
+                auto k = i - n / 2;
+                success &= v.remove(k);
+                expected.erase(k);
+            }
+            success &= !v.remove(-n / 2) && !v.remove(n);
+
+            btree::WriteBatch<int, std::string> batch;
+            batch.set(n, "batch");
+            batch.set(1 - n / 2, "replaced");
+            batch.remove(2 - n / 2);
+            v.write(batch);
+            expected[n] = "batch";
+            expected[1 - n / 2] = "replaced";
+            expected.erase(2 - n / 2);
+
+            {
+                auto snapshot = v.snapshot();
+                v.set(-n / 2, "new");
+                v.remove(n);
+                success &= !snapshot.exist(-n / 2) && (snapshot.get(n) == "batch") && (v.get(-n / 2) == "new");
+                int64_t count = 0;
+                snapshot.scan(-n, n + 1, [&](const int k, const std::string& value) {
+                    success &= (expected.count(k) > 0) && (expected[k] == value);
+                    ++count;
+                });
+                success &= (count == static_cast<int64_t>(expected.size()));
+                success &= v.remove(-n / 2);
+                v.set(n, "batch");
+            }
+            success &= (v.compact() > 0);
+        }
+
+        btree::Storage<int, std::string> s;
+        auto v = s.open_volume(path, order, btree::HASH, true);
+        for (int k = -n / 2 - 1; k <= n; ++k)
+            success &= (v.get(k) == (expected.count(k) ? std::optional(expected[k]) : std::nullopt));
+
+        // the keys are sorted by the cursor
+        auto c = v.cursor();
+        auto it = expected.begin();
+        for (bool valid = c.seek_to_first(); valid && it != expected.end(); valid = c.next(), ++it)
+            success &= (c.key() == it->first) && (c.value() == it->second);
+        success &= (it == expected.end()) && !c.next();
+        success &= c.seek(-n / 2) && (c.key() == expected.begin()->first) && c.seek_to_last() && (c.key() == n);
+        int64_t count = v.scan(0, n / 4, [&](const int k, const std::string&) { success &= (k >= 0 && k < n / 4); });
+        success &= (count == std::distance(expected.lower_bound(0), expected.lower_bound(n / 4)));
+
+        std::vector<int> keys(n);
+        std::iota(keys.begin(), keys.end(), -n / 2);
+        auto found = v.multi_get(keys);
+        for (size_t i = 0; i < keys.size(); ++i)
+            success &= (found.has_value(i) == (expected.count(keys[i]) > 0));
+
+        for (const auto& [k, value]: expected)
+            success &= v.remove(k);
+        success &= !v.exist(n);
+        s.close_volume(v);
+        success &= (fs::file_size(path) == btree::IOManager<int, std::string>::INITIAL_ROOT_POS_IN_HEADER);
+
+        // the optimistic readers take the lock of the hash
+        {
+            btree::StorageMT<int, int> s_mt;
+            auto v_mt = s_mt.open_volume(path + ".mt", order, btree::HASH, false, btree::OPTIMISTIC_LOCK_COUPLING);
+            std::thread writer([&v_mt]() {
+                for (int i = 0; i < n; ++i)
+                    v_mt.set(i, i);
+            });
+            for (int i = 0; i < n; ++i)
+                success &= (v_mt.get(i).value_or(i) == i);
+            writer.join();
+            for (int i = 0; i < n; ++i)
+                success &= (v_mt.get(i) == i);
+        }
+
+        // the size of the directory is corrupted
+        {
+            auto v_bad = s.open_volume(path, order, btree::HASH);
+            v_bad.set(key, std::to_string(value));
+            s.close_volume(v_bad);
+        }
+        {
+            std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+            // ROOT POS follows T, KEY_SIZE, VALUE_TYPE and ELEMENT_SIZE
+            int64_t directory_pos;
+            file.seekg(sizeof(int16_t) + 3);
+            file.read(reinterpret_cast<char*>(&directory_pos), sizeof(directory_pos));
+            // USED_KEYS follows the FLAG
+            int16_t slots = 3;
+            file.seekp(directory_pos + 1);
+            file.write(reinterpret_cast<const char*>(&slots), sizeof(slots));
+        }
+        try {
+            btree::Storage<int, std::string> s_bad;
+            s_bad.open_volume(path, order, btree::HASH);
+            success = false;
+        } catch (const std::logic_error& e) {
+            std::string_view err_msg = e.what();
+            success &= err_msg.find(error_msg::wrong_directory_msg) != std::string_view::npos;
+        }
+        return success;
+    }
 }
 #endif // UNIT_TESTS
\ No newline at end of file